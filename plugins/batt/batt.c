@@ -46,6 +46,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <unistd.h>
 
 #include "dbg.h" /* for ENTER and RET macros */
 #include "batt_sys.h"
@@ -91,6 +92,8 @@ typedef struct {
     gboolean battery_number_hide;
     sem_t alarmProcessLock;
     battery* b;
+    int uevent_fd;
+    guint uevent_watch;
     gboolean has_ac_adapter;
     gboolean show_extended_information;
     LXPanel *panel;
@@ -272,38 +275,6 @@ void update_display(lx_battery *lx_b, gboolean repaint) {
     else
         isCharging = battery_is_charging ( b );
 
-    /* Consider running the alarm command */
-    if ( !isCharging &&
-        ( ( battery_get_remaining( b ) / 60 ) < (int)lx_b->alarmTime ) )
-    {
-        /* make sure it's stable enough for about a minute (6 * 9 seconds) */
-        if (++lx_b->alarmTimeReached > 6)
-        {
-            lx_b->alarmTimeReached = 0;
-
-            /* FIXME: this should be done using glibs process functions */
-            /* Alarms should not run concurrently; determine whether an alarm is
-               already running */
-            int alarmCanRun;
-            sem_getvalue(&(lx_b->alarmProcessLock), &alarmCanRun);
-
-            /* Run the alarm command if it isn't already running */
-            if (alarmCanRun) {
-
-                Alarm *a = (Alarm *) malloc(sizeof(Alarm));
-                a->command = lx_b->alarmCommand;
-                a->lock = &(lx_b->alarmProcessLock);
-
-                /* Manage the alarm process in a new thread, which which will be
-                   responsible for freeing the alarm struct it's given */
-                pthread_t alarmThread;
-                pthread_create(&alarmThread, NULL, alarmProcess, a);
-            }
-        }
-    }
-    else
-        lx_b->alarmTimeReached = 0;
-
     set_tooltip_text(lx_b);
 
     int chargeLevel = lx_b->b->percentage * lx_b->length / 100;
@@ -349,6 +320,52 @@ update_done:
     cairo_destroy(cr);
 }
 
+/* Consider running the alarm command. This is called only by the periodic
+   update so the stability check doesn't depend on uevents or clicks. */
+static void check_alarm(lx_battery *lx_b)
+{
+    battery *b = lx_b->b;
+    gboolean isCharging;
+
+    if (b == NULL)
+        return;
+    if (b->percentage == 100)
+        isCharging = TRUE;
+    else
+        isCharging = battery_is_charging(b);
+
+    if ( !isCharging &&
+        ( ( battery_get_remaining( b ) / 60 ) < (int)lx_b->alarmTime ) )
+    {
+        /* make sure it's stable enough for about a minute (6 * 9 seconds) */
+        if (++lx_b->alarmTimeReached > 6)
+        {
+            lx_b->alarmTimeReached = 0;
+
+            /* FIXME: this should be done using glibs process functions */
+            /* Alarms should not run concurrently; determine whether an alarm is
+               already running */
+            int alarmCanRun;
+            sem_getvalue(&(lx_b->alarmProcessLock), &alarmCanRun);
+
+            /* Run the alarm command if it isn't already running */
+            if (alarmCanRun) {
+
+                Alarm *a = (Alarm *) malloc(sizeof(Alarm));
+                a->command = lx_b->alarmCommand;
+                a->lock = &(lx_b->alarmProcessLock);
+
+                /* Manage the alarm process in a new thread, which which will be
+                   responsible for freeing the alarm struct it's given */
+                pthread_t alarmThread;
+                pthread_create(&alarmThread, NULL, alarmProcess, a);
+            }
+        }
+    }
+    else
+        lx_b->alarmTimeReached = 0;
+}
+
 /* This callback is called every 9 seconds */
 static int update_timout(lx_battery *lx_b) {
     battery *bat;
@@ -367,12 +384,41 @@ static int update_timout(lx_battery *lx_b) {
         lx_b->b = battery_get(lx_b->battery_number);
     }
 
+    check_alarm(lx_b);
     update_display( lx_b, TRUE );
 
     GDK_THREADS_LEAVE();
     return TRUE;
 }
 
+/* Power supply has changed, update now; the update loop keeps its pace */
+static gboolean uevent_event(GIOChannel *source, GIOCondition condition,
+                             lx_battery *lx_b)
+{
+    if (g_source_is_destroyed(g_main_current_source()))
+        return FALSE;
+    if (condition & (G_IO_ERR | G_IO_HUP))
+    {
+        /* keep polling only */
+        close(lx_b->uevent_fd);
+        lx_b->uevent_fd = -1;
+        lx_b->uevent_watch = 0;
+        return FALSE;
+    }
+    if (battery_monitor_read(lx_b->uevent_fd))
+    {
+        GDK_THREADS_ENTER();
+        if (lx_b->b == NULL || battery_update(lx_b->b) == NULL)
+        {
+            battery_free(lx_b->b);
+            lx_b->b = battery_get(lx_b->battery_number);
+        }
+        update_display(lx_b, TRUE);
+        GDK_THREADS_LEAVE();
+    }
+    return TRUE;
+}
+
 /* An update will be performed whenever the user clicks on the charge bar */
 static gboolean buttonPressEvent(GtkWidget *p, GdkEventButton *event,
                                  LXPanel *panel)
@@ -479,6 +525,7 @@ static GtkWidget * constructor(LXPanel *panel, config_setting_t *settings)
     int tmp_int;
 
     lx_b = g_new0(lx_battery, 1);
+    lx_b->uevent_fd = -1;
 
     /* get requested battery */
     if (config_setting_lookup_int(settings, "BatteryNumber", &tmp_int))
@@ -586,8 +633,19 @@ static GtkWidget * constructor(LXPanel *panel, config_setting_t *settings)
     gdk_color_parse(lx_b->dischargingColor1, &lx_b->discharging1);
     gdk_color_parse(lx_b->dischargingColor2, &lx_b->discharging2);
 
-    /* Start the update loop */
-    lx_b->timer = g_timeout_add_seconds( 9, (GSourceFunc) update_timout, (gpointer) lx_b);
+    /* Start the update loop, it is not paused while the panel is hidden
+       since the alarm command should be run anyway */
+    lx_b->timer = lxpanel_timer_add(NULL, 9000, (GSourceFunc) update_timout, (gpointer) lx_b);
+
+    /* AC plug and charge level changes are reported by kernel */
+    lx_b->uevent_fd = battery_monitor_open();
+    if (lx_b->uevent_fd >= 0)
+    {
+        GIOChannel *channel = g_io_channel_unix_new(lx_b->uevent_fd);
+        lx_b->uevent_watch = g_io_add_watch(channel, G_IO_IN | G_IO_ERR | G_IO_HUP,
+                                            (GIOFunc) uevent_event, lx_b);
+        g_io_channel_unref(channel);
+    }
 
     RET(p);
 }
@@ -616,7 +674,11 @@ destructor(gpointer data)
     g_free(b->rateSamples);
     sem_destroy(&(b->alarmProcessLock));
     if (b->timer)
-        g_source_remove(b->timer);
+        lxpanel_timer_remove(b->timer);
+    if (b->uevent_watch)
+        g_source_remove(b->uevent_watch);
+    if (b->uevent_fd >= 0)
+        close(b->uevent_fd);
     g_free(b);
 
     RET();
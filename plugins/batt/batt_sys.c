@@ -37,8 +37,18 @@
 #include <glib/gstdio.h>
 
 /* shrug: get rid of this */
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
 
 battery* battery_new() {
     static int battery_num = 1;
@@ -54,6 +64,7 @@ battery* battery_new() {
     b->charge_now = -1;
     b->current_now = -1;
     b->power_now = -1;
+    b->capacity = -1;
     b->state = NULL;
     b->battery_num = battery_num;
     b->seconds = -1;
@@ -148,6 +159,123 @@ void battery_print(battery *b, int show_capacity)
 }
 #endif
 
+/* keys of uevent file which are converted the same way as
+   get_gint_from_infofile() does for separate files */
+static const struct {
+    const char *key;
+    gsize offset;
+} uevent_int_keys[] = {
+    { "CHARGE_NOW", G_STRUCT_OFFSET(battery, charge_now) },
+    { "ENERGY_NOW", G_STRUCT_OFFSET(battery, energy_now) },
+    { "CURRENT_NOW", G_STRUCT_OFFSET(battery, current_now) },
+    { "POWER_NOW", G_STRUCT_OFFSET(battery, power_now) },
+    { "VOLTAGE_NOW", G_STRUCT_OFFSET(battery, voltage_now) },
+    { "CHARGE_FULL", G_STRUCT_OFFSET(battery, charge_full) },
+    { "ENERGY_FULL", G_STRUCT_OFFSET(battery, energy_full) },
+    { "CHARGE_FULL_DESIGN", G_STRUCT_OFFSET(battery, charge_full_design) },
+    { "ENERGY_FULL_DESIGN", G_STRUCT_OFFSET(battery, energy_full_design) }
+};
+
+/* battery_read_uevent():
+ *         Reads all values from the uevent file of the supply at once.
+ *         Returns FALSE if the file cannot be read. */
+static gboolean battery_read_uevent(battery *b)
+{
+    char path[PATH_MAX];
+    char buf[BUF_SIZE * 4];
+    char *line, *end, *value;
+    gboolean is_battery = TRUE;
+    ssize_t len;
+    guint i;
+    int fd;
+
+    if (b->path == NULL)
+        return FALSE;
+    snprintf(path, sizeof(path), "%s/%s/uevent", ACPI_PATH_SYS_POWER_SUPPLY, b->path);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return FALSE;
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return FALSE;
+    buf[len] = '\0';
+
+    for (i = 0; i < G_N_ELEMENTS(uevent_int_keys); i++)
+        G_STRUCT_MEMBER(int, b, uevent_int_keys[i].offset) = -1;
+    b->capacity = -1;
+    g_free(b->state);
+    b->state = NULL;
+
+    /* lines look like "POWER_SUPPLY_CHARGE_NOW=4200000" */
+    for (line = buf; *line; line = end)
+    {
+        end = strchr(line, '\n');
+        if (end)
+            *end++ = '\0';
+        else
+            end = line + strlen(line);
+        if (strncmp(line, "POWER_SUPPLY_", 13) != 0)
+            continue;
+        line += 13;
+        value = strchr(line, '=');
+        if (value == NULL)
+            continue;
+        *value++ = '\0';
+        if (strcmp(line, "STATUS") == 0)
+            b->state = g_strdup(value);
+        else if (strcmp(line, "TYPE") == 0)
+            is_battery = (strcasecmp(value, "battery") == 0);
+        else if (strcmp(line, "CAPACITY") == 0)
+            b->capacity = atoi(value);
+        else for (i = 0; i < G_N_ELEMENTS(uevent_int_keys); i++)
+            if (strcmp(line, uevent_int_keys[i].key) == 0)
+            {
+                G_STRUCT_MEMBER(int, b, uevent_int_keys[i].offset) = atoi(value) / 1000;
+                break;
+            }
+    }
+    b->type_battery = is_battery;
+
+    return TRUE;
+}
+
+/* battery_read_files():
+ *         Reads values from separate files, for kernels which
+ *         don't provide them in the uevent file. */
+static void battery_read_files(battery *b)
+{
+    gchar *gctmp;
+
+    b->charge_now = get_gint_from_infofile(b, "charge_now");
+    b->energy_now = get_gint_from_infofile(b, "energy_now");
+
+    b->current_now = get_gint_from_infofile(b, "current_now");
+    b->power_now   = get_gint_from_infofile(b, "power_now");
+
+    b->charge_full = get_gint_from_infofile(b, "charge_full");
+    b->energy_full = get_gint_from_infofile(b, "energy_full");
+
+    b->charge_full_design = get_gint_from_infofile(b, "charge_full_design");
+    b->energy_full_design = get_gint_from_infofile(b, "energy_full_design");
+
+    b->voltage_now = get_gint_from_infofile(b, "voltage_now");
+
+    gctmp = get_gchar_from_infofile(b, "type");
+    b->type_battery = gctmp ? (strcasecmp(gctmp, "battery") == 0) : TRUE;
+    g_free(gctmp);
+
+    /* Pinebook has percentage in capacity, and no total energy. */
+    gctmp = parse_info_file(b, "capacity");
+    b->capacity = gctmp ? atoi(gctmp) : -1;
+    g_free(gctmp);
+
+    g_free(b->state);
+    b->state = get_gchar_from_infofile(b, "status");
+    if (!b->state)
+        b->state = get_gchar_from_infofile(b, "state");
+}
+
 static gboolean battery_inserted(gchar* path)
 {
     if (path == NULL)
@@ -168,21 +296,19 @@ static gboolean battery_inserted(gchar* path)
 
 battery* battery_update(battery *b)
 {
-    gchar *gctmp;
     int promille;
 
     if (b == NULL)
         return NULL;
 
-    if (!battery_inserted(b->path))
-        return NULL;
-
     /* read from sysfs */
-    b->charge_now = get_gint_from_infofile(b, "charge_now");
-    b->energy_now = get_gint_from_infofile(b, "energy_now");
+    if (!battery_read_uevent(b))
+    {
+        if (!battery_inserted(b->path))
+            return NULL;
+        battery_read_files(b);
+    }
 
-    b->current_now = get_gint_from_infofile(b, "current_now");
-    b->power_now   = get_gint_from_infofile(b, "power_now");
     /* FIXME: Some battery drivers report -1000 when the discharge rate is
      * unavailable. Others use negative values when discharging. Best we can do
      * is to treat -1 as an error, and take the absolute value otherwise.
@@ -191,22 +317,6 @@ battery* battery_update(battery *b)
     if (b->current_now < -1)
             b->current_now = - b->current_now;
 
-    b->charge_full = get_gint_from_infofile(b, "charge_full");
-    b->energy_full = get_gint_from_infofile(b, "energy_full");
-
-    b->charge_full_design = get_gint_from_infofile(b, "charge_full_design");
-    b->energy_full_design = get_gint_from_infofile(b, "energy_full_design");
-
-    b->voltage_now = get_gint_from_infofile(b, "voltage_now");
-
-    gctmp = get_gchar_from_infofile(b, "type");
-    b->type_battery = gctmp ? (strcasecmp(gctmp, "battery") == 0) : TRUE;
-    g_free(gctmp);
-
-    g_free(b->state);
-    b->state = get_gchar_from_infofile(b, "status");
-    if (!b->state)
-        b->state = get_gchar_from_infofile(b, "state");
     if (!b->state) {
         if (b->charge_now != -1 || b->energy_now != -1
                 || b->charge_full != -1 || b->energy_full != -1)
@@ -263,12 +373,8 @@ battery* battery_update(battery *b)
         promille = (b->energy_now * 1000) / b->energy_full;
     else {
         /* Pinebook has percentage in capacity, and no total energy. */
-        gchar *file_content = parse_info_file(b, "capacity");
-        gint value = -1;
+        gint value = b->capacity;
 
-        if (file_content != NULL)
-            value = atoi(file_content);
-        g_free(file_content);
         if (value != -1 && value <= 100 && value >= 0) {
             promille = value * 10;
             b->charge_full = 10000;  /* mAh from pinebook spec */
@@ -326,7 +432,7 @@ battery *battery_get(int battery_number) {
 
     /* Try the expected path in sysfs first */
     batt_name = g_strdup_printf(ACPI_BATTERY_DEVICE_NAME "%d", battery_number);
-    batt_path = g_strdup_printf(ACPI_PATH_SYS_POWER_SUPPLY "/%s", batt_name);
+    batt_path = g_strdup_printf("%s/%s", ACPI_PATH_SYS_POWER_SUPPLY, batt_name);
     if (g_file_test(batt_path, G_FILE_TEST_IS_DIR) == TRUE) {
         b = battery_new();
         b->path = g_strdup( batt_name);
@@ -403,5 +509,74 @@ gint battery_get_remaining( battery *b )
     return b->seconds;
 }
 
+#ifdef __linux__
+/* battery_monitor_open():
+ *         Opens a socket which receives kernel uevents, so changes of
+ *         power supplies may be handled immediately instead of waiting
+ *         for the next update. Returns -1 on failure. */
+int battery_monitor_open(void)
+{
+    struct sockaddr_nl addr;
+    int fd;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; /* kernel events, not ones rebroadcasted by udev */
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* battery_monitor_read():
+ *         Reads all pending events from the socket. Returns TRUE if any
+ *         of them was about a power supply. */
+gboolean battery_monitor_read(int fd)
+{
+    char buf[BUF_SIZE * 8];
+    gboolean changed = FALSE;
+    ssize_t len;
+    char *p, *end;
+
+    for (;;)
+    {
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+        buf[len] = '\0';
+        /* event is "ACTION@DEVPATH" followed by NUL-separated KEY=VALUE */
+        end = buf + len;
+        for (p = buf; p < end; p += strlen(p) + 1)
+            if (strcmp(p, "SUBSYSTEM=power_supply") == 0)
+            {
+                changed = TRUE;
+                break;
+            }
+    }
+
+    return changed;
+}
+#else
+int battery_monitor_open(void)
+{
+    return -1;
+}
+
+gboolean battery_monitor_read(int fd)
+{
+    return FALSE;
+}
+#endif
+
 
 /* vim: set sw=4 et sts=4 : */
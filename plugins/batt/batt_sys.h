@@ -26,7 +26,10 @@
 
 
 #define BUF_SIZE 1024
+/* may be overridden, test/batt-sys-check.c points it to a fake tree */
+#ifndef ACPI_PATH_SYS_POWER_SUPPLY
 #define ACPI_PATH_SYS_POWER_SUPPLY  "/sys/class/power_supply"
+#endif
 #define ACPI_BATTERY_DEVICE_NAME    "BAT"
 #define MIN_CAPACITY	 0.01
 #define MIN_PRESENT_RATE 0.01
@@ -48,6 +51,7 @@ typedef struct battery {
     int energy_full_design;
     int charge_full;
     int energy_full;
+    int capacity;
     /* extra info */
     int seconds;
     int percentage;
@@ -63,5 +67,7 @@ battery *battery_update( battery *b );
 gboolean battery_is_charging( battery *b );
 gint battery_get_remaining( battery *b );
 void battery_free(battery* bat);
+int battery_monitor_open(void);
+gboolean battery_monitor_read(int fd);
 
 #endif
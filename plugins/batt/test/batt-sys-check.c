@@ -0,0 +1,183 @@
+// gcc -I.. -DACPI_PATH_SYS_POWER_SUPPLY='"/tmp/batt-sys-check"' batt-sys-check.c ../batt_sys.c -o batt-sys-check `pkg-config --cflags --libs glib-2.0`
+
+/*
+ * Check for the sysfs backend of the battery plugin: it reads batteries
+ * from a fake power_supply tree made in ACPI_PATH_SYS_POWER_SUPPLY and
+ * filters kernel uevents sent through a socketpair.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "batt_sys.h"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failed++; } } while (0)
+
+static void write_file(const char *dir, const char *name, const char *data)
+{
+    char path[PATH_MAX];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s/%s", ACPI_PATH_SYS_POWER_SUPPLY, dir, name);
+    f = fopen(path, "w");
+    fputs(data, f);
+    fclose(f);
+}
+
+static void make_supply(const char *dir)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/%s", ACPI_PATH_SYS_POWER_SUPPLY, dir);
+    mkdir(path, 0755);
+}
+
+static void remove_supply(const char *dir)
+{
+    char cmd[PATH_MAX + 16];
+
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s/%s'", ACPI_PATH_SYS_POWER_SUPPLY, dir);
+    if (system(cmd) != 0)
+        failed++;
+}
+
+#define BAT0_UEVENT \
+    "POWER_SUPPLY_NAME=BAT0\n" \
+    "POWER_SUPPLY_TYPE=Battery\n" \
+    "POWER_SUPPLY_STATUS=Discharging\n" \
+    "POWER_SUPPLY_VOLTAGE_NOW=12000000\n" \
+    "POWER_SUPPLY_CURRENT_NOW=1500000\n" \
+    "POWER_SUPPLY_CHARGE_FULL_DESIGN=5000000\n" \
+    "POWER_SUPPLY_CHARGE_FULL=4000000\n" \
+    "POWER_SUPPLY_CHARGE_NOW=1000000\n" \
+    "POWER_SUPPLY_CAPACITY=25\n"
+
+static void check_sysfs(void)
+{
+    battery *b;
+
+    make_supply("AC");
+    write_file("AC", "uevent", "POWER_SUPPLY_NAME=AC\nPOWER_SUPPLY_TYPE=Mains\n"
+                               "POWER_SUPPLY_ONLINE=0\n");
+    make_supply("BAT0");
+    write_file("BAT0", "uevent", BAT0_UEVENT);
+
+    b = battery_get(0);
+    CHECK(b != NULL);
+    if (b == NULL)
+        return;
+    CHECK(strcmp(b->path, "BAT0") == 0 && b->type_battery);
+    CHECK(strcmp(b->state, "Discharging") == 0);
+    CHECK(b->charge_now == 1000 && b->charge_full == 4000);
+    CHECK(b->charge_full_design == 5000 && b->current_now == 1500);
+    CHECK(b->voltage_now == 12000 && b->capacity == 25);
+    CHECK(b->energy_now == -1 && b->power_now == -1);
+    CHECK(b->percentage == 25);
+    CHECK(b->seconds == 3600 * 1000 / 1500);
+    CHECK(!battery_is_charging(b));
+
+    /* values are read again, missing keys are reset */
+    write_file("BAT0", "uevent", "POWER_SUPPLY_TYPE=Battery\n"
+                                 "POWER_SUPPLY_STATUS=Charging\n"
+                                 "POWER_SUPPLY_ENERGY_FULL=50000000\n"
+                                 "POWER_SUPPLY_ENERGY_NOW=40000000\n"
+                                 "POWER_SUPPLY_POWER_NOW=10000000");
+    CHECK(battery_update(b) == b);
+    CHECK(strcmp(b->state, "Charging") == 0 && battery_is_charging(b));
+    CHECK(b->charge_now == -1 && b->current_now == -1 && b->capacity == -1);
+    CHECK(b->energy_now == 40000 && b->percentage == 80);
+    CHECK(b->seconds == 3600 * 10000 / 10000);
+
+    /* the battery was removed */
+    remove_supply("BAT0");
+    CHECK(battery_update(b) == NULL);
+    battery_free(b);
+
+    /* a mains supply is not taken as battery */
+    CHECK(battery_get(0) == NULL);
+
+    /* older kernels have separate files only */
+    make_supply("BAT1");
+    write_file("BAT1", "type", "Battery\n");
+    write_file("BAT1", "status", "Full\n");
+    write_file("BAT1", "energy_full", "60000000\n");
+    write_file("BAT1", "energy_now", "30000000\n");
+    b = battery_get(1);
+    CHECK(b != NULL);
+    if (b == NULL)
+        return;
+    CHECK(strcmp(b->state, "Full") == 0 && b->energy_full == 60000);
+    CHECK(b->percentage == 50 && b->seconds == -1);
+    battery_free(b);
+    remove_supply("BAT1");
+    remove_supply("AC");
+}
+
+static void check_monitor(void)
+{
+    static const char ps_event[] = "change@/devices/LNXSYSTM:00/PNP0C0A:00/power_supply/BAT0\0"
+                                   "ACTION=change\0SUBSYSTEM=power_supply\0"
+                                   "POWER_SUPPLY_STATUS=Charging";
+    static const char net_event[] = "add@/devices/virtual/net/tun0\0"
+                                    "ACTION=add\0SUBSYSTEM=net\0INTERFACE=tun0";
+    int sv[2];
+
+    /* the plugin reads a netlink datagram socket, a socketpair has the
+       same message boundaries */
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0)
+    {
+        failed++;
+        return;
+    }
+    CHECK(!battery_monitor_read(sv[0]));
+    send(sv[1], ps_event, sizeof(ps_event), 0);
+    CHECK(battery_monitor_read(sv[0]));
+    send(sv[1], net_event, sizeof(net_event), 0);
+    CHECK(!battery_monitor_read(sv[0]));
+    /* all pending events are consumed at once */
+    send(sv[1], net_event, sizeof(net_event), 0);
+    send(sv[1], ps_event, sizeof(ps_event), 0);
+    send(sv[1], net_event, sizeof(net_event), 0);
+    CHECK(battery_monitor_read(sv[0]));
+    CHECK(!battery_monitor_read(sv[0]));
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    if (mkdir(ACPI_PATH_SYS_POWER_SUPPLY, 0755) < 0)
+        return 2;
+    check_sysfs();
+    check_monitor();
+    rmdir(ACPI_PATH_SYS_POWER_SUPPLY);
+    if (failed)
+        return 1;
+    printf("all checks passed\n");
+    return 0;
+}
@@ -40,35 +40,47 @@
 #include <glib/gi18n.h>
 
 #include "plugin.h"
+#include "proc-stat.h"
 
 #define BORDER_SIZE 2
 #define PANEL_HEIGHT_DEFAULT 26 /* from panel defaults */
 
 /* #include "../../dbg.h" */
 
-typedef unsigned long long CPUTick;		/* Value from /proc/stat */
 typedef float CPUSample;			/* Saved CPU utilization value as 0.0..1.0 */
 
-struct cpu_stat {
-    CPUTick u, n, s, i;				/* User, nice, system, idle */
+/* Values saved for each column of the graph in stacked mode. */
+enum {
+    CPU_STACK_USER,
+    CPU_STACK_SYSTEM,
+    CPU_STACK_IOWAIT,
+    CPU_STACK_STEAL,
+    N_CPU_STACK
 };
 
 /* Private context for CPU plugin. */
 typedef struct {
+    config_setting_t * settings;		/* Plugin settings */
     GdkColor foreground_color;			/* Foreground color for drawing area */
+    GdkColor stack_colors[N_CPU_STACK];		/* Colors for stacked graph */
     GtkWidget * da;				/* Drawing area */
     cairo_surface_t * pixmap;				/* Pixmap to be drawn on drawing area */
 
-    guint timer;				/* Timer for periodic update */
+    guint sampler;				/* Subscription to /proc/stat sampler */
     CPUSample * stats_cpu;			/* Ring buffer of CPU utilization values */
+    guint stride;				/* Number of values per column in ring buffer */
     unsigned int ring_cursor;			/* Cursor for ring buffer */
     guint pixmap_width;				/* Width of drawing area pixmap; also size of ring buffer; does not include border size */
     guint pixmap_height;			/* Height of drawing area pixmap; does not include border size */
-    struct cpu_stat previous_cpu_stat;		/* Previous value of cpu_stat */
+    LXPanelCpuTimes previous_cpu_stat;		/* Previous value of CPU times */
+    LXPanelCpuTimes * previous_cores;		/* Previous values of per core CPU times */
+    guint n_cores;				/* Number of elements in previous_cores */
+    gboolean show_breakdown;			/* Stack user, system, iowait and steal times */
+    gboolean per_core;				/* Draw heatmap with a row per core */
 } CPUPlugin;
 
 static void redraw_pixmap(CPUPlugin * c);
-static gboolean cpu_update(CPUPlugin * c);
+static void cpu_update(const LXPanelProcStat * stat, gpointer user_data);
 static gboolean configure_event(GtkWidget * widget, GdkEventConfigure * event, CPUPlugin * c);
 #if !GTK_CHECK_VERSION(3, 0, 0)
 static gboolean expose_event(GtkWidget * widget, GdkEventExpose * event, CPUPlugin * c);
@@ -78,6 +90,51 @@ static gboolean draw(GtkWidget * widget, cairo_t * cr, CPUPlugin * c);
 
 static void cpu_destructor(gpointer user_data);
 
+/* Draw one column of the stacked graph. */
+static void draw_stacked_column(CPUPlugin * c, cairo_t * cr, unsigned int x, CPUSample * sample)
+{
+    double y = c->pixmap_height;
+    double h;
+    unsigned int j;
+
+    for (j = 0; j < N_CPU_STACK; j++)
+    {
+        if (sample[j] == 0.0)
+            continue;
+        h = sample[j] * c->pixmap_height;
+        gdk_cairo_set_source_color(cr, &c->stack_colors[j]);
+        cairo_move_to(cr, x + 0.5, y);
+        cairo_line_to(cr, x + 0.5, y - h);
+        cairo_stroke(cr);
+        y -= h;
+    }
+}
+
+/* Draw one column of the heatmap. If there are more cores than pixels in
+ * the column then the busiest core of each group is shown so a single
+ * saturated core is never averaged away. */
+static void draw_heatmap_column(CPUPlugin * c, cairo_t * cr, unsigned int x, CPUSample * sample)
+{
+    guint rows = MIN(c->stride, c->pixmap_height);
+    double row_height = (double)c->pixmap_height / rows;
+    guint row, core, last;
+    CPUSample value;
+
+    for (row = 0, core = 0; row < rows; row++)
+    {
+        last = (row + 1) * c->stride / rows;
+        for (value = 0.0; core < last; core++)
+            value = MAX(value, sample[core]);
+        if (value == 0.0)
+            continue;
+        cairo_set_source_rgb(cr, value * c->foreground_color.red / 65535.0,
+                                 value * c->foreground_color.green / 65535.0,
+                                 value * c->foreground_color.blue / 65535.0);
+        cairo_rectangle(cr, x, row * row_height, 1, row_height);
+        cairo_fill(cr);
+    }
+}
+
 /* Redraw after timer callback or resize. */
 static void redraw_pixmap(CPUPlugin * c)
 {
@@ -95,11 +152,17 @@ static void redraw_pixmap(CPUPlugin * c)
     gdk_cairo_set_source_color(cr, &c->foreground_color);
     for (i = 0; i < c->pixmap_width; i++)
     {
+        CPUSample * sample = &c->stats_cpu[drawing_cursor * c->stride];
+
         /* Draw one bar of the CPU usage graph. */
-        if (c->stats_cpu[drawing_cursor] != 0.0)
+        if (c->per_core)
+            draw_heatmap_column(c, cr, i, sample);
+        else if (c->show_breakdown)
+            draw_stacked_column(c, cr, i, sample);
+        else if (sample[0] != 0.0)
         {
             cairo_move_to(cr, i + 0.5, c->pixmap_height);
-            cairo_line_to(cr, i + 0.5, c->pixmap_height - c->stats_cpu[drawing_cursor] * c->pixmap_height);
+            cairo_line_to(cr, i + 0.5, c->pixmap_height - sample[0] * c->pixmap_height);
             cairo_stroke(cr);
         }
 
@@ -116,47 +179,89 @@ static void redraw_pixmap(CPUPlugin * c)
     gtk_widget_queue_draw(c->da);
 }
 
-/* Periodic timer callback. */
-static gboolean cpu_update(CPUPlugin * c)
+/* Drop collected samples, e.g. when number of values per column changes. */
+static void reset_samples(CPUPlugin * c, guint stride)
 {
-    if (g_source_is_destroyed(g_main_current_source()))
-        return FALSE;
+    c->stride = stride;
+    c->ring_cursor = 0;
+    if (c->stats_cpu != NULL)
+    {
+        g_free(c->stats_cpu);
+        c->stats_cpu = g_new0(CPUSample, c->pixmap_width * c->stride);
+    }
+}
+
+/* Number of values per column for current settings. */
+static guint cpu_stride(CPUPlugin * c, guint n_cores)
+{
+    return c->per_core ? MAX(n_cores, 1) : c->show_breakdown ? N_CPU_STACK : 1;
+}
+
+/* Periodic sampler callback. */
+static void cpu_update(const LXPanelProcStat * stat, gpointer user_data)
+{
+    CPUPlugin * c = user_data;
+    const LXPanelCpuTimes * cpu = &stat->cpu;
+    guint stride = cpu_stride(c, stat->n_cores);
+
+    if (stride != c->stride)
+        reset_samples(c, stride);
+
     if ((c->stats_cpu != NULL) && (c->pixmap != NULL))
     {
-        /* Open statistics file and scan out CPU usage. */
-        struct cpu_stat cpu;
-        FILE * stat = fopen("/proc/stat", "r");
-        if (stat == NULL)
-            return TRUE;
-        int fscanf_result = fscanf(stat, "cpu %llu %llu %llu %llu", &cpu.u, &cpu.n, &cpu.s, &cpu.i);
-        fclose(stat);
-
-        /* Ensure that fscanf succeeded. */
-        if (fscanf_result == 4)
+        CPUSample * sample = &c->stats_cpu[c->ring_cursor * c->stride];
+        LXPanelCpuLoad load;
+        guint i;
+
+        if (c->per_core)
+        {
+            /* Compute busy fraction of each core, cores which were not seen
+             * in previous sample are shown idle this time. */
+            for (i = 0; i < c->stride; i++)
+                sample[i] = (i < stat->n_cores && i < c->n_cores) ? lxpanel_cpu_times_load(&stat->cores[i], &c->previous_cores[i], &load) : 0.0;
+        }
+        else if (c->show_breakdown)
+        {
+            lxpanel_cpu_times_load(cpu, &c->previous_cpu_stat, &load);
+            sample[CPU_STACK_USER] = load.user;
+            sample[CPU_STACK_SYSTEM] = load.system;
+            sample[CPU_STACK_IOWAIT] = load.iowait;
+            sample[CPU_STACK_STEAL] = load.steal;
+        }
+        else
         {
             /* Compute delta from previous statistics. */
-            struct cpu_stat cpu_delta;
-            cpu_delta.u = cpu.u - c->previous_cpu_stat.u;
-            cpu_delta.n = cpu.n - c->previous_cpu_stat.n;
-            cpu_delta.s = cpu.s - c->previous_cpu_stat.s;
-            cpu_delta.i = cpu.i - c->previous_cpu_stat.i;
-
-            /* Copy current to previous. */
-            memcpy(&c->previous_cpu_stat, &cpu, sizeof(struct cpu_stat));
-
-            /* Compute user+nice+system as a fraction of total.
-             * Introduce this sample to ring buffer, increment and wrap ring buffer cursor. */
-            float cpu_uns = cpu_delta.u + cpu_delta.n + cpu_delta.s;
-            c->stats_cpu[c->ring_cursor] = cpu_uns / (cpu_uns + cpu_delta.i);
-            c->ring_cursor += 1;
-            if (c->ring_cursor >= c->pixmap_width)
-                c->ring_cursor = 0;
-
-            /* Redraw with the new sample. */
-            redraw_pixmap(c);
+            guint64 cpu_u = cpu->user - c->previous_cpu_stat.user;
+            guint64 cpu_n = cpu->nice - c->previous_cpu_stat.nice;
+            guint64 cpu_s = cpu->system - c->previous_cpu_stat.system;
+            guint64 cpu_i = cpu->idle - c->previous_cpu_stat.idle;
+
+            /* Compute user+nice+system as a fraction of total. */
+            float cpu_uns = cpu_u + cpu_n + cpu_s;
+            if (cpu_uns + cpu_i > 0)
+                sample[0] = cpu_uns / (cpu_uns + cpu_i);
+            else
+                sample[0] = 0.0;
         }
+
+        /* Introduce this sample to ring buffer, increment and wrap ring buffer cursor. */
+        c->ring_cursor += 1;
+        if (c->ring_cursor >= c->pixmap_width)
+            c->ring_cursor = 0;
+
+        /* Redraw with the new sample. */
+        redraw_pixmap(c);
     }
-    return TRUE;
+
+    /* Copy current to previous. */
+    c->previous_cpu_stat = *cpu;
+    if (c->n_cores != stat->n_cores)
+    {
+        c->n_cores = stat->n_cores;
+        c->previous_cores = g_renew(LXPanelCpuTimes, c->previous_cores, c->n_cores);
+    }
+    if (c->n_cores > 0)
+        memcpy(c->previous_cores, stat->cores, c->n_cores * sizeof(LXPanelCpuTimes));
 }
 
 /* Handler for configure_event on drawing area. */
@@ -173,7 +278,7 @@ static gboolean configure_event(GtkWidget * widget, GdkEventConfigure * event, C
         /* If statistics buffer does not exist or it changed size, reallocate and preserve existing data. */
         if ((c->stats_cpu == NULL) || (new_pixmap_width != c->pixmap_width))
         {
-            CPUSample * new_stats_cpu = g_new0(typeof(*c->stats_cpu), new_pixmap_width);
+            CPUSample * new_stats_cpu = g_new0(typeof(*c->stats_cpu), new_pixmap_width * c->stride);
             if (c->stats_cpu != NULL)
             {
                 if (new_pixmap_width > c->pixmap_width)
@@ -181,25 +286,25 @@ static gboolean configure_event(GtkWidget * widget, GdkEventConfigure * event, C
                     /* New allocation is larger.
                      * Introduce new "oldest" samples of zero following the cursor. */
                     memcpy(&new_stats_cpu[0],
-                        &c->stats_cpu[0], c->ring_cursor * sizeof(CPUSample));
-                    memcpy(&new_stats_cpu[new_pixmap_width - c->pixmap_width + c->ring_cursor],
-                        &c->stats_cpu[c->ring_cursor], (c->pixmap_width - c->ring_cursor) * sizeof(CPUSample));
+                        &c->stats_cpu[0], c->ring_cursor * c->stride * sizeof(CPUSample));
+                    memcpy(&new_stats_cpu[(new_pixmap_width - c->pixmap_width + c->ring_cursor) * c->stride],
+                        &c->stats_cpu[c->ring_cursor * c->stride], (c->pixmap_width - c->ring_cursor) * c->stride * sizeof(CPUSample));
                 }
                 else if (c->ring_cursor <= new_pixmap_width)
                 {
                     /* New allocation is smaller, but still larger than the ring buffer cursor.
                      * Discard the oldest samples following the cursor. */
                     memcpy(&new_stats_cpu[0],
-                        &c->stats_cpu[0], c->ring_cursor * sizeof(CPUSample));
-                    memcpy(&new_stats_cpu[c->ring_cursor],
-                        &c->stats_cpu[c->pixmap_width - new_pixmap_width + c->ring_cursor], (new_pixmap_width - c->ring_cursor) * sizeof(CPUSample));
+                        &c->stats_cpu[0], c->ring_cursor * c->stride * sizeof(CPUSample));
+                    memcpy(&new_stats_cpu[c->ring_cursor * c->stride],
+                        &c->stats_cpu[(c->pixmap_width - new_pixmap_width + c->ring_cursor) * c->stride], (new_pixmap_width - c->ring_cursor) * c->stride * sizeof(CPUSample));
                 }
                 else
                 {
                     /* New allocation is smaller, and also smaller than the ring buffer cursor.
                      * Discard all oldest samples following the ring buffer cursor and additional samples at the beginning of the buffer. */
                     memcpy(&new_stats_cpu[0],
-                        &c->stats_cpu[c->ring_cursor - new_pixmap_width], new_pixmap_width * sizeof(CPUSample));
+                        &c->stats_cpu[(c->ring_cursor - new_pixmap_width) * c->stride], new_pixmap_width * c->stride * sizeof(CPUSample));
                     c->ring_cursor = 0;
                 }
                 g_free(c->stats_cpu);
@@ -258,6 +363,16 @@ static GtkWidget *cpu_constructor(LXPanel *panel, config_setting_t *settings)
     /* Allocate plugin context and set into Plugin private data pointer. */
     CPUPlugin * c = g_new0(CPUPlugin, 1);
     GtkWidget * p;
+    const LXPanelProcStat * stat;
+    int tmp_int;
+
+    /* Load parameters from the configuration file. */
+    c->settings = settings;
+    if (config_setting_lookup_int(settings, "ShowBreakdown", &tmp_int))
+        c->show_breakdown = tmp_int != 0;
+    if (config_setting_lookup_int(settings, "PerCore", &tmp_int))
+        c->per_core = tmp_int != 0;
+    c->stride = 1;
 
     /* Allocate top level widget and set into Plugin widget pointer. */
     p = gtk_event_box_new();
@@ -274,6 +389,10 @@ static GtkWidget *cpu_constructor(LXPanel *panel, config_setting_t *settings)
     /* Clone a graphics context and set "green" as its foreground color.
      * We will use this to draw the graph. */
     gdk_color_parse("green",  &c->foreground_color);
+    c->stack_colors[CPU_STACK_USER] = c->foreground_color;
+    gdk_color_parse("red", &c->stack_colors[CPU_STACK_SYSTEM]);
+    gdk_color_parse("#4060ff", &c->stack_colors[CPU_STACK_IOWAIT]);
+    gdk_color_parse("magenta", &c->stack_colors[CPU_STACK_STEAL]);
 
     /* Connect signals. */
     g_signal_connect(G_OBJECT(c->da), "configure-event", G_CALLBACK(configure_event), (gpointer) c);
@@ -283,9 +402,16 @@ static GtkWidget *cpu_constructor(LXPanel *panel, config_setting_t *settings)
     g_signal_connect(G_OBJECT(c->da), "draw", G_CALLBACK(draw), (gpointer) c);
 #endif
 
-    /* Show the widget.  Connect a timer to refresh the statistics. */
+    /* Show the widget.  Subscribe to the sampler to refresh the statistics. */
     gtk_widget_show(c->da);
-    c->timer = g_timeout_add(1500, (GSourceFunc) cpu_update, (gpointer) c);
+    c->sampler = lxpanel_proc_stat_subscribe(c->da, 1500, cpu_update, c);
+    stat = lxpanel_proc_stat_get(0);
+    if (stat != NULL)
+    {
+        c->previous_cpu_stat = stat->cpu;
+        c->n_cores = stat->n_cores;
+        c->previous_cores = g_memdup(stat->cores, c->n_cores * sizeof(LXPanelCpuTimes));
+    }
     return p;
 }
 
@@ -294,15 +420,43 @@ static void cpu_destructor(gpointer user_data)
 {
     CPUPlugin * c = (CPUPlugin *)user_data;
 
-    /* Disconnect the timer. */
-    g_source_remove(c->timer);
+    /* Disconnect from the sampler. */
+    lxpanel_proc_stat_unsubscribe(c->sampler);
 
     /* Deallocate memory. */
     cairo_surface_destroy(c->pixmap);
     g_free(c->stats_cpu);
+    g_free(c->previous_cores);
     g_free(c);
 }
 
+/* Callback when the configuration dialog has recorded a configuration change. */
+static gboolean cpu_apply_configuration(gpointer user_data)
+{
+    GtkWidget * p = user_data;
+    CPUPlugin * c = lxpanel_plugin_get_data(p);
+
+    config_group_set_int(c->settings, "ShowBreakdown", c->show_breakdown);
+    config_group_set_int(c->settings, "PerCore", c->per_core);
+    /* Samples have other layout now, drop them and redraw. */
+    reset_samples(c, cpu_stride(c, c->n_cores));
+    if (c->pixmap != NULL)
+        redraw_pixmap(c);
+    return FALSE;
+}
+
+/* Callback when the configuration dialog is to be shown. */
+static GtkWidget * cpu_configure(LXPanel * panel, GtkWidget * p)
+{
+    CPUPlugin * c = lxpanel_plugin_get_data(p);
+
+    return lxpanel_generic_config_dlg(_("CPU Usage Monitor"), panel,
+        cpu_apply_configuration, p,
+        _("Show user, system, I/O wait and steal time separately"), &c->show_breakdown, CONF_TYPE_BOOL,
+        _("Show each CPU core as a row of heatmap"), &c->per_core, CONF_TYPE_BOOL,
+        NULL);
+}
+
 FM_DEFINE_MODULE(lxpanel_gtk, cpu)
 
 /* Plugin descriptor. */
@@ -310,4 +464,5 @@ LXPanelPluginInit fm_module_init_lxpanel_gtk = {
     .name = N_("CPU Usage Monitor"),
     .description = N_("Display CPU usage"),
     .new_instance = cpu_constructor,
+    .config = cpu_configure,
 };
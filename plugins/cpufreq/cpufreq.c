@@ -391,7 +391,7 @@ static GtkWidget *cpufreq_constructor(LXPanel *panel, config_setting_t *settings
     //config_setting_lookup_int(settings, "Frequency", &cf->cur_freq);
 
     _update_tooltip(cf);
-    cf->timer = g_timeout_add_seconds(2, update_tooltip, (gpointer)cf);
+    cf->timer = lxpanel_timer_add(cf->main, 2000, update_tooltip, (gpointer)cf);
 
     RET(cf->main);
 }
@@ -420,7 +420,7 @@ cpufreq_destructor(gpointer user_data)
     cpufreq *cf = (cpufreq *)user_data;
     g_list_free ( cf->cpus );
     g_list_free ( cf->governors );
-    g_source_remove(cf->timer);
+    lxpanel_timer_remove(cf->timer);
     g_free(cf);
 }
 
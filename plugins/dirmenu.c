@@ -24,8 +24,18 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <stdlib.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 
 #include <glib/gi18n.h>
 #include <libfm/fm-gtk.h>
@@ -34,13 +44,35 @@
 #include "misc.h"
 #include "plugin.h"
 
+/* Number of directories which scan results are kept. */
+#define DIRMENU_CACHE_SIZE 32
+
 /* Temporary for sort of directory names. */
-typedef struct _directory_name {
-    struct _directory_name * flink;
+typedef struct {
     char * directory_name;
     char * directory_name_collate_key;
 } DirectoryName;
 
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+# define STAT_MTIME_NSEC(st) ((st)->st_mtim.tv_nsec)
+#else
+# define STAT_MTIME_NSEC(st) 0L
+#endif
+
+/* Sorted subdirectories of a directory, cached until it changes. */
+typedef struct {
+    char * path;			/* Key in the cache */
+    char ** names;			/* Sorted display names */
+    guint n_names;
+    dev_t dev;				/* To recheck where inotify cannot */
+    ino_t ino;
+    time_t mtime;
+    long mtime_nsec;			/* 0 if not supported */
+    time_t scanned;			/* When the scan was started */
+    int wd;				/* inotify watch or -1 */
+    GList * link;			/* Position in LRU queue */
+} DirMenuCacheEntry;
+
 /* Private context for directory menu plugin. */
 typedef struct {
     LXPanel * panel; /* The panel and settings are required to apply config */
@@ -49,6 +81,10 @@ typedef struct {
     char * path;			/* Top level path for widget */
     char * name;			/* User's label for widget */
     GdkPixbuf * folder_icon;		/* Icon for folders */
+    GHashTable * cache;			/* Path -> DirMenuCacheEntry */
+    GQueue cache_lru;			/* Most recently used first */
+    int inotify_fd;			/* -1 if not opened yet or failed */
+    guint inotify_watch;
 } DirMenuPlugin;
 
 static GtkWidget * dirmenu_create_menu(DirMenuPlugin * dm, const char * path, gboolean open_at_top);
@@ -115,6 +151,220 @@ static void dirmenu_popup_set_position(GtkWidget * menu, gint * px, gint * py, g
     *push_in = TRUE;
 }
 
+/* Free a cache entry, called by the cache hash table. */
+static void dirmenu_cache_entry_free(DirMenuCacheEntry * entry)
+{
+    guint i;
+
+    for (i = 0; i < entry->n_names; i++)
+        g_free(entry->names[i]);
+    g_free(entry->names);
+    g_free(entry->path);
+    g_slice_free(DirMenuCacheEntry, entry);
+}
+
+/* Forget scan results of a directory. */
+static void dirmenu_cache_drop(DirMenuPlugin * dm, DirMenuCacheEntry * entry)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (entry->wd >= 0 && dm->inotify_fd >= 0)
+        inotify_rm_watch(dm->inotify_fd, entry->wd);
+#endif
+    g_queue_delete_link(&dm->cache_lru, entry->link);
+    g_hash_table_remove(dm->cache, entry->path);
+}
+
+static void dirmenu_cache_clear(DirMenuPlugin * dm)
+{
+    while (dm->cache_lru.head != NULL)
+        dirmenu_cache_drop(dm, dm->cache_lru.head->data);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+/* Handler for inotify events, drops the changed directory from the cache. */
+static gboolean dirmenu_inotify_event(GIOChannel * source, GIOCondition cond, DirMenuPlugin * dm)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event * ev;
+    DirMenuCacheEntry * entry;
+    ssize_t len;
+    char * p;
+    GList * l, * next;
+
+    if (cond & (G_IO_ERR | G_IO_HUP))
+    {
+        /* the directories may be still checked for modification time */
+        dirmenu_cache_clear(dm);
+        close(dm->inotify_fd);
+        dm->inotify_fd = -1;
+        dm->inotify_watch = 0;
+        return FALSE;
+    }
+    while ((len = read(dm->inotify_fd, buf, sizeof(buf))) > 0)
+    {
+        for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len)
+        {
+            ev = (const struct inotify_event *)p;
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                dirmenu_cache_clear(dm);
+                continue;
+            }
+            /* hidden entries aren't shown so they don't matter */
+            if (ev->len > 0 && ev->name[0] == '.')
+                continue;
+            /* the same directory may be cached under another path */
+            for (l = dm->cache_lru.head; l != NULL; l = next)
+            {
+                next = l->next;
+                entry = l->data;
+                if (entry->wd != ev->wd)
+                    continue;
+                if (ev->mask & IN_IGNORED)
+                    entry->wd = -1;
+                dirmenu_cache_drop(dm, entry);
+            }
+        }
+    }
+    return TRUE;
+}
+
+/* Start watching for changes in directory, returns watch descriptor. */
+static int dirmenu_watch_directory(DirMenuPlugin * dm, const char * path)
+{
+    if (dm->inotify_fd < 0)
+    {
+        GIOChannel * channel;
+
+        /* if it fails then modification time check is still done */
+        dm->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (dm->inotify_fd < 0)
+            return -1;
+        channel = g_io_channel_unix_new(dm->inotify_fd);
+        dm->inotify_watch = g_io_add_watch(channel, G_IO_IN | G_IO_ERR | G_IO_HUP,
+                                           (GIOFunc)dirmenu_inotify_event, dm);
+        g_io_channel_unref(channel);
+    }
+    return inotify_add_watch(dm->inotify_fd, path,
+                             IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                             IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+}
+#endif
+
+/* Test if directory entry is a directory, following symlinks like
+   g_file_test() does.  Only stat() it if readdir() didn't tell the type. */
+static gboolean dirmenu_entry_is_dir(DIR * dir, const struct dirent * de)
+{
+    struct stat st;
+
+#ifdef DT_UNKNOWN
+    if (de->d_type == DT_DIR)
+        return TRUE;
+    if (de->d_type != DT_UNKNOWN && de->d_type != DT_LNK)
+        return FALSE;
+#endif
+    return (fstatat(dirfd(dir), de->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode));
+}
+
+static gint dirmenu_compare_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(((const DirectoryName *)a)->directory_name_collate_key,
+                  ((const DirectoryName *)b)->directory_name_collate_key);
+}
+
+/* Scan directory into cache entry, collect names and sort them once. */
+static void dirmenu_scan_directory(DirMenuCacheEntry * entry)
+{
+    GArray * dir_list = g_array_new(FALSE, FALSE, sizeof(DirectoryName));
+    DirectoryName dir_name;
+    struct dirent * de;
+    DIR * dir;
+    guint i;
+
+    dir = opendir(entry->path);
+    if (dir != NULL)
+    {
+        while ((de = readdir(dir)) != NULL)
+        {
+            /* Omit hidden files. */
+            if (de->d_name[0] == '.' || !dirmenu_entry_is_dir(dir, de))
+                continue;
+            /* Convert name to UTF-8 and to the collation key. */
+            dir_name.directory_name = g_filename_display_name(de->d_name);
+            dir_name.directory_name_collate_key = g_utf8_collate_key(dir_name.directory_name, -1);
+            g_array_append_val(dir_list, dir_name);
+        }
+        closedir(dir);
+    }
+    g_array_sort(dir_list, dirmenu_compare_names);
+
+    /* Keep only names, they are owned by the entry now. */
+    entry->n_names = dir_list->len;
+    entry->names = g_new(char *, dir_list->len);
+    for (i = 0; i < dir_list->len; i++)
+    {
+        entry->names[i] = g_array_index(dir_list, DirectoryName, i).directory_name;
+        g_free(g_array_index(dir_list, DirectoryName, i).directory_name_collate_key);
+    }
+    g_array_free(dir_list, TRUE);
+}
+
+/* Get sorted subdirectories of path, either from cache or by scanning it.
+   The entry is owned by the cache, returns NULL if path can't be accessed. */
+static DirMenuCacheEntry * dirmenu_get_subdirectories(DirMenuPlugin * dm, const char * path)
+{
+    DirMenuCacheEntry * entry;
+    struct stat st;
+
+    if (stat(path, &st) < 0 || !S_ISDIR(st.st_mode))
+        return NULL;
+    if (dm->cache == NULL)
+        dm->cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                          (GDestroyNotify)dirmenu_cache_entry_free);
+    entry = g_hash_table_lookup(dm->cache, path);
+    if (entry != NULL)
+    {
+        /* inotify doesn't see changes made by other NFS clients and so on,
+           therefore compare the modification time as well. If it was
+           modified in the same second the scan started, then another change
+           in that second may have the same time on filesystems which keep
+           only seconds, so such an entry is not trusted. */
+        if (entry->dev == st.st_dev && entry->ino == st.st_ino &&
+            entry->mtime == st.st_mtime &&
+            entry->mtime_nsec == STAT_MTIME_NSEC(&st) &&
+            entry->mtime < entry->scanned)
+        {
+            g_queue_unlink(&dm->cache_lru, entry->link);
+            g_queue_push_head_link(&dm->cache_lru, entry->link);
+            return entry;
+        }
+        dirmenu_cache_drop(dm, entry);
+    }
+
+    entry = g_slice_new0(DirMenuCacheEntry);
+    entry->path = g_strdup(path);
+    entry->dev = st.st_dev;
+    entry->ino = st.st_ino;
+    entry->mtime = st.st_mtime;
+    entry->mtime_nsec = STAT_MTIME_NSEC(&st);
+    entry->scanned = time(NULL);
+    /* start watching before scan so no change is lost */
+#ifdef HAVE_SYS_INOTIFY_H
+    entry->wd = dirmenu_watch_directory(dm, path);
+#else
+    entry->wd = -1;
+#endif
+    dirmenu_scan_directory(entry);
+    g_hash_table_insert(dm->cache, entry->path, entry);
+    g_queue_push_head(&dm->cache_lru, entry);
+    entry->link = dm->cache_lru.head;
+
+    /* Drop least recently used entries. */
+    while (dm->cache_lru.length > DIRMENU_CACHE_SIZE)
+        dirmenu_cache_drop(dm, dm->cache_lru.tail->data);
+    return entry;
+}
+
 /* Create a menu populated with all subdirectories. */
 static GtkWidget * dirmenu_create_menu(DirMenuPlugin * dm, const char * path, gboolean open_at_top)
 {
@@ -135,72 +385,20 @@ static GtkWidget * dirmenu_create_menu(DirMenuPlugin * dm, const char * path, gb
 
     g_object_set_data_full(G_OBJECT(menu), "path", g_strdup(path), g_free);
 
-    /* Scan the specified directory to populate the menu with its subdirectories. */
-    DirectoryName * dir_list = NULL;
-    GDir * dir = g_dir_open(path, 0, NULL);
-    if (dir != NULL)
-    {
-        const char * name;
-        while ((name = g_dir_read_name(dir)) != NULL)	/* Memory owned by glib */
-        {
-            /* Omit hidden files. */
-            if (name[0] != '.')
-            {
-                char * full = g_build_filename(path, name, NULL);
-                if (g_file_test(full, G_FILE_TEST_IS_DIR))
-                {
-                    /* Convert name to UTF-8 and to the collation key. */
-                    char * directory_name = g_filename_display_name(name);
-                    char * directory_name_collate_key = g_utf8_collate_key(directory_name, -1);
-
-                    /* Locate insertion point. */
-                    DirectoryName * dir_pred = NULL;
-                    DirectoryName * dir_cursor;
-                    for (dir_cursor = dir_list; dir_cursor != NULL; dir_pred = dir_cursor, dir_cursor = dir_cursor->flink)
-                    {
-                        if (strcmp(directory_name_collate_key, dir_cursor->directory_name_collate_key) <= 0)
-                            break;
-                    }
-
-                    /* Allocate and initialize sorted directory name entry. */
-                    dir_cursor = g_new0(DirectoryName, 1);
-                    dir_cursor->directory_name = directory_name;
-                    dir_cursor->directory_name_collate_key = directory_name_collate_key;
-                    if (dir_pred == NULL)
-                    {
-                        dir_cursor->flink = dir_list;
-                        dir_list = dir_cursor;
-                    }
-                    else
-                    {
-                        dir_cursor->flink = dir_pred->flink;
-                        dir_pred->flink = dir_cursor;
-                    }
-                }
-                g_free(full);
-            }
-        }
-        g_dir_close(dir);
-    }
-
-    /* The sorted directory name list is complete.  Loop to create the menu. */
-    DirectoryName * dir_cursor;
-    while ((dir_cursor = dir_list) != NULL)
+    /* Populate the menu with subdirectories of the specified directory. */
+    DirMenuCacheEntry * entry = dirmenu_get_subdirectories(dm, path);
+    guint i;
+    for (i = 0; entry != NULL && i < entry->n_names; i++)
     {
         /* Create and initialize menu item. */
-        GtkWidget * item = gtk_image_menu_item_new_with_label(dir_cursor->directory_name);
+        GtkWidget * item = gtk_image_menu_item_new_with_label(entry->names[i]);
         gtk_image_menu_item_set_image(
             GTK_IMAGE_MENU_ITEM(item),
             gtk_image_new_from_stock(GTK_STOCK_DIRECTORY, GTK_ICON_SIZE_MENU));
         GtkWidget * dummy = gtk_menu_new();
         gtk_menu_item_set_submenu(GTK_MENU_ITEM(item), dummy);
         gtk_menu_shell_append(GTK_MENU_SHELL(menu), item);
-
-        /* Unlink and free sorted directory name element, but reuse the directory name string. */
-        dir_list = dir_cursor->flink;
-        g_object_set_data_full(G_OBJECT(item), "name", dir_cursor->directory_name, g_free);
-        g_free(dir_cursor->directory_name_collate_key);
-        g_free(dir_cursor);
+        g_object_set_data_full(G_OBJECT(item), "name", g_strdup(entry->names[i]), g_free);
 
         /* Connect signals. */
         g_signal_connect(G_OBJECT(item), "select", G_CALLBACK(dirmenu_menuitem_select), dm);
@@ -281,6 +479,7 @@ static GtkWidget *dirmenu_constructor(LXPanel *panel, config_setting_t *settings
         dm->path = g_strdup(fm_get_home_dir());
     if (config_setting_lookup_string(settings, "name", &str))
         dm->name = g_strdup(str);
+    dm->inotify_fd = -1;
 
     /* Save construction pointers */
     dm->panel = panel;
@@ -313,6 +512,17 @@ static void dirmenu_destructor(gpointer user_data)
     if (dm->folder_icon)
         g_object_unref(dm->folder_icon);
 
+    /* Drop cached directory contents and stop watching them. */
+    if (dm->cache != NULL)
+    {
+        dirmenu_cache_clear(dm);
+        g_hash_table_destroy(dm->cache);
+    }
+    if (dm->inotify_watch != 0)
+        g_source_remove(dm->inotify_watch);
+    if (dm->inotify_fd >= 0)
+        close(dm->inotify_fd);
+
     /* Deallocate all memory. */
     g_free(dm->image);
     g_free(dm->path);
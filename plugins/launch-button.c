@@ -36,13 +36,36 @@ struct _LaunchButton
     FmJob * job;                        /* Async job to retrieve file info */
     FmFileInfo * fi;                    /* Launcher application descriptor */
     config_setting_t * settings;        /* Button settings */
+    struct LaunchButtonBatch * batch;   /* Batch which will load file info */
+    FmPath * batch_path;                /* Path to load in the batch */
 };
 
+/* Collection of buttons which file infos are loaded by single job */
+typedef struct LaunchButtonBatch
+{
+    FmFileInfoJob * job;
+    GPtrArray * buttons;                /* Buttons waiting for the job */
+    guint refcount;                     /* Nesting of batch_begin() */
+    LaunchButtonFailedFunc failed_func; /* Called for buttons without info */
+    gpointer failed_data;
+} LaunchButtonBatch;
 
-static void launch_button_job_finished(FmJob *job, LaunchButton *self)
+/* Batch which is being filled now */
+static LaunchButtonBatch *batch_pending = NULL;
+
+
+static void launch_button_set_file_info(LaunchButton *self)
 {
     GtkWidget *image;
 
+    image = lxpanel_image_new_for_fm_icon(self->panel, fm_file_info_get_icon(self->fi),
+                                          -1, NULL);
+    lxpanel_button_compose(GTK_WIDGET(self), image, NULL, NULL);
+    gtk_widget_set_tooltip_text(GTK_WIDGET(self), fm_file_info_get_disp_name(self->fi));
+}
+
+static void launch_button_job_finished(FmJob *job, LaunchButton *self)
+{
     if (self->job == NULL)
         return; // duplicate call? seems a bug in libfm
 
@@ -63,10 +86,49 @@ static void launch_button_job_finished(FmJob *job, LaunchButton *self)
         g_warning("launchbar: desktop entry does not exist");
         return;
     }
-    image = lxpanel_image_new_for_fm_icon(self->panel, fm_file_info_get_icon(self->fi),
-                                          -1, NULL);
-    lxpanel_button_compose(GTK_WIDGET(self), image, NULL, NULL);
-    gtk_widget_set_tooltip_text(GTK_WIDGET(self), fm_file_info_get_disp_name(self->fi));
+    launch_button_set_file_info(self);
+}
+
+static void launch_button_batch_finished(FmJob *job, LaunchButtonBatch *batch)
+{
+    GHashTable *infos;
+    FmFileInfo *fi;
+    LaunchButton *btn;
+    GList *l;
+    guint i;
+
+    /* index results, some paths may be failed and have no info */
+    infos = g_hash_table_new((GHashFunc)fm_path_hash, (GEqualFunc)fm_path_equal);
+    for (l = fm_file_info_list_peek_head_link(batch->job->file_infos); l; l = l->next)
+        g_hash_table_insert(infos, fm_file_info_get_path(l->data), l->data);
+    for (i = 0; i < batch->buttons->len; i++)
+    {
+        btn = g_ptr_array_index(batch->buttons, i);
+        fi = g_hash_table_lookup(infos, btn->batch_path);
+        btn->batch = NULL;
+        fm_path_unref(btn->batch_path);
+        btn->batch_path = NULL;
+        if (fi == NULL)
+        {
+            g_warning("launchbar: desktop entry does not exist");
+            /* same as launch_button_wait_load() does for a failed button */
+            if (batch->failed_func)
+                batch->failed_func(btn, batch->failed_data);
+            else
+            {
+                if (btn->settings)
+                    config_setting_destroy(btn->settings);
+                gtk_widget_destroy(GTK_WIDGET(btn));
+            }
+            continue;
+        }
+        btn->fi = fm_file_info_ref(fi);
+        launch_button_set_file_info(btn);
+    }
+    g_hash_table_destroy(infos);
+    g_ptr_array_free(batch->buttons, TRUE);
+    g_object_unref(batch->job);
+    g_slice_free(LaunchButtonBatch, batch);
 }
 
 
@@ -88,6 +150,15 @@ static void launch_button_dispose(GObject *object)
         self->job = NULL;
     }
 
+    if (self->batch)
+    {
+        /* the batch job continues for other buttons */
+        g_ptr_array_remove_fast(self->batch->buttons, self);
+        self->batch = NULL;
+        fm_path_unref(self->batch_path);
+        self->batch_path = NULL;
+    }
+
     if (self->fi)
     {
         fm_file_info_unref(self->fi);
@@ -103,7 +174,7 @@ static gboolean launch_button_release_event(GtkWidget *widget, GdkEventButton *e
 
     if (event->button == 1) /* left button */
     {
-        if (btn->job) /* The job is still running */
+        if (btn->job || btn->batch) /* The job is still running */
             ;
         else if (btn->fi == NULL)  /* The bootstrap button */
             lxpanel_plugin_show_config_dialog(btn->plugin);
@@ -154,6 +225,16 @@ LaunchButton *launch_button_new(LXPanel *panel, GtkWidget *plugin, FmPath *id,
     {
         /* g_debug("LaunchButton: trying file %s in scheme %s", fm_path_get_basename(id),
                 fm_path_get_basename(fm_path_get_scheme_path(id))); */
+        if (batch_pending != NULL && (fm_path_is_native(id) ||
+            strncmp(fm_path_get_basename(fm_path_get_scheme_path(id)), "search:", 7) != 0))
+        {
+            /* file info will be loaded with others by launch_button_batch_end() */
+            fm_file_info_job_add(batch_pending->job, id);
+            g_ptr_array_add(batch_pending->buttons, self);
+            self->batch = batch_pending;
+            self->batch_path = fm_path_ref(id);
+            return self;
+        }
         if (fm_path_is_native(id) ||
             strncmp(fm_path_get_basename(fm_path_get_scheme_path(id)), "search:", 7) != 0)
         {
@@ -222,9 +303,10 @@ void launch_button_set_settings(LaunchButton *btn, config_setting_t *settings)
  *
  * If @btn does not have pending file info then returns. Otherwise waits
  * for it. If loading the info failed then destroys @btn and associated
- * settings.
+ * settings. A button loaded by a batch job is not waited for, it will be
+ * filled in when the batch job is finished.
  *
- * Returns: %TRUE if button is fully loaded.
+ * Returns: %TRUE if button is fully loaded or is loaded by a batch job.
  *
  * Since: 0.9.0
  */
@@ -240,3 +322,67 @@ gboolean launch_button_wait_load(LaunchButton *btn)
     gtk_widget_destroy(GTK_WIDGET(btn));
     return FALSE;
 }
+
+/**
+ * launch_button_batch_begin
+ * @failed_func: (allow-none): function to call for a button which file
+ * info cannot be retrieved
+ * @user_data: data to pass to @failed_func
+ *
+ * Starts collecting buttons created by launch_button_new() so their
+ * file infos will be retrieved by single job instead of a job for each
+ * button. Buttons which ids are searched in the menu still use own jobs.
+ * Calls may be nested, each call should be paired with a call to
+ * launch_button_batch_end(). Only @failed_func of the outermost call is
+ * used.
+ *
+ * If retrieving file info of a button failed then @failed_func is called
+ * for it and should destroy the button. If @failed_func is %NULL then
+ * the button and its settings are destroyed as launch_button_wait_load()
+ * does.
+ */
+void launch_button_batch_begin(LaunchButtonFailedFunc failed_func, gpointer user_data)
+{
+    if (batch_pending == NULL)
+    {
+        batch_pending = g_slice_new(LaunchButtonBatch);
+        batch_pending->job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_NONE);
+        batch_pending->buttons = g_ptr_array_new();
+        batch_pending->refcount = 0;
+        batch_pending->failed_func = failed_func;
+        batch_pending->failed_data = user_data;
+    }
+    batch_pending->refcount++;
+}
+
+/**
+ * launch_button_batch_end
+ *
+ * Finishes collecting buttons started by launch_button_batch_begin() and
+ * starts the job asynchronously. Buttons are filled when the job is done.
+ */
+void launch_button_batch_end(void)
+{
+    LaunchButtonBatch *batch = batch_pending;
+
+    g_return_if_fail(batch != NULL);
+    if (--batch->refcount > 0)
+        return;
+    batch_pending = NULL;
+    if (batch->buttons->len == 0)
+    {
+        /* nothing to do */
+        launch_button_batch_finished(FM_JOB(batch->job), batch);
+        return;
+    }
+    g_signal_connect(batch->job, "finished",
+                     G_CALLBACK(launch_button_batch_finished), batch);
+    if (!fm_job_run_async(FM_JOB(batch->job)))
+    {
+        g_warning("launchbar: problem running file info job");
+        g_signal_handlers_disconnect_by_func(batch->job,
+                                             launch_button_batch_finished, batch);
+        /* job results are empty, so all buttons will be handled as failed */
+        launch_button_batch_finished(FM_JOB(batch->job), batch);
+    }
+}
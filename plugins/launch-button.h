@@ -45,6 +45,8 @@ struct _LaunchButtonClass
     GtkEventBoxClass parent_class;
 };
 
+typedef void (*LaunchButtonFailedFunc)(LaunchButton *btn, gpointer user_data);
+
 /* creates new button */
 LaunchButton *launch_button_new(LXPanel *panel, GtkWidget *plugin, FmPath *path, config_setting_t *settings);
 FmFileInfo *launch_button_get_file_info(LaunchButton *btn);
@@ -53,6 +55,8 @@ FmIcon *launch_button_get_icon(LaunchButton *btn);
 config_setting_t *launch_button_get_settings(LaunchButton *btn);
 void launch_button_set_settings(LaunchButton *btn, config_setting_t *settings);
 gboolean launch_button_wait_load(LaunchButton *btn);
+void launch_button_batch_begin(LaunchButtonFailedFunc failed_func, gpointer user_data);
+void launch_button_batch_end(void);
 
 G_END_DECLS
 
@@ -61,6 +61,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
@@ -78,8 +79,10 @@
 #include "ev.h"
 #include "plugin.h"
 #include "task-button.h"
+#include "task-client-list.h"
 #include "launch-button.h"
 #include "icon-grid.h"
+#include "icon-cache.h"
 #ifndef DISABLE_MENU
 # include "menu-policy.h"
 #endif
@@ -117,6 +120,8 @@ struct LaunchTaskBarPlugin {
     int drag_start_x, drag_start_y; /* Drag start coordinates */
     /* TASKBAR */
     GtkWidget * tb_icon_grid;      /* Manager for taskbar buttons */
+    GHashTable *tb_windows;        /* Index of windows: Window -> TaskButton */
+    GHashTable *tb_clients;        /* Set of windows from last NET_CLIENT_LIST */
     int number_of_desktops;        /* Number of desktops, from NET_WM_NUMBER_OF_DESKTOPS */
     int current_desktop;           /* Current desktop, from NET_WM_CURRENT_DESKTOP */
     guint dnd_delay_timer;         /* Timer for drag and drop delay */
@@ -132,6 +137,15 @@ struct LaunchTaskBarPlugin {
     /* COMMON */
 #ifndef DISABLE_MENU
     FmPath * path;              /* Current menu item path */
+    MenuCache *mc;              /* Menu cache used to find launchers of tasks */
+    gpointer mc_reload;         /* Reload notification of mc */
+    GSList *mc_apps;            /* Applications referenced by indexes below */
+    GHashTable *idx_id;         /* Index: desktop id basename -> MenuCacheItem */
+    GHashTable *idx_exec;       /* Index: short exec name -> MenuCacheItem */
+    GHashTable *idx_abs_exec;   /* Index: absolute exec path -> MenuCacheItem */
+    GHashTable *tb_launchers;   /* Resolved launchers: Window -> FmPath or NULL */
+    GHashTable *tb_procs;       /* Process info cache: pid -> TaskProcInfo */
+    guint tb_procs_limit;       /* Size of tb_procs to check for dead processes */
     GtkWidget       *p_menuitem_lock_tbp;
     GtkWidget       *p_menuitem_unlock_tbp;
     GtkWidget       *p_menuitem_new_instance;
@@ -188,116 +202,278 @@ static void taskbar_add_task_button(LaunchTaskBarPlugin * tb, TaskButton * task)
 
 
 #ifndef DISABLE_MENU
-static char *task_get_cmdline(Window win, LaunchTaskBarPlugin *ltbp)
+/* Process data, shared by all windows of the process */
+typedef struct {
+    guint64 start_time;         /* Start time from /proc/<pid>/stat, to detect PID reuse */
+    char *cmdline;              /* argv[0] of the process */
+    char *comm;                 /* Name from /proc/<pid>/comm */
+    char *exe;                  /* Target of /proc/<pid>/exe, may be NULL */
+    char *exec_bin;             /* Executable name to search launcher for */
+} TaskProcInfo;
+
+#define TASK_PROCS_LIMIT 64     /* Initial limit before checking for dead processes */
+
+static void task_proc_info_free(gpointer data)
+{
+    TaskProcInfo *info = data;
+
+    g_free(info->cmdline);
+    g_free(info->comm);
+    g_free(info->exe);
+    g_free(info->exec_bin);
+    g_slice_free(TaskProcInfo, info);
+}
+
+/* Get start time of process, it is the 22nd field of /proc/<pid>/stat */
+static gboolean task_proc_start_time(GPid pid, guint64 *start_time)
+{
+    char buf[512];
+    char *p, *end;
+    ssize_t len;
+    int fd, i;
+
+    snprintf(buf, sizeof(buf), "/proc/%lu/stat", (gulong)pid);
+    fd = open(buf, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return FALSE;
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return FALSE;
+    buf[len] = '\0';
+    /* process name may contain spaces and parentheses, skip it */
+    p = strrchr(buf, ')');
+    if (p == NULL)
+        return FALSE;
+    /* we are at the end of 2nd field, skip to the 22nd */
+    for (i = 2; i < 22 && p != NULL; i++)
+        p = strchr(p + 1, ' ');
+    if (p == NULL)
+        return FALSE;
+    *start_time = g_ascii_strtoull(p + 1, &end, 10);
+    return (end != p + 1);
+}
+
+static gchar *task_proc_read_line(GPid pid, const char *name)
 {
-    GPid pid = get_net_wm_pid(win);
     char proc_path[64];
-    gchar *cmdline = NULL;
-    gchar *p_char = NULL;
+    gchar *contents = NULL;
+    gchar *p_char;
 
     snprintf(proc_path, sizeof(proc_path),
-             G_DIR_SEPARATOR_S "proc" G_DIR_SEPARATOR_S "%lu" G_DIR_SEPARATOR_S "cmdline",
-             (gulong)pid);
-    g_file_get_contents(proc_path, &cmdline, NULL, NULL);
-    if (cmdline)
+             G_DIR_SEPARATOR_S "proc" G_DIR_SEPARATOR_S "%lu" G_DIR_SEPARATOR_S "%s",
+             (gulong)pid, name);
+    g_file_get_contents(proc_path, &contents, NULL, NULL);
+    if (contents)
     {
-        p_char = strchr(cmdline, '\n');
+        p_char = strchr(contents, '\n');
         if(p_char != NULL) *p_char = '\0';
-        p_char = strrchr(cmdline, G_DIR_SEPARATOR);
-        if (p_char != NULL) p_char++;
-        else p_char = cmdline;
-        if(strcmp(p_char, "python") == 0)
-        {
-            snprintf(proc_path, sizeof(proc_path),
-                     G_DIR_SEPARATOR_S "proc" G_DIR_SEPARATOR_S "%lu" G_DIR_SEPARATOR_S "comm",
-                     (gulong)pid);
-            g_free(cmdline);
-            cmdline = NULL;
-            g_file_get_contents(proc_path, &cmdline, NULL, NULL);
-            if (cmdline)
-            {
-                p_char = strchr(cmdline, '\n');
-                if(p_char != NULL) *p_char = '\0';
-            }
-        }
-        else
-        {
-            p_char = g_key_file_get_string(ltbp->p_key_file_special_cases,
-                                           "special_cases", p_char, NULL);
-            if (p_char != NULL) /* found this key */
-            {
-                g_free(cmdline);
-                cmdline = p_char;
-            }
-        }
     }
-    return cmdline;
+    return contents;
 }
 
-static FmPath *f_find_menu_launchbutton_recursive(Window win, LaunchTaskBarPlugin *ltbp)
+static TaskProcInfo *task_proc_info_new(GPid pid, guint64 start_time, LaunchTaskBarPlugin *ltbp)
+{
+    TaskProcInfo *info = g_slice_new0(TaskProcInfo);
+    char proc_path[64];
+    const gchar *p_char;
+
+    info->start_time = start_time;
+    info->cmdline = task_proc_read_line(pid, "cmdline");
+    info->comm = task_proc_read_line(pid, "comm");
+    snprintf(proc_path, sizeof(proc_path),
+             G_DIR_SEPARATOR_S "proc" G_DIR_SEPARATOR_S "%lu" G_DIR_SEPARATOR_S "exe",
+             (gulong)pid);
+    info->exe = g_file_read_link(proc_path, NULL);
+    if (info->cmdline == NULL)
+        return info;
+    if (info->cmdline[0] == '\0' && info->exe != NULL)
+    {
+        /* process has cleared its arguments, use the executable instead */
+        g_free(info->cmdline);
+        info->cmdline = g_strdup(info->exe);
+    }
+    p_char = strrchr(info->cmdline, G_DIR_SEPARATOR);
+    if (p_char != NULL) p_char++;
+    else p_char = info->cmdline;
+    if(strcmp(p_char, "python") == 0)
+        info->exec_bin = g_strdup(info->comm);
+    else
+    {
+        info->exec_bin = g_key_file_get_string(ltbp->p_key_file_special_cases,
+                                               "special_cases", p_char, NULL);
+        if (info->exec_bin == NULL) /* not found this key */
+            info->exec_bin = g_strdup(info->cmdline);
+    }
+    return info;
+}
+
+/* Drop info of processes which are gone. */
+static void task_proc_info_prune(LaunchTaskBarPlugin *ltbp)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    guint64 start_time;
+
+    g_hash_table_iter_init(&iter, ltbp->tb_procs);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        if (!task_proc_start_time(GPOINTER_TO_INT(key), &start_time) ||
+            start_time != ((TaskProcInfo *)value)->start_time)
+            g_hash_table_iter_remove(&iter);
+    ltbp->tb_procs_limit = MAX(TASK_PROCS_LIMIT, 2 * g_hash_table_size(ltbp->tb_procs));
+}
+
+static char *task_get_cmdline(Window win, LaunchTaskBarPlugin *ltbp)
+{
+    GPid pid = get_net_wm_pid(win);
+    TaskProcInfo *info;
+    guint64 start_time;
+
+    if (pid <= 0 || !task_proc_start_time(pid, &start_time))
+        return NULL;
+    if (ltbp->tb_procs == NULL)
+    {
+        ltbp->tb_procs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, task_proc_info_free);
+        ltbp->tb_procs_limit = TASK_PROCS_LIMIT;
+    }
+    info = g_hash_table_lookup(ltbp->tb_procs, GINT_TO_POINTER(pid));
+    /* if start time differs then PID was reused by another process */
+    if (info == NULL || info->start_time != start_time)
+    {
+        if (info == NULL && g_hash_table_size(ltbp->tb_procs) >= ltbp->tb_procs_limit)
+            task_proc_info_prune(ltbp);
+        info = task_proc_info_new(pid, start_time, ltbp);
+        g_hash_table_replace(ltbp->tb_procs, GINT_TO_POINTER(pid), info);
+    }
+    return g_strdup(info->exec_bin);
+}
+
+/* Drop indexes and resolved launchers, they will be rebuilt on demand. */
+static void launchtaskbar_exec_index_free(LaunchTaskBarPlugin *ltbp)
+{
+    if (ltbp->idx_id)
+    {
+        g_hash_table_destroy(ltbp->idx_id);
+        g_hash_table_destroy(ltbp->idx_exec);
+        g_hash_table_destroy(ltbp->idx_abs_exec);
+        ltbp->idx_id = ltbp->idx_exec = ltbp->idx_abs_exec = NULL;
+    }
+    g_slist_foreach(ltbp->mc_apps, (GFunc)menu_cache_item_unref, NULL);
+    g_slist_free(ltbp->mc_apps);
+    ltbp->mc_apps = NULL;
+    if (ltbp->tb_launchers)
+        g_hash_table_remove_all(ltbp->tb_launchers);
+}
+
+static void on_exec_index_reload(MenuCache *mc, gpointer user_data)
+{
+    launchtaskbar_exec_index_free(user_data);
+}
+
+/* Add key into index unless it is there already, so the first application
+   in the list wins, as it was with linear search. */
+static inline void exec_index_add(GHashTable *idx, const char *key, gsize len,
+                                  MenuCacheItem *item)
+{
+    char *str = g_strndup(key, len);
+
+    if (g_hash_table_lookup(idx, str) == NULL)
+        g_hash_table_insert(idx, str, item);
+    else
+        g_free(str);
+}
+
+static void launchtaskbar_exec_index_build(LaunchTaskBarPlugin *ltbp)
 {
-    MenuCache *mc;
+    GSList *l;
+    const char *id, *exec, *end;
     guint32 flags;
-    GSList *apps, *l;
-    size_t len;
-    char *exec_bin = task_get_cmdline(win, ltbp);
-    const char *exec, *short_exec;
+
+    if (ltbp->mc == NULL)
+    {
+        ltbp->mc = panel_menu_cache_new(&flags);
+        if (ltbp->mc == NULL)
+            return;
+        ltbp->mc_reload = menu_cache_add_reload_notify(ltbp->mc, on_exec_index_reload, ltbp);
+    }
+    ltbp->idx_id = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    ltbp->idx_exec = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    ltbp->idx_abs_exec = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    /* if menu cache isn't loaded yet we'll get NULL list here, the index
+       will be rebuilt after reload notification then */
+    ltbp->mc_apps = menu_cache_list_all_apps(ltbp->mc);
+    for (l = ltbp->mc_apps; l; l = l->next)
+    {
+        /* desktop id with any suffix after a dot, such as "app.desktop"
+           or "org.app.desktop", may be matched by the executable name.
+           We don't check flags here because user always can manually
+           start any app that isn't visible in the desktop menu */
+        id = menu_cache_item_get_id(MENU_CACHE_ITEM(l->data));
+        for (end = strchr(id, '.'); end; end = strchr(end + 1, '.'))
+            exec_index_add(ltbp->idx_id, id, end - id, l->data);
+        /* exec name is matched up to the first argument */
+        exec = menu_cache_app_get_exec(MENU_CACHE_APP(l->data));
+        if (exec == NULL)
+            continue;
+        end = strchr(exec, ' ');
+        if (end == NULL)
+            end = exec + strlen(exec);
+        exec_index_add(exec[0] == '/' ? ltbp->idx_abs_exec : ltbp->idx_exec,
+                       exec, end - exec, l->data);
+    }
+}
+
+static FmPath *f_find_menu_launchbutton_recursive(Window win, LaunchTaskBarPlugin *ltbp)
+{
+    char *exec_bin;
+    const char *short_exec;
     char *str_path;
+    MenuCacheItem *item = NULL;
     FmPath *path = NULL;
 
-    /* FIXME: cache it in Task object */
-    mc = panel_menu_cache_new(&flags);
-    /* FIXME: if menu plugin wasn't loaded yet we'll get NULL list here */
-    apps = menu_cache_list_all_apps(mc);
+    /* the same window always maps to the same launcher until menu is reloaded */
+    if (ltbp->tb_launchers == NULL)
+        ltbp->tb_launchers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                                   (GDestroyNotify)fm_path_unref);
+    else if (g_hash_table_lookup_extended(ltbp->tb_launchers, GUINT_TO_POINTER(win),
+                                          NULL, (gpointer *)&path))
+        return path ? fm_path_ref(path) : NULL;
+
+    if (ltbp->idx_id == NULL)
+        launchtaskbar_exec_index_build(ltbp);
+    if (ltbp->idx_id == NULL)
+        return NULL;
+
+    exec_bin = task_get_cmdline(win, ltbp);
+    if (exec_bin == NULL)
+        return NULL;
     short_exec = strrchr(exec_bin, '/');
     if (short_exec != NULL)
         short_exec++;
     else
         short_exec = exec_bin;
-    len = strlen(short_exec);
     /* the same executable may be used in numerous applications so wild guess
        estimation check for desktop id equal to short_exec+".desktop" first */
-    for (l = apps; l; l = l->next)
-    {
-        exec = menu_cache_item_get_id(MENU_CACHE_ITEM(l->data));
-        /* we don't check flags here because user always can manually
-           start any app that isn't visible in the desktop menu */
-        if (strncmp(exec, short_exec, len) == 0 && exec[len] == '.')
-            break;
-    }
+    item = g_hash_table_lookup(ltbp->idx_id, short_exec);
     /* if not found then check for non-absolute exec name in application
        since it usually is expanded by application starting functions */
-    if (l == NULL) for (l = apps; l; l = l->next)
-    {
-        exec = menu_cache_app_get_exec(MENU_CACHE_APP(l->data));
-        if (exec && exec[0] != '/' && strncmp(exec, short_exec, len) == 0 &&
-            (exec[len] == ' ' || exec[len] == 0))
-            break;
-    }
+    if (item == NULL)
+        item = g_hash_table_lookup(ltbp->idx_exec, short_exec);
     /* well, not matched, let try full path, we assume here if application
        starts executable by full path then process cannot have short name */
-    if (l == NULL && exec_bin[0] == '/')
-    {
-        len = strlen(exec_bin);
-        for (l = apps; l; l = l->next)
-        {
-            exec = menu_cache_app_get_exec(MENU_CACHE_APP(l->data));
-            if (exec && exec[0] == '/' && strncmp(exec, exec_bin, len) == 0 &&
-                (exec[len] == ' ' || exec[len] == 0))
-                break;
-        }
-    }
-    if (l)
+    if (item == NULL && exec_bin[0] == '/')
+        item = g_hash_table_lookup(ltbp->idx_abs_exec, exec_bin);
+    if (item)
     {
-        str_path = menu_cache_dir_make_path(MENU_CACHE_DIR(l->data));
+        str_path = menu_cache_dir_make_path(MENU_CACHE_DIR(item));
         path = fm_path_new_relative(fm_path_get_apps_menu(), str_path+13); /* skip /Applications */
         g_free(str_path);
     }
-    g_slist_foreach(apps, (GFunc)menu_cache_item_unref, NULL);
-    g_slist_free(apps);
-    menu_cache_unref(mc);
     g_debug("f_find_menu_launchbutton_recursive: search '%s' found=%d", exec_bin, (path != NULL));
     g_free(exec_bin);
+    g_hash_table_insert(ltbp->tb_launchers, GUINT_TO_POINTER(win),
+                        path ? fm_path_ref(path) : NULL);
     return path;
 }
 #endif
@@ -473,7 +649,7 @@ static void on_launchbar_drag_begin(GtkWidget *widget, GdkDragContext *context,
             gint w;
             GdkPixbuf *pix;
             gtk_icon_size_lookup(GTK_ICON_SIZE_DND, &w, NULL);
-            pix = fm_pixbuf_from_icon(icon, w);
+            pix = lxpanel_icon_cache_load(icon, w, NULL);
             if (pix)
             {
                 gtk_drag_set_icon_pixbuf(context, pix, 0, 0);
@@ -860,6 +1036,31 @@ static gboolean _launchbutton_create_id(LaunchTaskBarPlugin * lb, config_setting
     return FALSE;
 }
 
+/* Called when the batch job could not retrieve file info for a button. */
+static void launchbutton_load_failed(LaunchButton *btn, LaunchTaskBarPlugin *lb)
+{
+    config_setting_t *s = launch_button_get_settings(btn);
+    PanelIconGrid *ig = PANEL_ICON_GRID(lb->lb_icon_grid);
+    gint pos = panel_icon_grid_get_child_position(ig, GTK_WIDGET(btn));
+    GList *children;
+
+    gtk_widget_destroy(GTK_WIDGET(btn));
+    /* try to create desktop id from old-style manual setup */
+    if (s != NULL && _launchbutton_create_id(lb, s))
+    {
+        /* the new button was appended, put it where the failed one was */
+        children = gtk_container_get_children(GTK_CONTAINER(ig));
+        panel_icon_grid_reorder_child(ig, g_list_last(children)->data, pos);
+        g_list_free(children);
+    }
+    else if (s != NULL)
+    {
+        g_warning( "launchtaskbar: can't init button\n");
+        config_setting_destroy(s);
+    }
+    launchbar_check_bootstrap(lb);
+}
+
 static void launchtaskbar_constructor_add_default_special_case(LaunchTaskBarPlugin *ltbp, const gchar *tk_exec, const gchar *mb_exec)
 {
     g_key_file_set_value(ltbp->p_key_file_special_cases, "special_cases", tk_exec, mb_exec);
@@ -879,6 +1080,9 @@ static void launchtaskbar_constructor_launch(LaunchTaskBarPlugin *ltbp)
         {
             config_setting_t *s;
 
+            /* retrieve file infos of all buttons at once */
+            launch_button_batch_begin((LaunchButtonFailedFunc)launchbutton_load_failed,
+                                      ltbp);
             while ((s = config_setting_get_elem(settings, i)) != NULL)
             {
                 if (strcmp(config_setting_get_name(s), "Button") != 0)
@@ -897,6 +1101,7 @@ static void launchtaskbar_constructor_launch(LaunchTaskBarPlugin *ltbp)
                 else /* success, accept the setting */
                     i++;
             }
+            launch_button_batch_end();
         }
         if (i == 0)
         {
@@ -1038,12 +1243,16 @@ static void launchtaskbar_constructor_task(LaunchTaskBarPlugin *ltbp)
         gtk_box_pack_start(GTK_BOX(ltbp->plugin), ltbp->tb_icon_grid, TRUE, TRUE, 0);
         /* taskbar_update_style(ltbp); */
 
+        /* Index of windows for fast lookup on X events */
+        ltbp->tb_windows = task_button_window_index_new();
+        ltbp->tb_clients = g_hash_table_new(g_direct_hash, g_direct_equal);
+
         /* Add GDK event filter. */
         gdk_window_add_filter(NULL, (GdkFilterFunc) taskbar_event_filter, ltbp);
 
         /* Connect signals to receive root window events and initialize root window properties. */
-        ltbp->number_of_desktops = get_net_number_of_desktops();
-        ltbp->current_desktop = get_net_current_desktop();
+        ltbp->number_of_desktops = fb_ev_number_of_desktops(fbev);
+        ltbp->current_desktop = fb_ev_current_desktop(fbev);
         g_signal_connect(G_OBJECT(fbev), "current-desktop", G_CALLBACK(taskbar_net_current_desktop), (gpointer) ltbp);
         g_signal_connect(G_OBJECT(fbev), "active-window", G_CALLBACK(taskbar_net_active_window), (gpointer) ltbp);
         g_signal_connect(G_OBJECT(fbev), "number-of-desktops", G_CALLBACK(taskbar_net_number_of_desktops), (gpointer) ltbp);
@@ -1206,6 +1415,13 @@ static void launchtaskbar_destructor_task(LaunchTaskBarPlugin *ltbp)
 #ifndef DISABLE_MENU
     if (ltbp->path)
         fm_path_unref(ltbp->path);
+    ltbp->path = NULL;
+    if (ltbp->tb_launchers)
+        g_hash_table_destroy(ltbp->tb_launchers);
+    ltbp->tb_launchers = NULL;
+    if (ltbp->tb_procs)
+        g_hash_table_destroy(ltbp->tb_procs);
+    ltbp->tb_procs = NULL;
 #endif
 
     /* DND delay handler */
@@ -1216,6 +1432,10 @@ static void launchtaskbar_destructor_task(LaunchTaskBarPlugin *ltbp)
     }
     if (ltbp->dnd_delay_task)
         g_object_remove_weak_pointer(G_OBJECT(ltbp->dnd_delay_task), (gpointer *)&ltbp->dnd_delay_task);
+
+    /* buttons hold own references on the index */
+    g_hash_table_unref(ltbp->tb_windows);
+    g_hash_table_destroy(ltbp->tb_clients);
 }
 
 /* Plugin destructor. */
@@ -1230,6 +1450,14 @@ static void launchtaskbar_destructor(gpointer user_data)
     if(ltbp->lb_built) launchtaskbar_destructor_launch(ltbp);
 
     // LAUNCHTASKBAR
+#ifndef DISABLE_MENU
+    launchtaskbar_exec_index_free(ltbp);
+    if (ltbp->mc)
+    {
+        menu_cache_remove_reload_notify(ltbp->mc, ltbp->mc_reload);
+        menu_cache_unref(ltbp->mc);
+    }
+#endif
 
     /* Deallocate all memory. */
     if (ltbp->p_key_file_special_cases != NULL)
@@ -1254,7 +1482,7 @@ static void _launchbar_configure_add(GtkTreeView *menu_view, LaunchTaskBarPlugin
         config_setting_t *settings;
         gtk_container_add(GTK_CONTAINER(ltbp->lb_icon_grid), GTK_WIDGET(btn));
         gtk_list_store_append(list, &it);
-        pix = fm_pixbuf_from_icon(launch_button_get_icon(btn), PANEL_ICON_SIZE);
+        pix = lxpanel_icon_cache_load(launch_button_get_icon(btn), PANEL_ICON_SIZE, NULL);
         gtk_list_store_set(list, &it,
             COL_ICON, pix,
             COL_TITLE, launch_button_get_disp_name(btn),
@@ -1412,7 +1640,7 @@ static void launchbar_configure_initialize_list(LaunchTaskBarPlugin *ltbp, GtkWi
         if (launch_button_get_settings(btn) == NULL) /* bootstrap button */
             continue;
         gtk_list_store_append(list, &it);
-        pix = fm_pixbuf_from_icon(launch_button_get_icon(btn), PANEL_ICON_SIZE);
+        pix = lxpanel_icon_cache_load(launch_button_get_icon(btn), PANEL_ICON_SIZE, NULL);
         gtk_list_store_set(list, &it,
                            COL_ICON, pix,
                            COL_TITLE, launch_button_get_disp_name(btn),
@@ -1938,48 +2166,10 @@ static gboolean accept_net_wm_window_type(NetWMWindowType * nwwt)
     return ( ! ((nwwt->desktop) || (nwwt->dock) || (nwwt->splash)));
 }
 
-/* Set the class associated with a task. */
-static char *task_get_class(Window win)
-{
-    /* Read the WM_CLASS property. */
-    XClassHint ch;
-    ch.res_name = NULL;
-    ch.res_class = NULL;
-    char *res_class = NULL;
-    XGetClassHint(GDK_DISPLAY_XDISPLAY(gdk_display_get_default()), win, &ch);
-
-    /* If the res_name was returned, free it.  We make no use of it at this time. */
-    if (ch.res_name != NULL)
-    {
-        XFree(ch.res_name);
-    }
-
-    /* If the res_class was returned, process it.
-     * This identifies the application that created the window and is the basis for taskbar grouping. */
-    if (ch.res_class != NULL)
-    {
-        /* Convert the class to UTF-8 and enter it in the class table. */
-        res_class = g_locale_to_utf8(ch.res_class, -1, NULL, NULL, NULL);
-        XFree(ch.res_class);
-    }
-    return res_class;
-}
-
 /* Look up a task in the task list. */
-static TaskButton *task_lookup(LaunchTaskBarPlugin * tb, Window win)
+static inline TaskButton *task_lookup(LaunchTaskBarPlugin * tb, Window win)
 {
-    TaskButton *task = NULL;
-    GList *children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid));
-    GList *l;
-
-    for (l = children; l; l = l->next)
-        if (task_button_has_window(l->data, win))
-        {
-            task = l->data;
-            break;
-        }
-    g_list_free(children);
-    return task;
+    return task_button_window_index_lookup(tb->tb_windows, win);
 }
 
 
@@ -2189,23 +2379,51 @@ static void taskbar_add_task_button(LaunchTaskBarPlugin * tb, TaskButton * task)
                            G_CALLBACK(taskbar_button_enter), tb);
 }
 
-/* add win to tb, using list of task buttons */
-static void taskbar_add_new_window(LaunchTaskBarPlugin * tb, Window win, GList *list)
+/* add window to tb, grouping it with existing task buttons if configured */
+static void taskbar_add_new_window(LaunchTaskBarPlugin * tb, NetWMClientProps *props)
 {
-    gchar *res_class = task_get_class(win);
+    GList *children = NULL, *list = NULL;
     TaskButton *task;
 
-    if (!tb->grouped_tasks || res_class == NULL)
-        list = NULL;
-    else for (; list; list = list->next)
-        if (task_button_add_window(list->data, win, res_class))
-            break;
-    if (list != NULL)
-        return; /* some button accepted it, done */
+    /* The class identifies the application that created the window and is the basis for taskbar grouping. */
+    if (tb->grouped_tasks && props->res_class != NULL)
+    {
+        children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid));
+        for (list = children; list; list = list->next)
+            if (task_button_add_window(list->data, props))
+                break;
+    }
+    g_list_free(children);
+    if (list == NULL) /* no button accepted it, create new one */
+    {
+        task = task_button_new(props, tb->current_desktop, tb->number_of_desktops,
+                               tb->panel, tb->flags, tb->tb_windows);
+        taskbar_add_task_button(tb, task);
+    }
+}
 
-    task = task_button_new(win, tb->current_desktop, tb->number_of_desktops,
-                           tb->panel, res_class, tb->flags);
-    taskbar_add_task_button(tb, task);
+/* add windows to tb if they should be shown in taskbar */
+static void taskbar_check_new_windows(LaunchTaskBarPlugin * tb, Window *wins, int n)
+{
+    NetWMClientProps *props = g_new(NetWMClientProps, n);
+    int i;
+
+    /* Select events first so no change after the fetch is missed. Windows
+       not shown now may be later, so watch their state and type changes too. */
+    for (i = 0; i < n; i++)
+        task_button_select_window_events(wins[i]);
+    /* Fetch everything needed for all windows at once. */
+    get_net_wm_client_props(wins, n, props);
+    for (i = 0; i < n; i++)
+    {
+        /* Evaluate window state and window type to see if it should be in task list. */
+        if ((accept_net_wm_state(&props[i].nws))
+        && (accept_net_wm_window_type(&props[i].nwwt)))
+            /* Allocate and initialize new task structure. */
+            taskbar_add_new_window(tb, &props[i]);
+    }
+    free_net_wm_client_props(props, n);
+    g_free(props);
 }
 
 /*****************************************************
@@ -2219,52 +2437,75 @@ static void taskbar_net_client_list(GtkWidget * widget, LaunchTaskBarPlugin * tb
     if(ltbp->mode == LAUNCHBAR) return;
 
     /* Get the NET_CLIENT_LIST property. */
-    int client_count;
-    Window * client_list = get_xaproperty(GDK_ROOT_WINDOW(), a_NET_CLIENT_LIST, XA_WINDOW, &client_count);
+    int client_count = fb_ev_client_list_length(fbev);
+    Window * client_list = fb_ev_client_list(fbev);
     if (client_list != NULL)
     {
-        GList *children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid)), *l;
-        /* Remove windows from the task list that are not present in the NET_CLIENT_LIST. */
-        for (l = children; l; l = l->next)
-            task_button_update_windows_list(l->data, client_list, client_count);
-        g_list_free(children);
-        children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid));
-        /* Loop over client list, correlating it with task list. */
-        int i;
-        for (i = 0; i < client_count; i++)
-        {
-            /* Search for the window in the task list.  Set up context to do an insert right away if needed. */
-            for (l = children; l; l = l->next)
+        TaskClientListDiff diff;
+        Window * new_list = NULL;
+        GHashTable *changed = NULL;
+        GHashTableIter iter;
+        gpointer key;
+        TaskButton *task;
+        guint i, n_new;
+
+        task_client_list_diff(tb->tb_clients, client_list, client_count, &diff);
+
+        /* Find buttons which have windows not present in the NET_CLIENT_LIST. */
+        for (i = 0; i < diff.n_vanished; i++)
+            if ((task = task_lookup(tb, diff.vanished[i])) != NULL)
             {
-                if (task_button_has_window(l->data, client_list[i]))
-                    break;
+                if (changed == NULL)
+                    changed = g_hash_table_new(g_direct_hash, g_direct_equal);
+                g_hash_table_insert(changed, task, task);
             }
 
-            /* Task is not in task list. */
-            if (l == NULL)
+        /* Remove those windows from the task list. */
+        if (changed != NULL)
+        {
+            g_hash_table_iter_init(&iter, changed);
+            while (g_hash_table_iter_next(&iter, &key, NULL))
+                task_button_update_windows_list(key, diff.clients);
+            g_hash_table_destroy(changed);
+        }
+
+        /* Check windows which were not present in previous NET_CLIENT_LIST. */
+        for (i = 0, n_new = 0; i < diff.n_appeared; i++)
+            if (task_lookup(tb, diff.appeared[i]) == NULL)
             {
-                /* Evaluate window state and window type to see if it should be in task list. */
-                NetWMWindowType nwwt;
-                NetWMState nws;
-                get_net_wm_state(client_list[i], &nws);
-                get_net_wm_window_type(client_list[i], &nwwt);
-                if ((accept_net_wm_state(&nws))
-                && (accept_net_wm_window_type(&nwwt)))
-                {
-                    /* Allocate and initialize new task structure. */
-                    taskbar_add_new_window(tb, client_list[i], children);
-                    g_list_free(children);
-                    children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid));
-                }
+                if (new_list == NULL)
+                    new_list = g_new(Window, diff.n_appeared - i);
+                new_list[n_new++] = diff.appeared[i];
             }
+        if (n_new > 0)
+            taskbar_check_new_windows(tb, new_list, n_new);
+        g_free(new_list);
+        task_client_list_diff_clear(&diff);
+
+        g_hash_table_destroy(tb->tb_clients);
+        tb->tb_clients = diff.clients;
+#ifndef DISABLE_MENU
+        /* Forget launchers of windows which are gone. */
+        if (tb->tb_launchers != NULL)
+        {
+            g_hash_table_iter_init(&iter, tb->tb_launchers);
+            while (g_hash_table_iter_next(&iter, &key, NULL))
+                if (g_hash_table_lookup(tb->tb_clients, key) == NULL)
+                    g_hash_table_iter_remove(&iter);
         }
-        g_list_free(children);
-        XFree(client_list);
+#endif
     }
 
     else /* clear taskbar */
+    {
         gtk_container_foreach(GTK_CONTAINER(tb->tb_icon_grid),
                               (GtkCallback)gtk_widget_destroy, NULL);
+        g_hash_table_remove_all(tb->tb_clients);
+#ifndef DISABLE_MENU
+        if (tb->tb_launchers != NULL)
+            g_hash_table_remove_all(tb->tb_launchers);
+#endif
+    }
 }
 
 /* Handler for "current-desktop" event from root window listener. */
@@ -2274,7 +2515,7 @@ static void taskbar_net_current_desktop(GtkWidget * widget, LaunchTaskBarPlugin
     if(ltbp->mode == LAUNCHBAR) return;
 
     /* Store the local copy of current desktops.  Redisplay the taskbar. */
-    tb->current_desktop = get_net_current_desktop();
+    tb->current_desktop = fb_ev_current_desktop(fbev);
     taskbar_redraw(tb);
 }
 
@@ -2285,7 +2526,7 @@ static void taskbar_net_number_of_desktops(GtkWidget * widget, LaunchTaskBarPlug
     if(ltbp->mode == LAUNCHBAR) return;
 
     /* Store the local copy of number of desktops.  Recompute the popup menu and redisplay the taskbar. */
-    tb->number_of_desktops = get_net_number_of_desktops();
+    tb->number_of_desktops = fb_ev_number_of_desktops(fbev);
     taskbar_reset_menu(tb);
     taskbar_redraw(tb);
 }
@@ -2297,12 +2538,11 @@ static void taskbar_net_active_window(GtkWidget * widget, LaunchTaskBarPlugin *
     if(ltbp->mode == LAUNCHBAR) return;
 
     /* Get the window that has focus. */
-    Window * f = get_xaproperty(GDK_ROOT_WINDOW(), a_NET_ACTIVE_WINDOW, XA_WINDOW, 0);
+    Window * f = fb_ev_active_window(fbev);
 
     gtk_container_foreach(GTK_CONTAINER(tb->tb_icon_grid),
-                          (GtkCallback)task_button_window_focus_changed, f);
-    if (f != NULL)
-        XFree(f);
+                          (GtkCallback)task_button_window_focus_changed,
+                          *f != None ? f : NULL);
 }
 
 /* Handle PropertyNotify event.
@@ -2347,11 +2587,13 @@ static void taskbar_property_notify_event(LaunchTaskBarPlugin *tb, XEvent *ev)
                 else if (at == XA_WM_CLASS && tb->grouped_tasks
                          && task_button_drop_window(tk, win, TRUE))
                 {
-                    GList *children = gtk_container_get_children(GTK_CONTAINER(tb->tb_icon_grid));
+                    NetWMClientProps props;
+
                     /* if Window was not single window of that class then
                        add it to another class or make another button */
-                    taskbar_add_new_window(tb, win, children);
-                    g_list_free(children);
+                    get_net_wm_client_props(&win, 1, &props);
+                    taskbar_add_new_window(tb, &props);
+                    free_net_wm_client_props(&props, 1);
                 }
                 else
                 {
@@ -2361,6 +2603,15 @@ static void taskbar_property_notify_event(LaunchTaskBarPlugin *tb, XEvent *ev)
 
                 XSetErrorHandler(previous_error_handler);
             }
+            else if ((at == a_NET_WM_STATE || at == a_NET_WM_WINDOW_TYPE)
+                     && g_hash_table_lookup(tb->tb_clients, GUINT_TO_POINTER(win)))
+            {
+                /* Window was rejected before but might be accepted now. */
+                XErrorHandler previous_error_handler = XSetErrorHandler(panel_handle_x_error_swallow_BadWindow_BadDrawable);
+
+                taskbar_check_new_windows(tb, &win, 1);
+                XSetErrorHandler(previous_error_handler);
+            }
         }
     }
 }
@@ -51,6 +51,7 @@
 #include "misc.h"
 #include "plugin.h"
 #include "menu-policy.h"
+#include "icon-cache.h"
 
 #include "dbg.h"
 #include "gtk-compat.h"
@@ -87,11 +88,22 @@ typedef struct {
     guint visibility_flags;
     gpointer reload_notify;
     FmDndSrc *ds;
+    gboolean lazy;          /* load system submenus on demand */
 } menup;
 
+/* state of system submenu which is loaded on demand */
+typedef struct {
+    MenuCacheDir *dir;
+    gboolean loaded;
+    guint prefetched;       /* icon cache generation + 1 when icons were queued */
+} SysSubmenu;
+
 static guint idle_loader = 0;
 
 GQuark SYS_MENU_ITEM_ID = 0;
+static GQuark SYS_SUBMENU_ID = 0;
+static GQuark SYS_MENU_KEY_ID = 0;
+static GQuark SYS_MENU_SIGNATURE_ID = 0;
 
 /* FIXME: those are defined on panel main code */
 void restart(void);
@@ -184,19 +196,14 @@ static void on_menu_item_map(GtkWidget *mi, menup *m)
         {
             FmIcon *fm_icon = fm_file_info_get_icon(fi);
             FmIcon *_fm_icon = NULL;
-            GdkPixbuf *icon = NULL;
 
             if (fm_icon == NULL)
                 fm_icon = _fm_icon = fm_icon_from_name("application-x-executable");
-            icon = fm_pixbuf_from_icon_with_fallback(fm_icon, m->iconsize,
-                                                         "application-x-executable");
+            /* if it's not cached yet then it will be set when decoded */
+            lxpanel_icon_cache_load_image(img, fm_icon, m->iconsize,
+                                          "application-x-executable");
             if (_fm_icon)
                 g_object_unref(_fm_icon);
-            if (icon)
-            {
-                gtk_image_set_from_pixbuf(img, icon);
-                g_object_unref(icon);
-            }
         }
     }
 }
@@ -392,6 +399,34 @@ static gboolean on_menu_button_press(GtkWidget* mi, GdkEventButton* evt, menup*
     return FALSE;
 }
 
+static inline guint str_hash0(const char *str)
+{
+    return str ? g_str_hash(str) : 0;
+}
+
+/* calculate hash of everything what is shown for the item */
+static guint sys_menu_item_signature(MenuCacheItem *item)
+{
+    guint signature = str_hash0(menu_cache_item_get_name(item));
+
+    signature = signature * 31 + str_hash0(menu_cache_item_get_icon(item));
+    signature = signature * 31 + str_hash0(menu_cache_item_get_comment(item));
+    return signature;
+}
+
+/* create FmFileInfo for the item, it will be used in callbacks */
+static FmFileInfo *sys_menu_item_file_info(MenuCacheItem *item)
+{
+    char *mpath = menu_cache_dir_make_path(MENU_CACHE_DIR(item));
+    FmPath *path = fm_path_new_relative(fm_path_get_apps_menu(), mpath+13);
+                                                /* skip "/Applications" */
+    FmFileInfo *fi = fm_file_info_new_from_menu_cache_item(path, item);
+
+    g_free(mpath);
+    fm_path_unref(path);
+    return fi;
+}
+
 static GtkWidget* create_item(MenuCacheItem *item, menup *m)
 {
     GtkWidget* mi;
@@ -403,18 +438,16 @@ static GtkWidget* create_item(MenuCacheItem *item, menup *m)
     else
     {
         GtkWidget* img;
-        /* create FmFileInfo for the item, it will be used in callbacks */
-        char *mpath = menu_cache_dir_make_path(MENU_CACHE_DIR(item));
-        FmPath *path = fm_path_new_relative(fm_path_get_apps_menu(), mpath+13);
-                                                    /* skip "/Applications" */
-        FmFileInfo *fi = fm_file_info_new_from_menu_cache_item(path, item);
-
-        g_free(mpath);
-        fm_path_unref(path);
+
         mi = gtk_image_menu_item_new_with_mnemonic( menu_cache_item_get_name(item) );
-        g_object_set_qdata_full(G_OBJECT(mi), SYS_MENU_ITEM_ID, fi,
+        g_object_set_qdata_full(G_OBJECT(mi), SYS_MENU_ITEM_ID,
+                                sys_menu_item_file_info(item),
                                 (GDestroyNotify)fm_file_info_unref);
+        g_object_set_qdata(G_OBJECT(mi), SYS_MENU_SIGNATURE_ID,
+                           GUINT_TO_POINTER(sys_menu_item_signature(item)));
         img = gtk_image_new();
+        /* reserve space so items don't move when icon is loaded */
+        gtk_widget_set_size_request(img, m->iconsize, m->iconsize);
         gtk_image_menu_item_set_image( GTK_IMAGE_MENU_ITEM(mi), img );
         if( menu_cache_item_get_type(item) == MENU_CACHE_TYPE_APP )
         {
@@ -434,81 +467,320 @@ static GtkWidget* create_item(MenuCacheItem *item, menup *m)
     return mi;
 }
 
-static int load_menu(menup* m, MenuCacheDir* dir, GtkWidget* menu, int pos )
+/* returns TRUE if directory should not be shown at all */
+static gboolean sys_menu_dir_is_hidden(MenuCacheDir *dir)
 {
-    GSList * l;
-    /* number of visible entries */
-    gint count = 0;
-#if MENU_CACHE_CHECK_VERSION(0, 4, 0)
-    GSList *children;
-# if MENU_CACHE_CHECK_VERSION(0, 5, 0)
-#  if !MENU_CACHE_CHECK_VERSION(1, 0, 0)
+#if MENU_CACHE_CHECK_VERSION(0, 5, 0)
+# if !MENU_CACHE_CHECK_VERSION(1, 0, 0)
     char *kfpath;
     GKeyFile *kf;
-#  endif
+    gboolean hidden = FALSE;
+# endif
     if (!menu_cache_dir_is_visible(dir)) /* directory is hidden, ignore children */
-        return 0;
-#  if !MENU_CACHE_CHECK_VERSION(1, 0, 0)
+        return TRUE;
+# if !MENU_CACHE_CHECK_VERSION(1, 0, 0)
     /* version 1.0.0 has NoDisplay checked internally */
     kfpath = menu_cache_item_get_file_path(MENU_CACHE_ITEM(dir));
     kf = g_key_file_new();
     /* for version 0.5.0 we enable hidden so should test NoDisplay flag */
     if (kfpath && g_key_file_load_from_file(kf, kfpath, 0, NULL) &&
         g_key_file_get_boolean(kf, "Desktop Entry", "NoDisplay", NULL))
-        count = -1;
+        hidden = TRUE;
     g_free(kfpath);
     g_key_file_free(kf);
-    if (count < 0) /* directory is hidden, ignore children */
-        return 0;
-#  endif /* < 1.0.0 */
-# endif /* < 0.5.0 */
-    children = menu_cache_dir_list_children(dir);
-    for (l = children; l; l = l->next)
+    return hidden;
+# endif /* < 1.0.0 */
+#endif /* < 0.5.0 */
+    return FALSE;
+}
+
+/* returns list of referenced children, free it with sys_menu_dir_free_children() */
+static GSList *sys_menu_dir_list_children(MenuCacheDir *dir)
+{
+#if MENU_CACHE_CHECK_VERSION(0, 4, 0)
+    return menu_cache_dir_list_children(dir);
 #else /* < 0.4.0 */
-    for( l = menu_cache_dir_get_children(dir); l; l = l->next )
+    GSList *children = g_slist_copy(menu_cache_dir_get_children(dir));
+    g_slist_foreach(children, (GFunc)menu_cache_item_ref, NULL);
+    return children;
 #endif
+}
+
+static void sys_menu_dir_free_children(GSList *children)
+{
+    g_slist_foreach(children, (GFunc)menu_cache_item_unref, NULL);
+    g_slist_free(children);
+}
+
+/* directory is shown if it is visible and has a visible app in it or in
+   any of its subdirectories, separators alone don't count */
+static gboolean sys_menu_dir_has_items(menup *m, MenuCacheDir *dir)
+{
+    GSList *children, *l;
+    gboolean result = FALSE;
+
+    if (sys_menu_dir_is_hidden(dir))
+        return FALSE;
+    children = sys_menu_dir_list_children(dir);
+    for (l = children; l && !result; l = l->next)
+        switch (menu_cache_item_get_type(l->data))
+        {
+        case MENU_CACHE_TYPE_APP:
+            result = panel_menu_item_evaluate_visibility(l->data, m->visibility_flags);
+            break;
+        case MENU_CACHE_TYPE_DIR:
+            result = sys_menu_dir_has_items(m, MENU_CACHE_DIR(l->data));
+            break;
+        default:
+            break;
+        }
+    sys_menu_dir_free_children(children);
+    return result;
+}
+
+/* returns TRUE if item should be shown in the menu */
+static gboolean sys_menu_item_is_shown(menup *m, MenuCacheItem *item)
+{
+    switch (menu_cache_item_get_type(item))
+    {
+    case MENU_CACHE_TYPE_APP:
+        return panel_menu_item_evaluate_visibility(item, m->visibility_flags);
+    case MENU_CACHE_TYPE_DIR:
+        /* don't create empty submenus */
+        return sys_menu_dir_has_items(m, MENU_CACHE_DIR(item));
+    default:
+        return TRUE;
+    }
+}
+
+static int sys_menu_merge(menup *m, MenuCacheDir *dir, GtkWidget *menu,
+                          int pos, GList *old);
+
+static void sys_submenu_free(gpointer data)
+{
+    SysSubmenu *ss = data;
+
+    menu_cache_item_unref(MENU_CACHE_ITEM(ss->dir));
+    g_slice_free(SysSubmenu, ss);
+}
+
+/* fill placeholder submenu on first request */
+static void sys_submenu_load(GtkWidget *sub, menup *m)
+{
+    SysSubmenu *ss = g_object_get_qdata(G_OBJECT(sub), SYS_SUBMENU_ID);
+
+    if (ss == NULL || ss->loaded)
+        return;
+    ss->loaded = TRUE;
+    sys_menu_merge(m, ss->dir, sub, -1, NULL);
+}
+
+/* queue decoding of icons for submenu items in background */
+static void sys_submenu_prefetch(GtkWidget *sub, menup *m)
+{
+    SysSubmenu *ss;
+    GSList *children, *l;
+    MenuCacheItem *item;
+    const char *name;
+    FmIcon *icon;
+
+    if (sub == NULL ||
+        (ss = g_object_get_qdata(G_OBJECT(sub), SYS_SUBMENU_ID)) == NULL ||
+        ss->prefetched == lxpanel_icon_cache_get_generation() + 1)
+        return;
+    ss->prefetched = lxpanel_icon_cache_get_generation() + 1;
+    children = sys_menu_dir_list_children(ss->dir);
+    for (l = children; l; l = l->next)
+    {
+        item = MENU_CACHE_ITEM(l->data);
+        if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_SEP ||
+            (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_APP &&
+             !panel_menu_item_evaluate_visibility(item, m->visibility_flags)))
+            continue;
+        name = menu_cache_item_get_icon(item);
+        icon = fm_icon_from_name(name ? name : "application-x-executable");
+        lxpanel_icon_cache_prefetch(icon, m->iconsize, "application-x-executable");
+        g_object_unref(icon);
+    }
+    sys_menu_dir_free_children(children);
+}
+
+static void on_sys_submenu_item_select(GtkMenuItem *mi, menup *m)
+{
+    GtkWidget *sub = gtk_menu_item_get_submenu(mi);
+    GList *items, *l;
+
+    /* it may be context menu instead, it has no SysSubmenu data */
+    if (sub != NULL)
+    {
+        sys_submenu_prefetch(sub, m);
+        sys_submenu_load(sub, m);
+    }
+    /* user is likely to move to adjacent submenu next */
+    items = gtk_container_get_children(GTK_CONTAINER(gtk_widget_get_parent(GTK_WIDGET(mi))));
+    l = g_list_find(items, mi);
+    if (l != NULL && l->prev != NULL)
+        sys_submenu_prefetch(gtk_menu_item_get_submenu(l->prev->data), m);
+    if (l != NULL && l->next != NULL)
+        sys_submenu_prefetch(gtk_menu_item_get_submenu(l->next->data), m);
+    g_list_free(items);
+}
+
+static GtkWidget *sys_submenu_new(menup *m, MenuCacheDir *dir)
+{
+    GtkWidget *sub = gtk_menu_new();
+    SysSubmenu *ss = g_slice_new0(SysSubmenu);
+
+    ss->dir = MENU_CACHE_DIR(menu_cache_item_ref(MENU_CACHE_ITEM(dir)));
+    g_object_set_qdata_full(G_OBJECT(sub), SYS_SUBMENU_ID, ss, sys_submenu_free);
+    g_signal_connect(sub, "map", G_CALLBACK(sys_submenu_load), m);
+    return sub;
+}
+
+/* update existing item for new menu cache item with the same id */
+static void sys_menu_update_item(menup *m, GtkWidget *mi, MenuCacheItem *item)
+{
+    guint signature;
+    GtkWidget *sub, *img;
+    SysSubmenu *ss;
+    GList *items;
+
+    if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_SEP)
+        return;
+    signature = sys_menu_item_signature(item);
+    if (GPOINTER_TO_UINT(g_object_get_qdata(G_OBJECT(mi), SYS_MENU_SIGNATURE_ID)) != signature)
     {
-        MenuCacheItem* item = MENU_CACHE_ITEM(l->data);
-
-        gboolean is_visible = ((menu_cache_item_get_type(item) != MENU_CACHE_TYPE_APP) ||
-			       (panel_menu_item_evaluate_visibility(item, m->visibility_flags)));
-
-	if (is_visible)
-	{
-            GtkWidget * mi = create_item(item, m);
-	    count++;
-            if (mi != NULL)
-                gtk_menu_shell_insert( (GtkMenuShell*)menu, mi, pos );
-            if( pos >= 0 )
-                ++pos;
-	    /* process subentries */
-	    if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_DIR)
-	    {
+        g_object_set_qdata(G_OBJECT(mi), SYS_MENU_SIGNATURE_ID, GUINT_TO_POINTER(signature));
+        g_object_set_qdata_full(G_OBJECT(mi), SYS_MENU_ITEM_ID,
+                                sys_menu_item_file_info(item),
+                                (GDestroyNotify)fm_file_info_unref);
+        gtk_menu_item_set_label(GTK_MENU_ITEM(mi), menu_cache_item_get_name(item));
+        if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_APP)
+            gtk_widget_set_tooltip_text(mi, menu_cache_item_get_comment(item));
+        /* the icon might be changed, load it again */
+        img = gtk_image_menu_item_get_image(GTK_IMAGE_MENU_ITEM(mi));
+        if (img)
+        {
+            gtk_image_clear(GTK_IMAGE(img));
+            if (gtk_widget_get_mapped(mi))
+                on_menu_item_map(mi, m);
+        }
+    }
+    if (menu_cache_item_get_type(item) != MENU_CACHE_TYPE_DIR)
+        return;
+    /* context menu may be shown instead of submenu now */
+    sub = g_object_get_data(G_OBJECT(mi), "PanelMenuItemSubmenu");
+    if (sub == NULL)
+        sub = gtk_menu_item_get_submenu(GTK_MENU_ITEM(mi));
+    if (sub == NULL)
+        return;
+    ss = g_object_get_qdata(G_OBJECT(sub), SYS_SUBMENU_ID);
+    if (ss != NULL)
+    {
+        menu_cache_item_unref(MENU_CACHE_ITEM(ss->dir));
+        ss->dir = MENU_CACHE_DIR(menu_cache_item_ref(item));
+        ss->prefetched = 0;
+        if (!ss->loaded) /* nothing to update yet */
+            return;
+    }
+    items = gtk_container_get_children(GTK_CONTAINER(sub));
+    sys_menu_merge(m, MENU_CACHE_DIR(item), sub, 0, items);
+    g_list_free(items);
+}
+
+/*
+ * Merge contents of dir into menu
+ * pos: position of first item, -1 to append
+ * old: items for the dir which are already in the menu
+ * Items from old which have the same id as new ones are kept, the rest
+ * is destroyed. Returns number of items for the dir in menu.
+ */
+static int sys_menu_merge(menup *m, MenuCacheDir *dir, GtkWidget *menu,
+                          int pos, GList *old)
+{
+    GHashTable *old_items = g_hash_table_new(g_str_hash, g_str_equal);
+    GHashTableIter iter;
+    GSList *children = NULL, *l;
+    GList *ol;
+    MenuCacheItem *item;
+    GtkWidget *mi;
+    const char *key;
+    char *new_key;
+    guint n_sep = 0;
+    gint count = 0;
+
+    for (ol = old; ol; ol = ol->next)
+    {
+        key = g_object_get_qdata(ol->data, SYS_MENU_KEY_ID);
+        if (key != NULL && g_hash_table_lookup(old_items, key) == NULL)
+            g_hash_table_insert(old_items, (gpointer)key, ol->data);
+        else /* placeholder */
+            gtk_widget_destroy(ol->data);
+    }
+    if (!sys_menu_dir_is_hidden(dir)) /* directory is hidden, ignore children */
+        children = sys_menu_dir_list_children(dir);
+    for (l = children; l; l = l->next)
+    {
+        item = MENU_CACHE_ITEM(l->data);
+        if (!sys_menu_item_is_shown(m, item))
+            continue;
+        /* desktop id is unique within the dir, separators are counted */
+        switch (menu_cache_item_get_type(item))
+        {
+        case MENU_CACHE_TYPE_SEP:
+            new_key = g_strdup_printf("-%u", n_sep++);
+            break;
+        case MENU_CACHE_TYPE_DIR:
+            new_key = g_strconcat("/", menu_cache_item_get_id(item), NULL);
+            break;
+        default:
+            new_key = g_strdup(menu_cache_item_get_id(item));
+        }
+        mi = g_hash_table_lookup(old_items, new_key);
+        if (mi != NULL)
+        {
+            g_hash_table_remove(old_items, new_key);
+            g_free(new_key);
+            sys_menu_update_item(m, mi, item);
+            /* obsolete items are moved behind and destroyed afterwards */
+            if (pos >= 0)
+                gtk_menu_reorder_child(GTK_MENU(menu), mi, pos);
+        }
+        else
+        {
+            mi = create_item(item, m);
+            g_object_set_qdata_full(G_OBJECT(mi), SYS_MENU_KEY_ID, new_key, g_free);
+            gtk_menu_shell_insert(GTK_MENU_SHELL(menu), mi, pos);
+            /* process subentries */
+            if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_DIR && m->lazy)
+            {
+                /* leave placeholder which will be filled when shown */
+                gtk_menu_item_set_submenu(GTK_MENU_ITEM(mi),
+                                          sys_submenu_new(m, MENU_CACHE_DIR(item)));
+                g_signal_connect(mi, "select", G_CALLBACK(on_sys_submenu_item_select), m);
+            }
+            else if (menu_cache_item_get_type(item) == MENU_CACHE_TYPE_DIR)
+            {
                 GtkWidget* sub = gtk_menu_new();
-		/*  always pass -1 for position */
-		gint s_count = load_menu( m, MENU_CACHE_DIR(item), sub, -1 );
-                if (s_count)
-		    gtk_menu_item_set_submenu( GTK_MENU_ITEM(mi), sub );
-		else
-		{
-		    /* don't keep empty submenus */
-		    gtk_widget_destroy( sub );
-		    gtk_widget_destroy( mi );
-		    if (pos > 0)
-			pos--;
-		}
-	    }
-	}
+                /*  always pass -1 for position */
+                sys_menu_merge(m, MENU_CACHE_DIR(item), sub, -1, NULL);
+                gtk_menu_item_set_submenu(GTK_MENU_ITEM(mi), sub);
+            }
+        }
+        if (pos >= 0)
+            ++pos;
+        count++;
     }
-#if MENU_CACHE_CHECK_VERSION(0, 4, 0)
-    g_slist_foreach(children, (GFunc)menu_cache_item_unref, NULL);
-    g_slist_free(children);
-#endif
+    sys_menu_dir_free_children(children);
+    /* drop items which are gone */
+    g_hash_table_iter_init(&iter, old_items);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&mi))
+        gtk_widget_destroy(mi);
+    g_hash_table_destroy(old_items);
     return count;
 }
 
 
-
 static gboolean sys_menu_item_has_data( GtkMenuItem* item )
 {
    return (g_object_get_qdata( G_OBJECT(item), SYS_MENU_ITEM_ID ) != NULL);
@@ -555,19 +827,18 @@ static void remove_change_handler(gpointer id, GObject* menu)
 }
 
 /*
- * Insert application menus into specified menu
- * menu: The parent menu to which the items should be inserted
- * pisition: Position to insert items.
+ * Update application menus in specified menu
+ * menu: The parent menu which contains the items
+ * position: Position of the first item.
              Passing -1 in this parameter means append all items
              at the end of menu.
+ * old: Items which are already in the menu
+ * Returns number of items in the menu now.
  */
-static void sys_menu_insert_items( menup* m, GtkMenu* menu, int position )
+static int sys_menu_update_items( menup* m, GtkMenu* menu, int position, GList* old )
 {
     MenuCacheDir* dir;
-    guint change_handler;
-
-    if( G_UNLIKELY( SYS_MENU_ITEM_ID == 0 ) )
-        SYS_MENU_ITEM_ID = g_quark_from_static_string( "SysMenuItem" );
+    int count;
 
 #if MENU_CACHE_CHECK_VERSION(0, 4, 0)
     dir = menu_cache_dup_root_dir(m->menu_cache);
@@ -576,7 +847,7 @@ static void sys_menu_insert_items( menup* m, GtkMenu* menu, int position )
 #endif
     if(dir)
     {
-        load_menu( m, dir, GTK_WIDGET(menu), position );
+        count = sys_menu_merge( m, dir, GTK_WIDGET(menu), position, old );
 #if MENU_CACHE_CHECK_VERSION(0, 4, 0)
         menu_cache_item_unref(MENU_CACHE_ITEM(dir));
 #endif
@@ -585,43 +856,79 @@ static void sys_menu_insert_items( menup* m, GtkMenu* menu, int position )
     {
         /* add a place holder */
         GtkWidget* mi = gtk_menu_item_new();
+        g_list_foreach(old, (GFunc)gtk_widget_destroy, NULL);
         g_object_set_qdata( G_OBJECT(mi), SYS_MENU_ITEM_ID, GINT_TO_POINTER(1) );
         gtk_menu_shell_insert(GTK_MENU_SHELL(menu), mi, position);
+        count = 1;
     }
+    return count;
+}
+
+/*
+ * Insert application menus into specified menu
+ * menu: The parent menu to which the items should be inserted
+ * pisition: Position to insert items.
+             Passing -1 in this parameter means append all items
+             at the end of menu.
+ */
+static void sys_menu_insert_items( menup* m, GtkMenu* menu, int position )
+{
+    guint change_handler;
+
+    if( G_UNLIKELY( SYS_MENU_ITEM_ID == 0 ) )
+    {
+        SYS_MENU_ITEM_ID = g_quark_from_static_string( "SysMenuItem" );
+        SYS_SUBMENU_ID = g_quark_from_static_string( "SysSubmenu" );
+        SYS_MENU_KEY_ID = g_quark_from_static_string( "SysMenuKey" );
+        SYS_MENU_SIGNATURE_ID = g_quark_from_static_string( "SysMenuSignature" );
+    }
+
+    sys_menu_update_items( m, menu, position, NULL );
 
     change_handler = g_signal_connect(gtk_icon_theme_get_default(), "changed", G_CALLBACK(unload_old_icons), m);
     g_object_weak_ref( G_OBJECT(menu), remove_change_handler, GINT_TO_POINTER(change_handler) );
 }
 
-
+/*
+ * Update application menus after menu cache reload. Items which are not
+ * changed are kept, together with their icons and submenus, so opened
+ * menu isn't closed. If rebuild is TRUE then all items are created anew,
+ * e.g. when the way of loading submenus is changed.
+ */
 static void
-reload_system_menu( menup* m, GtkMenu* menu )
+reload_system_menu( menup* m, GtkMenu* menu, gboolean rebuild )
 {
-    GList *children, *child;
+    GList *children, *child, *block;
     GtkMenuItem* item;
     GtkWidget* sub_menu;
-    gint idx;
+    gint idx = 0;
 
     children = gtk_container_get_children( GTK_CONTAINER(menu) );
-    for( child = children, idx = 0; child; child = child->next, ++idx )
+    for( child = children; child; )
     {
         item = GTK_MENU_ITEM( child->data );
         if( sys_menu_item_has_data( item ) )
         {
-            do
+            for( block = NULL; child && sys_menu_item_has_data( child->data );
+                 child = child->next )
+                block = g_list_prepend( block, child->data );
+            block = g_list_reverse( block );
+            if( rebuild )
             {
-                item = GTK_MENU_ITEM( child->data );
-                child = child->next;
-                gtk_widget_destroy( GTK_WIDGET(item) );
-            }while( child && sys_menu_item_has_data( child->data ) );
-            sys_menu_insert_items( m, menu, idx );
-            if( ! child )
-                break;
+                g_list_foreach( block, (GFunc)gtk_widget_destroy, NULL );
+                g_list_free( block );
+                block = NULL;
+            }
+            idx += sys_menu_update_items( m, menu, idx, block );
+            g_list_free( block );
+            continue;
         }
         else if( ( sub_menu = gtk_menu_item_get_submenu( item ) ) )
         {
-            reload_system_menu( m, GTK_MENU(sub_menu) );
+            reload_system_menu( m, GTK_MENU(sub_menu), rebuild );
         }
+        child = child->next;
+        ++idx;
     }
     g_list_free( children );
 }
@@ -788,7 +1095,7 @@ static void on_reload_menu(MenuCache* cache, gpointer menu_pointer)
 {
     menup *m = menu_pointer;
     /* g_debug("reload system menu!!"); */
-    reload_system_menu( m, GTK_MENU(m->menu) );
+    reload_system_menu( m, GTK_MENU(m->menu), FALSE );
 }
 
 static void
@@ -927,7 +1234,7 @@ menu_constructor(LXPanel *panel, config_setting_t *settings)
 {
     menup *m;
     config_setting_t *s;
-    int iw, ih;
+    int iw, ih, lazy;
 
     m = g_new0(menup, 1);
     g_return_val_if_fail(m != NULL, 0);
@@ -943,6 +1250,10 @@ menu_constructor(LXPanel *panel, config_setting_t *settings)
     m->panel = panel;
     m->settings = settings;
 
+    m->lazy = TRUE;
+    if (config_setting_lookup_int(settings, "LazyLoad", &lazy))
+        m->lazy = (lazy != 0);
+
     /* Check if configuration exists */
     settings = config_setting_add(settings, "", PANEL_CONF_TYPE_LIST);
     if (config_setting_get_elem(settings, 0) == NULL)
@@ -973,7 +1284,14 @@ static gboolean apply_config(gpointer user_data)
 {
     GtkWidget *p = user_data;
     menup* m = lxpanel_plugin_get_data(p);
-
+    int lazy = 1;
+
+    /* existing submenus are either placeholders or fully loaded, so
+       they are all created again if the mode was changed */
+    config_setting_lookup_int(m->settings, "LazyLoad", &lazy);
+    if ((lazy != 0) != (m->lazy != 0) && m->menu_cache != NULL)
+        reload_system_menu(m, GTK_MENU(m->menu), TRUE);
+    config_group_set_int(m->settings, "LazyLoad", m->lazy);
     if( m->fname ) {
         lxpanel_button_set_icon(m->img, m->fname, -1);
     }
@@ -988,6 +1306,7 @@ static GtkWidget *menu_config(LXPanel *panel, GtkWidget *p)
     menup* menu = lxpanel_plugin_get_data(p);
     return lxpanel_generic_config_dlg(_("Menu"), panel, apply_config, p,
                                       _("Icon"), &menu->fname, CONF_TYPE_FILE_ENTRY,
+                                      _("Load submenus on demand"), &menu->lazy, CONF_TYPE_BOOL,
                                       /* _("Use panel size as icon size"), &menu->match_panel, CONF_TYPE_INT, */
                                       /* _("Caption"), &menu->caption, CONF_TYPE_STR, */
                                       NULL);
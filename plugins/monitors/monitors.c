@@ -77,9 +77,12 @@
 #include <stdlib.h>
 #include <glib/gi18n.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <libfm/fm-gtk.h>
 
 #include "plugin.h"
+#include "proc-stat.h"
 
 #include "dbg.h"
 
@@ -89,6 +92,7 @@
 #define DEFAULT_WIDTH    40                 /* Pixels               */
 #define UPDATE_PERIOD    1                  /* Seconds              */
 #define COLOR_SIZE       8                  /* In chars : #xxxxxx\0 */
+#define N_OVERLAYS       2                  /* Extra series of a monitor */
 
 #ifndef ENTER
 #define ENTER fprintf(stderr, "Entering %s\n", __func__);
@@ -108,8 +112,14 @@ struct Monitor {
     gint         pixmap_width;      /* Width and size of the buffer           */
     gint         pixmap_height;     /* Does not include border size           */
     stats_set    *stats;            /* Circular buffer of values              */
+    guint        n_overlays;        /* Number of extra series                 */
+    stats_set    *overlays[N_OVERLAYS]; /* Extra series drawn as lines over
+                                       the graph, values <= 0 aren't drawn  */
+    GdkColor     overlay_colors[N_OVERLAYS];
     stats_set    total;             /* Maximum possible value, as in mem_total*/
     int          *maxfree;          /* Count buffers & cache as free memory   */
+    LXPanelCpuTimes cpu_prev;       /* CPU counters of the previous sample    */
+    gboolean     has_cpu_prev;      /* cpu_prev is set                        */
     gint         ring_cursor;       /* Cursor for ring/circular buffer        */
     gchar        *color;            /* Color of the graph                     */
     gboolean     (*update) (struct Monitor *); /* Update function             */
@@ -127,7 +137,13 @@ typedef void (*tooltip_update_func) (Monitor *);
  */
 #define CPU_POSITION    0
 #define MEM_POSITION    1
-#define N_MONITORS      2
+#define SWAP_POSITION   2
+#define N_MONITORS      3
+
+/* Extra series of monitors, indices in Monitor.overlays */
+#define MEM_OVERLAY_UNAVAILABLE 0
+#define MEM_OVERLAY_SHMEM       1
+#define SWAP_OVERLAY_ZSWAP      0
 
 /* Our plugin */
 typedef struct {
@@ -137,7 +153,8 @@ typedef struct {
     int      displayed_monitors[N_MONITORS]; /* Booleans                      */
     int      show_cached_as_free;            /* What memory is shown as used  */
     char     *action;                        /* What to do on click           */
-    guint    timer;                          /* Timer for regular updates     */
+    guint    sampler;                        /* Subscription to /proc/stat,
+                                                also updates all monitors     */
 } MonitorsPlugin;
 
 /*
@@ -153,6 +170,10 @@ static void     cpu_tooltip_update (Monitor *m);
 static gboolean mem_update(Monitor *);
 static void     mem_tooltip_update (Monitor *m);
 
+/* Swap Monitor */
+static gboolean swap_update(Monitor *);
+static void     swap_tooltip_update (Monitor *m);
+
 
 static gboolean configure_event(GtkWidget*, GdkEventConfigure*, gpointer);
 #if !GTK_CHECK_VERSION(3, 0, 0)
@@ -171,9 +192,11 @@ static gboolean monitors_apply_config(gpointer);
  *                              Monitor functions                             *
  ******************************************************************************/
 static Monitor*
-monitor_init(MonitorsPlugin *mp, Monitor *m, gchar *color)
+monitor_init(MonitorsPlugin *mp, Monitor *m, gchar *color,
+             const char * const *overlays)
 {
     ENTER;
+    int i;
 
     m->da = gtk_drawing_area_new();
     gtk_widget_add_events(m->da, GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK |
@@ -195,12 +218,19 @@ monitor_init(MonitorsPlugin *mp, Monitor *m, gchar *color)
 
     m->maxfree = &mp->show_cached_as_free;
 
+    /* Buffers for extra series are allocated with the stats buffer */
+    for (i = 0; i < N_OVERLAYS && overlays[i]; i++)
+        gdk_color_parse(overlays[i], &m->overlay_colors[i]);
+    m->n_overlays = i;
+
     return m;
 }
 
 static void
 monitor_free(Monitor *m)
 {
+    int i;
+
     if (!m)
         return;
 
@@ -209,6 +239,8 @@ monitor_free(Monitor *m)
         cairo_surface_destroy(m->pixmap);
     if (m->stats)
         g_free(m->stats);
+    for (i = 0; i < (int)m->n_overlays; i++)
+        g_free(m->overlays[i]);
     g_free(m);
 
     return;
@@ -228,55 +260,36 @@ monitor_set_foreground_color(MonitorsPlugin *mp, Monitor *m, const gchar *color)
 /******************************************************************************
  *                                 CPU monitor                                *
  ******************************************************************************/
-typedef unsigned long long CPUTick;/* Value from /proc/stat                   */
 typedef float CPUSample;	   /* Saved CPU utilization value as 0.0..1.0 */
 
-struct cpu_stat {
-    CPUTick u, n, s, i;		  /* User, nice, system, idle */
-};
-
 static gboolean
 cpu_update(Monitor * c)
 {
-    static struct cpu_stat previous_cpu_stat = { 0, 0, 0, 0 };
-
-    if ((c->stats != NULL) && (c->pixmap != NULL))
+    /* Monitors are updated from the sampler callback so the newest sample
+     * is the one taken for this update. Other consumers of the sampler
+     * may take samples in between so compare with own previous one. */
+    const LXPanelProcStat *cur = lxpanel_proc_stat_get(0);
+    gboolean has_prev = c->has_cpu_prev;
+
+    if (cur == NULL)
+        return TRUE;
+    c->has_cpu_prev = TRUE;
+    if ((c->stats != NULL) && (c->pixmap != NULL) && has_prev)
     {
-        /* Open statistics file and scan out CPU usage. */
-        struct cpu_stat cpu;
-        FILE * stat = fopen("/proc/stat", "r");
-        if (stat == NULL)
-            return TRUE;
-        int fscanf_result = fscanf(stat, "cpu %llu %llu %llu %llu",
-                                    &cpu.u, &cpu.n, &cpu.s, &cpu.i);
-        fclose(stat);
-
-        /* Ensure that fscanf succeeded. */
-        if (fscanf_result == 4)
-        {
-            /* Comcolors delta from previous statistics. */
-            struct cpu_stat cpu_delta;
-            cpu_delta.u = cpu.u - previous_cpu_stat.u;
-            cpu_delta.n = cpu.n - previous_cpu_stat.n;
-            cpu_delta.s = cpu.s - previous_cpu_stat.s;
-            cpu_delta.i = cpu.i - previous_cpu_stat.i;
-
-            /* Copy current to previous. */
-            memcpy(&previous_cpu_stat, &cpu, sizeof(struct cpu_stat));
-
-            /* Comcolors user+nice+system as a fraction of total.
-             * Introduce this sample to ring buffer, increment and wrap ring
-             * buffer cursor. */
-            float cpu_uns = cpu_delta.u + cpu_delta.n + cpu_delta.s;
-            c->stats[c->ring_cursor] = cpu_uns / (cpu_uns + cpu_delta.i);
-            c->ring_cursor += 1;
-            if (c->ring_cursor >= c->pixmap_width)
-                c->ring_cursor = 0;
-
-            /* Redraw with the new sample. */
-            redraw_pixmap(c);
-        }
+        LXPanelCpuLoad load;
+
+        /* Introduce this sample to ring buffer, increment and wrap ring
+         * buffer cursor. */
+        c->stats[c->ring_cursor] = lxpanel_cpu_times_load(&cur->cpu,
+                                                          &c->cpu_prev, &load);
+        c->ring_cursor += 1;
+        if (c->ring_cursor >= c->pixmap_width)
+            c->ring_cursor = 0;
+
+        /* Redraw with the new sample. */
+        redraw_pixmap(c);
     }
+    c->cpu_prev = cur->cpu;
     return TRUE;
 }
 
@@ -301,84 +314,204 @@ cpu_tooltip_update (Monitor *m)
 /******************************************************************************
  *                               RAM Monitor                                  *
  ******************************************************************************/
-static gboolean
-mem_update(Monitor * m)
-{
-    ENTER;
 
-    FILE *meminfo;
-    char buf[80];
-    long int mem_total = 0;
-    long int mem_free  = 0;
-    long int mem_buffers = 0;
-    long int mem_cached = 0;
-    long int mem_sreclaimable = 0;
-    unsigned int readmask = 0x10 | 0x8 | 0x4 | 0x2 | 0x1;
+/* Values from /proc/meminfo, in kB */
+typedef struct {
+    guint64 mem_total;
+    guint64 mem_free;
+    guint64 mem_available;
+    guint64 buffers;
+    guint64 cached;
+    guint64 sreclaimable;
+    guint64 shmem;
+    guint64 swap_total;
+    guint64 swap_free;
+    guint64 zswap;          /* compressed size of pages in zswap */
+    guint64 zswapped;       /* original size of pages in zswap */
+    guint   present;        /* MEMINFO_* flags of values found */
+    gint64  time;           /* when values were read */
+} MemInfo;
+
+#define MEMINFO_TOTAL       (1 << 0)
+#define MEMINFO_FREE        (1 << 1)
+#define MEMINFO_AVAILABLE   (1 << 2)
+#define MEMINFO_BUFFERS     (1 << 3)
+#define MEMINFO_CACHED      (1 << 4)
+#define MEMINFO_SRECLAIM    (1 << 5)
+#define MEMINFO_SHMEM       (1 << 6)
+#define MEMINFO_SWAP_TOTAL  (1 << 7)
+#define MEMINFO_SWAP_FREE   (1 << 8)
+#define MEMINFO_ZSWAP       (1 << 9)
+#define MEMINFO_ZSWAPPED    (1 << 10)
+
+/* values required to show memory usage */
+#define MEMINFO_REQUIRED    (MEMINFO_TOTAL | MEMINFO_FREE | MEMINFO_BUFFERS | \
+                             MEMINFO_CACHED | MEMINFO_SRECLAIM)
+
+/* the whole file fits into this easily */
+#define MEMINFO_READ_SIZE   8192
+
+#define MEMINFO_KEY(key, field, flag) \
+    { key, sizeof(key) - 1, G_STRUCT_OFFSET(MemInfo, field), flag }
+
+static const struct {
+    const char *key;
+    gsize len;
+    glong offset;
+    guint flag;
+} meminfo_keys[] = {
+    MEMINFO_KEY("MemTotal", mem_total, MEMINFO_TOTAL),
+    MEMINFO_KEY("MemFree", mem_free, MEMINFO_FREE),
+    MEMINFO_KEY("MemAvailable", mem_available, MEMINFO_AVAILABLE),
+    MEMINFO_KEY("Buffers", buffers, MEMINFO_BUFFERS),
+    MEMINFO_KEY("Cached", cached, MEMINFO_CACHED),
+    MEMINFO_KEY("SReclaimable", sreclaimable, MEMINFO_SRECLAIM),
+    MEMINFO_KEY("Shmem", shmem, MEMINFO_SHMEM),
+    MEMINFO_KEY("SwapTotal", swap_total, MEMINFO_SWAP_TOTAL),
+    MEMINFO_KEY("SwapFree", swap_free, MEMINFO_SWAP_FREE),
+    MEMINFO_KEY("Zswap", zswap, MEMINFO_ZSWAP),
+    MEMINFO_KEY("Zswapped", zswapped, MEMINFO_ZSWAPPED)
+};
 
-    if (!m->stats || !m->pixmap)
-        RET(TRUE);
+/* The file is kept open and values are shared by all monitors */
+static int meminfo_fd = -1;
+static MemInfo meminfo;
 
-    meminfo = fopen("/proc/meminfo", "r");
-    if (!meminfo) {
-        g_warning("monitors: Could not open /proc/meminfo: %d, %s",
+/* Reads /proc/meminfo unless it was read less than half of period ago.
+ * Lines look like "MemTotal:       16314444 kB". */
+static const MemInfo *
+meminfo_read(void)
+{
+    char buf[MEMINFO_READ_SIZE];
+    const char *p, *end, *key;
+    gint64 now = g_get_monotonic_time();
+    gssize len;
+    guint i;
+
+    if (meminfo.present && now - meminfo.time < UPDATE_PERIOD * 500000)
+        return &meminfo;
+
+    if (meminfo_fd < 0)
+    {
+        meminfo_fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+        if (meminfo_fd < 0)
+        {
+            g_warning("monitors: Could not open /proc/meminfo: %d, %s",
+                      errno, strerror(errno));
+            return NULL;
+        }
+    }
+    len = pread(meminfo_fd, buf, sizeof(buf), 0);
+    if (len <= 0)
+    {
+        g_warning("monitors: Could not read /proc/meminfo: %d, %s",
                   errno, strerror(errno));
-        RET(FALSE);
+        close(meminfo_fd);
+        meminfo_fd = -1;
+        return NULL;
     }
 
-    while (readmask && fgets(buf, sizeof(buf), meminfo)) {
-        if (sscanf(buf, "MemTotal: %ld kB\n", &mem_total) == 1) {
-            readmask ^= 0x1;
-            continue;
-        }
-        if (sscanf(buf, "MemFree: %ld kB\n", &mem_free) == 1) {
-            readmask ^= 0x2;
-            continue;
-        }
-        if (sscanf(buf, "Buffers: %ld kB\n", &mem_buffers) == 1) {
-            readmask ^= 0x4;
-            continue;
-        }
-        if (sscanf(buf, "Cached: %ld kB\n", &mem_cached) == 1) {
-            readmask ^= 0x8;
-            continue;
-        }
-        if (sscanf(buf, "SReclaimable: %ld kB\n", &mem_sreclaimable) == 1) {
-            readmask ^= 0x10;
-            continue;
+    meminfo.present = 0;
+    for (p = buf, end = buf + len; p < end; p++)
+    {
+        key = p;
+        while (p < end && *p != ':' && *p != '\n')
+            p++;
+        if (p == end)
+            break;
+        if (*p == ':')
+        {
+            for (i = 0; i < G_N_ELEMENTS(meminfo_keys); i++)
+            {
+                if (meminfo_keys[i].len == (gsize)(p - key) &&
+                    memcmp(meminfo_keys[i].key, key, p - key) == 0)
+                {
+                    guint64 v = 0;
+
+                    for (p++; p < end && *p == ' '; p++);
+                    for (; p < end && *p >= '0' && *p <= '9'; p++)
+                        v = v * 10 + (guint64)(*p - '0');
+                    G_STRUCT_MEMBER(guint64, &meminfo, meminfo_keys[i].offset) = v;
+                    meminfo.present |= meminfo_keys[i].flag;
+                    break;
+                }
+            }
+            /* skip the rest of line */
+            while (p < end && *p != '\n')
+                p++;
         }
     }
+    meminfo.time = now;
 
-    fclose(meminfo);
-
-    if (readmask) {
+    if ((meminfo.present & MEMINFO_REQUIRED) != MEMINFO_REQUIRED)
+    {
         g_warning("monitors: Couldn't read all values from /proc/meminfo: "
-                  "readmask %x", readmask);
-        RET(FALSE);
+                  "readmask %x", MEMINFO_REQUIRED & ~meminfo.present);
+        meminfo.present = 0;
+        return NULL;
     }
+    return &meminfo;
+}
 
-    m->total = mem_total;
+static inline void
+monitor_add_sample(Monitor *m, float value)
+{
+    m->stats[m->ring_cursor] = value;
+    m->ring_cursor++;
+    if (m->ring_cursor >= m->pixmap_width)
+        m->ring_cursor = 0;
+
+    /* Redraw the pixmap, with the new sample */
+    redraw_pixmap (m);
+}
+
+static gboolean
+mem_update(Monitor * m)
+{
+    ENTER;
+
+    const MemInfo *mi;
+    float used;
+
+    if (!m->stats || !m->pixmap)
+        RET(TRUE);
+
+    mi = meminfo_read();
+    if (mi == NULL || mi->mem_total == 0)
+        RET(FALSE);
+
+    m->total = mi->mem_total;
 
     /* Adding stats to the buffer:
-     * It is debatable if 'mem_buffers' counts as free or not. I'll go with
-     * 'free', because it can be flushed fairly quickly, and generally
-     * isn't necessary to keep in memory.
+     * If the kernel provides MemAvailable then its estimation of memory
+     * available for new applications is used.
+     * Otherwise it is debatable if 'mem_buffers' counts as free or not.
+     * I'll go with 'free', because it can be flushed fairly quickly, and
+     * generally isn't necessary to keep in memory.
      * It is hard to draw the line, which caches should be counted as free,
      * and which not. 'free' command line utility from procps counts
      * SReclaimable as free so it's counted it here as well (note that
      * 'man free' doesn't specify this)
      * 'mem_cached' definitely counts as 'free' because it is immediately
      * released should any application need it. */
-    m->stats[m->ring_cursor] = mem_total - mem_free;
-    if (*m->maxfree)
-        m->stats[m->ring_cursor] -= mem_buffers + mem_cached + mem_sreclaimable;
-    m->stats[m->ring_cursor] /= (float)mem_total;
-
-    m->ring_cursor++;
-    if (m->ring_cursor >= m->pixmap_width)
-        m->ring_cursor = 0;
-
-    /* Redraw the pixmap, with the new sample */
-    redraw_pixmap (m);
+    if (!*m->maxfree)
+        used = mi->mem_total - mi->mem_free;
+    else if (mi->present & MEMINFO_AVAILABLE)
+        used = mi->mem_total - MIN(mi->mem_available, mi->mem_total);
+    else
+        used = (float)mi->mem_total - mi->mem_free - mi->buffers
+               - mi->cached - mi->sreclaimable;
+
+    /* Extra series: memory which is not available for new applications,
+     * unless the graph shows it already, and shared memory (tmpfs etc.) */
+    m->overlays[MEM_OVERLAY_UNAVAILABLE][m->ring_cursor] =
+        (!*m->maxfree && (mi->present & MEMINFO_AVAILABLE))
+        ? (float)(mi->mem_total - MIN(mi->mem_available, mi->mem_total))
+          / (float)mi->mem_total
+        : 0.0;
+    m->overlays[MEM_OVERLAY_SHMEM][m->ring_cursor] =
+        (mi->present & MEMINFO_SHMEM) ? mi->shmem / (float)mi->mem_total : 0.0;
+    monitor_add_sample(m, used / (float)mi->mem_total);
 
     RET(TRUE);
 }
@@ -387,23 +520,150 @@ static void
 mem_tooltip_update (Monitor *m)
 {
     if (m && m->stats) {
-        gchar *tooltip_text;
+        GString *tooltip_text = g_string_sized_new(128);
         gint ring_pos = (m->ring_cursor == 0)
             ? m->pixmap_width - 1 : m->ring_cursor - 1;
-        tooltip_text = g_strdup_printf(_("RAM usage: %.1fMB (%.2f%%)"),
+        g_string_printf(tooltip_text, _("RAM usage: %.1fMB (%.2f%%)"),
                 m->stats[ring_pos] * m->total / 1024,
                 m->stats[ring_pos] * 100);
-        gtk_widget_set_tooltip_text(m->da, tooltip_text);
-        g_free(tooltip_text);
+        if (meminfo.present & MEMINFO_AVAILABLE)
+        {
+            g_string_append_c(tooltip_text, '\n');
+            g_string_append_printf(tooltip_text, _("Available: %.1fMB"),
+                                   meminfo.mem_available / 1024.0);
+        }
+        if (meminfo.present & MEMINFO_SHMEM)
+        {
+            g_string_append_c(tooltip_text, '\n');
+            g_string_append_printf(tooltip_text, _("Shared: %.1fMB"),
+                                   meminfo.shmem / 1024.0);
+        }
+        gtk_widget_set_tooltip_text(m->da, tooltip_text->str);
+        g_string_free(tooltip_text, TRUE);
     }
 }
 /******************************************************************************
  *                             End of RAM Monitor                             *
  ******************************************************************************/
 
+/******************************************************************************
+ *                               Swap Monitor                                 *
+ ******************************************************************************/
+static gboolean
+swap_update(Monitor * m)
+{
+    ENTER;
+
+    const MemInfo *mi;
+
+    if (!m->stats || !m->pixmap)
+        RET(TRUE);
+
+    mi = meminfo_read();
+    if (mi == NULL)
+        RET(FALSE);
+
+    m->total = mi->swap_total;
+
+    /* Extra series: original size of swapped pages kept compressed in RAM */
+    m->overlays[SWAP_OVERLAY_ZSWAP][m->ring_cursor] =
+        ((mi->present & MEMINFO_ZSWAPPED) && mi->swap_total > 0)
+        ? mi->zswapped / (float)mi->swap_total : 0.0;
+    if (mi->swap_total == 0)
+        monitor_add_sample(m, 0.0);
+    else
+        monitor_add_sample(m, (float)(mi->swap_total - MIN(mi->swap_free, mi->swap_total))
+                              / (float)mi->swap_total);
+
+    RET(TRUE);
+}
+
+static void
+swap_tooltip_update (Monitor *m)
+{
+    if (m && m->stats) {
+        GString *tooltip_text = g_string_sized_new(128);
+        gint ring_pos = (m->ring_cursor == 0)
+            ? m->pixmap_width - 1 : m->ring_cursor - 1;
+        if (m->total == 0)
+            g_string_assign(tooltip_text, _("No swap"));
+        else
+            g_string_printf(tooltip_text, _("Swap usage: %.1fMB (%.2f%%)"),
+                    m->stats[ring_pos] * m->total / 1024,
+                    m->stats[ring_pos] * 100);
+        if ((meminfo.present & (MEMINFO_ZSWAP | MEMINFO_ZSWAPPED)) ==
+                (MEMINFO_ZSWAP | MEMINFO_ZSWAPPED) && meminfo.zswapped > 0)
+        {
+            g_string_append_c(tooltip_text, '\n');
+            g_string_append_printf(tooltip_text, _("Zswap: %.1fMB compressed to %.1fMB"),
+                                   meminfo.zswapped / 1024.0, meminfo.zswap / 1024.0);
+        }
+        gtk_widget_set_tooltip_text(m->da, tooltip_text->str);
+        g_string_free(tooltip_text, TRUE);
+    }
+}
+/******************************************************************************
+ *                             End of Swap Monitor                            *
+ ******************************************************************************/
+
 /******************************************************************************
  *                            Basic events handlers                           *
  ******************************************************************************/
+/*
+ * Reallocates a ring buffer of samples for new width, preserving existing
+ * data. Returns the new buffer, the old one is freed.
+ */
+static stats_set *
+resize_stats(stats_set *stats, int width, int ring_cursor, int new_width)
+{
+    stats_set *new_stats = g_new0(stats_set, new_width);
+
+    if (stats)
+    {
+        /* New allocation is larger.
+         * Add new "oldest" samples of zero following the cursor*/
+        if (new_width > width)
+        {
+            /* Number of values between the ring cursor and the end of
+             * the buffer */
+            int nvalues = width - ring_cursor;
+
+            memcpy(new_stats,
+                   stats,
+                   ring_cursor * sizeof (stats_set));
+            memcpy(new_stats + nvalues,
+                   stats + ring_cursor,
+                   nvalues * sizeof(stats_set));
+        }
+        /* New allocation is smaller, but still larger than the ring
+         * buffer cursor */
+        else if (ring_cursor <= new_width)
+        {
+            /* Numver of values that can be stored between the end of
+             * the new buffer and the ring cursor */
+            int nvalues = new_width - ring_cursor;
+            memcpy(new_stats,
+                   stats,
+                   ring_cursor * sizeof(stats_set));
+            memcpy(new_stats + ring_cursor,
+                   stats + width - nvalues,
+                   nvalues * sizeof(stats_set));
+        }
+        /* New allocation is smaller, and also smaller than the ring
+         * buffer cursor.  Discard all oldest samples following the ring
+         * buffer cursor and additional samples at the beginning of the
+         * buffer. */
+        else
+        {
+            memcpy(new_stats,
+                   stats + ring_cursor - new_width,
+                   new_width * sizeof(stats_set));
+        }
+        g_free(stats);
+    }
+    return new_stats;
+}
+
 static gboolean
 configure_event(GtkWidget* widget, GdkEventConfigure* dummy, gpointer data)
 {
@@ -428,55 +688,13 @@ configure_event(GtkWidget* widget, GdkEventConfigure* dummy, gpointer data)
          */
         if (!m->stats || (new_pixmap_width != m->pixmap_width))
         {
-            stats_set *new_stats = g_new0(stats_set, new_pixmap_width);
-
-            if (!new_stats)
-                return TRUE;
+            guint i;
 
-            if (m->stats)
-            {
-                /* New allocation is larger.
-                 * Add new "oldest" samples of zero following the cursor*/
-                if (new_pixmap_width > m->pixmap_width)
-                {
-                    /* Number of values between the ring cursor and the end of
-                     * the buffer */
-                    int nvalues = m->pixmap_width - m->ring_cursor;
-
-                    memcpy(new_stats,
-                           m->stats,
-                           m->ring_cursor * sizeof (stats_set));
-                    memcpy(new_stats + nvalues,
-                           m->stats + m->ring_cursor,
-                           nvalues * sizeof(stats_set));
-                }
-                /* New allocation is smaller, but still larger than the ring
-                 * buffer cursor */
-                else if (m->ring_cursor <= new_pixmap_width)
-                {
-                    /* Numver of values that can be stored between the end of
-                     * the new buffer and the ring cursor */
-                    int nvalues = new_pixmap_width - m->ring_cursor;
-                    memcpy(new_stats,
-                           m->stats,
-                           m->ring_cursor * sizeof(stats_set));
-                    memcpy(new_stats + m->ring_cursor,
-                           m->stats + m->pixmap_width - nvalues,
-                           nvalues * sizeof(stats_set));
-                }
-                /* New allocation is smaller, and also smaller than the ring
-                 * buffer cursor.  Discard all oldest samples following the ring
-                 * buffer cursor and additional samples at the beginning of the
-                 * buffer. */
-                else
-                {
-                    memcpy(new_stats,
-                           m->stats + m->ring_cursor - new_pixmap_width,
-                           new_pixmap_width * sizeof(stats_set));
-                }
-                g_free(m->stats);
-            }
-            m->stats = new_stats;
+            m->stats = resize_stats(m->stats, m->pixmap_width, m->ring_cursor,
+                                    new_pixmap_width);
+            for (i = 0; i < m->n_overlays; i++)
+                m->overlays[i] = resize_stats(m->overlays[i], m->pixmap_width,
+                                              m->ring_cursor, new_pixmap_width);
         }
 
         m->pixmap_width = new_pixmap_width;
@@ -549,6 +767,7 @@ static void
 redraw_pixmap (Monitor *m)
 {
     int i;
+    guint k;
     cairo_t *cr = cairo_create(m->pixmap);
     GtkStyle *style = gtk_widget_get_style(m->da);
 
@@ -569,6 +788,33 @@ redraw_pixmap (Monitor *m)
         cairo_stroke(cr);
     }
 
+    /* Draw extra series as lines, skipping unknown values */
+    for (k = 0; k < m->n_overlays; k++)
+    {
+        gboolean drawing = FALSE;
+
+        gdk_cairo_set_source_color(cr, &m->overlay_colors[k]);
+        for (i = 0; i < m->pixmap_width; i++)
+        {
+            unsigned int drawing_cursor = (m->ring_cursor + i) % m->pixmap_width;
+            stats_set value = m->overlays[k][drawing_cursor];
+            double y;
+
+            if (value <= 0.0)
+            {
+                drawing = FALSE;
+                continue;
+            }
+            y = (1.0 - MIN(value, 1.0)) * (m->pixmap_height - 1) + 0.5;
+            if (drawing)
+                cairo_line_to(cr, i + 0.5, y);
+            else
+                cairo_move_to(cr, i + 0.5, y);
+            drawing = TRUE;
+        }
+        cairo_stroke(cr);
+    }
+
     check_cairo_status(cr);
     cairo_destroy(cr);
     /* Redraw pixmap */
@@ -578,43 +824,53 @@ redraw_pixmap (Monitor *m)
 
 static update_func update_functions [N_MONITORS] = {
     [CPU_POSITION] = cpu_update,
-    [MEM_POSITION] = mem_update
+    [MEM_POSITION] = mem_update,
+    [SWAP_POSITION] = swap_update
 };
 
 static char *default_colors[N_MONITORS] = {
     [CPU_POSITION] = "#0000FF",
-    [MEM_POSITION] = "#FF0000"
+    [MEM_POSITION] = "#FF0000",
+    [SWAP_POSITION] = "#FF8000"
+};
+
+/* Colors of extra series, a monitor has series up to the first NULL */
+static const char *overlay_colors[N_MONITORS][N_OVERLAYS + 1] = {
+    [CPU_POSITION] = { NULL },
+    [MEM_POSITION] = { [MEM_OVERLAY_UNAVAILABLE] = "#FFFF00",
+                       [MEM_OVERLAY_SHMEM] = "#00FF00", NULL },
+    [SWAP_POSITION] = { [SWAP_OVERLAY_ZSWAP] = "#00FFFF", NULL }
 };
 
 
 static tooltip_update_func tooltip_update[N_MONITORS] = {
     [CPU_POSITION] = cpu_tooltip_update,
-    [MEM_POSITION] = mem_tooltip_update
+    [MEM_POSITION] = mem_tooltip_update,
+    [SWAP_POSITION] = swap_tooltip_update
 };
 
 /* Colors currently used. We cannot store them in the "struct Monitor"s where
  * they belong, because we free these when the user removes them. And since we
  * want the colors to stay the same even after removing/adding a widget... */
 static char *colors[N_MONITORS] = {
+    NULL,
     NULL,
     NULL
 };
 
 /*
- * This function is called every UPDATE_PERIOD seconds. It updates all
- * monitors.
+ * This function is called by the /proc/stat sampler every UPDATE_PERIOD
+ * seconds. It updates all monitors.
  */
-static gboolean
-monitors_update(gpointer data)
+static void
+monitors_update(const LXPanelProcStat *stat, gpointer data)
 {
     MonitorsPlugin *mp;
     int i;
 
-    if (g_source_is_destroyed(g_main_current_source()))
-        return FALSE;
     mp = (MonitorsPlugin *) data;
     if (!mp)
-        RET(FALSE);
+        RET();
 
     for (i = 0; i < N_MONITORS; i++)
     {
@@ -625,20 +881,19 @@ monitors_update(gpointer data)
                 mp->monitors[i]->update_tooltip(mp->monitors[i]);
         }
     }
-
-    return TRUE;
 }
 
 static Monitor*
 monitors_add_monitor (GtkWidget *p, MonitorsPlugin *mp, update_func update,
-             tooltip_update_func update_tooltip, gchar *color)
+             tooltip_update_func update_tooltip, gchar *color,
+             const char * const *overlays)
 {
     ENTER;
 
     Monitor *m;
 
     m = g_new0(Monitor, 1);
-    m = monitor_init(mp, m, color);
+    m = monitor_init(mp, m, color, overlays);
     m->update = update;
     m->update_tooltip = update_tooltip;
     gtk_box_pack_start(GTK_BOX(p), m->da, FALSE, FALSE, 0);
@@ -674,6 +929,8 @@ monitors_constructor(LXPanel *panel, config_setting_t *settings)
                               &mp->displayed_monitors[CPU_POSITION]);
     config_setting_lookup_int(settings, "DisplayRAM",
                               &mp->displayed_monitors[MEM_POSITION]);
+    config_setting_lookup_int(settings, "DisplaySwap",
+                              &mp->displayed_monitors[SWAP_POSITION]);
     config_setting_lookup_int(settings, "ShowCachedAsFree",
                               &mp->show_cached_as_free);
     if (config_setting_lookup_string(settings, "Action", &tmp))
@@ -682,6 +939,8 @@ monitors_constructor(LXPanel *panel, config_setting_t *settings)
         colors[CPU_POSITION] = g_strndup(tmp, COLOR_SIZE-1);
     if (config_setting_lookup_string(settings, "RAMColor", &tmp))
         colors[MEM_POSITION] = g_strndup(tmp, COLOR_SIZE-1);
+    if (config_setting_lookup_string(settings, "SwapColor", &tmp))
+        colors[SWAP_POSITION] = g_strndup(tmp, COLOR_SIZE-1);
 
     /* Initializing monitors */
     for (i = 0; i < N_MONITORS; i++)
@@ -694,14 +953,15 @@ monitors_constructor(LXPanel *panel, config_setting_t *settings)
             mp->monitors[i] = monitors_add_monitor(p, mp,
                                                    update_functions[i],
                                                    tooltip_update[i],
-                                                   colors[i]);
+                                                   colors[i],
+                                                   overlay_colors[i]);
         }
     }
 
-    /* Adding a timer : monitors will be updated every UPDATE_PERIOD
-     * seconds */
-    mp->timer = g_timeout_add_seconds(UPDATE_PERIOD, (GSourceFunc) monitors_update,
-                              (gpointer) mp);
+    /* CPU monitor reads samples of /proc/stat from the shared sampler,
+     * all monitors will be updated with it every UPDATE_PERIOD seconds */
+    mp->sampler = lxpanel_proc_stat_subscribe(p, UPDATE_PERIOD * 1000,
+                                              monitors_update, mp);
     RET(p);
 }
 
@@ -714,8 +974,8 @@ monitors_destructor(gpointer user_data)
 
     mp = (MonitorsPlugin *) user_data;
 
-    /* Removing timer */
-    g_source_remove(mp->timer);
+    /* Stopping updates */
+    lxpanel_proc_stat_unsubscribe(mp->sampler);
 
     /* Freeing all monitors */
     for (i = 0; i < N_MONITORS; i++)
@@ -747,6 +1007,8 @@ monitors_config (LXPanel *panel, GtkWidget *p)
         _("CPU color"), &colors[CPU_POSITION], CONF_TYPE_STR,
         _("Display RAM usage"), &mp->displayed_monitors[1], CONF_TYPE_BOOL,
         _("RAM color"), &colors[MEM_POSITION], CONF_TYPE_STR,
+        _("Display swap usage"), &mp->displayed_monitors[SWAP_POSITION], CONF_TYPE_BOOL,
+        _("Swap color"), &colors[SWAP_POSITION], CONF_TYPE_STR,
         _("Show memory used by cache as free"), &mp->show_cached_as_free, CONF_TYPE_BOOL,
         _("Action when clicked (default: lxtask)"), &mp->action, CONF_TYPE_STR,
         NULL);
@@ -781,7 +1043,8 @@ start:
             mp->monitors[i] = monitors_add_monitor(p, mp,
                                                    update_functions[i],
                                                    tooltip_update[i],
-                                                   colors[i]);
+                                                   colors[i],
+                                                   overlay_colors[i]);
             /*
              * It is probably best for users if their monitors are always
              * displayed in the same order : the CPU monitor always on the left,
@@ -818,12 +1081,15 @@ start:
     }
     config_group_set_int(mp->settings, "DisplayCPU", mp->displayed_monitors[CPU_POSITION]);
     config_group_set_int(mp->settings, "DisplayRAM", mp->displayed_monitors[MEM_POSITION]);
+    config_group_set_int(mp->settings, "DisplaySwap", mp->displayed_monitors[SWAP_POSITION]);
     config_group_set_int(mp->settings, "ShowCachedAsFree", mp->show_cached_as_free);
     config_group_set_string(mp->settings, "Action", mp->action);
     config_group_set_string(mp->settings, "CPUColor",
                             mp->monitors[CPU_POSITION] ? colors[CPU_POSITION] : NULL);
     config_group_set_string(mp->settings, "RAMColor",
                             mp->monitors[MEM_POSITION] ? colors[MEM_POSITION] : NULL);
+    config_group_set_string(mp->settings, "SwapColor",
+                            mp->monitors[SWAP_POSITION] ? colors[SWAP_POSITION] : NULL);
 
     RET(FALSE);
 }
@@ -38,6 +38,7 @@
 #include "netstat.h"
 #include "statusicon.h"
 #include "devproc.h"
+#include "proc-net-dev.h"
 #include "dbg.h"
 
 /* network device list */
@@ -132,90 +133,11 @@ static NETDEVLIST_PTR netproc_netdevlist_find(
 	return NULL;
 }
 
-static char *netproc_parse_ifname(const char *buffer)
+int netproc_scandevice(int sockfd, int iwsockfd, NETDEVLIST_PTR *netdev_list)
 {
-	char *ptr;
-	if ((ptr = strchr(buffer, ':'))) {
-		*ptr++ = '\0';
-	}
-
-	return ptr;
-}
-
-static void netproc_parse_stats_header(char *buffer,
-                                       int *prx_idx,
-                                       int *ptx_idx,
-                                       int *brx_idx,
-                                       int *btx_idx)
-{
-	char *p;
-	int i;
-
-	*prx_idx = *ptx_idx = -1;
-	*brx_idx = *btx_idx = -1;
-
-	p = strtok (buffer, "| \t\n");
-	p = strtok (NULL, "| \t\n");
-	for (i = 0; p; i++, p = strtok (NULL, "| \t\n")) {
-		if (!strcmp (p, "packets")) {
-			if (*prx_idx == -1)
-				*prx_idx = i;
-			else
-				*ptx_idx = i;
-		} else if (!strcmp (p, "bytes")) {
-			if (*brx_idx == -1)
-				*brx_idx = i;
-			else
-				*btx_idx = i;
-		}
-	}
-}
-
-static gboolean netproc_parse_status(char *buffer,
-                                     int prx_idx,
-                                     int ptx_idx,
-                                     gulong *in_packets,
-                                     gulong *out_packets,
-                                     int brx_idx,
-                                     int btx_idx,
-                                     gulong *in_bytes,
-                                     gulong *out_bytes)
-{
-	char *ptr;
-	int i;
-	ptr = strtok(buffer, " \t\n");
-	for (i=0;ptr;i++, ptr = strtok(NULL, " \t\n")) {
-		if (i==prx_idx)
-			*in_packets = g_ascii_strtoull(ptr, NULL, 10);
-		else if (i==ptx_idx)
-			*out_packets = g_ascii_strtoull(ptr, NULL, 10);
-		else if (i==brx_idx)
-			*in_bytes = g_ascii_strtoull(ptr, NULL, 10);
-		else if (i==btx_idx)
-			*out_bytes = g_ascii_strtoull(ptr, NULL, 10);
-	}
-
-	if (i <= prx_idx || i <= ptx_idx || i <= brx_idx || i <=btx_idx)
-		return FALSE;
-
-	return TRUE;
-}
-
-FILE *netproc_open()
-{
-	return fopen("/proc/net/dev", "r");
-}
-
-void netproc_close(FILE *fp)
-{
-	fclose(fp);
-}
-
-int netproc_scandevice(int sockfd, int iwsockfd, FILE *fp, NETDEVLIST_PTR *netdev_list)
-{
-	char buffer[512];
+	const LXPanelNetDev * const *devs;
+	guint n_devs, i;
 	int count = 0;
-	int prx_idx, ptx_idx, brx_idx, btx_idx;
 	gulong in_packets, out_packets, in_bytes, out_bytes;
 	NETDEVLIST_PTR devptr = NULL;
 
@@ -223,31 +145,22 @@ int netproc_scandevice(int sockfd, int iwsockfd, FILE *fp, NETDEVLIST_PTR *netde
 	struct ifreq ifr;
 	struct ethtool_test edata;
 	iwstats iws;
-	char *status;
-	char *name;
+	const char *name;
 	struct iw_range iwrange;
 	int has_iwrange = 0;
 
-	status = fgets (buffer, sizeof(buffer), fp);
-	if (!status)
-		g_warning("netstat: netproc_scnadevice(): Error reading first line from stream!");
-	status = fgets (buffer, sizeof(buffer), fp);
-	if (!status)
-		g_warning("netstat: netproc_scnadevice(): Error reading second line from stream!");
-	netproc_parse_stats_header(buffer, &prx_idx, &ptx_idx, &brx_idx, &btx_idx);
-
-	while (fgets(buffer, sizeof(buffer), fp)) {
-		/* getting interface name */
-		name = buffer;
-		while (g_ascii_isspace(name[0])) {
-			name++;
-		}
+	/* the snapshot of /proc/net/dev is shared with other plugins */
+	devs = lxpanel_net_dev_list(NETSTAT_IFACE_POLL_DELAY / 2, &n_devs);
+	if (devs == NULL)
+		g_warning("netstat: netproc_scandevice(): Error reading /proc/net/dev!");
 
+	for (i = 0; i < n_devs; i++) {
 		/* reading packet infomation */
-		in_packets = out_packets = in_bytes = out_bytes = 0L;
-		status = netproc_parse_ifname(name);
-		netproc_parse_status(status, prx_idx, ptx_idx, &in_packets, &out_packets,
-				     brx_idx, btx_idx, &in_bytes, &out_bytes);
+		name = devs[i]->name;
+		in_packets = devs[i]->rx_packets;
+		out_packets = devs[i]->tx_packets;
+		in_bytes = devs[i]->rx_bytes;
+		out_bytes = devs[i]->tx_bytes;
 
 		/* check interface hw_type */
 		bzero(&ifr, sizeof(ifr));
@@ -456,9 +369,6 @@ int netproc_scandevice(int sockfd, int iwsockfd, FILE *fp, NETDEVLIST_PTR *netde
 		count++;
 	}
 
-	rewind(fp);
-	fflush(fp);
-
 	return count;
 }
 
@@ -502,9 +412,7 @@ void netproc_listener(FNETD *fnetd)
 {
 	if (fnetd->sockfd) {
 		netproc_alive(fnetd->netdevlist);
-		fnetd->netdev_fp = netproc_open();
-		netproc_scandevice(fnetd->sockfd, fnetd->iwsockfd, fnetd->netdev_fp, &fnetd->netdevlist);
-		netproc_close(fnetd->netdev_fp);
+		netproc_scandevice(fnetd->sockfd, fnetd->iwsockfd, &fnetd->netdevlist);
 	}
 }
 
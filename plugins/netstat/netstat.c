@@ -42,9 +42,6 @@
 #include "misc.h"
 #include "dbg.h"
 
-/* 1 second */
-#define NETSTAT_IFACE_POLL_DELAY 3000
-
 static void* actionProcess(void *arg)
 {
     ENTER;
@@ -432,7 +429,7 @@ static void netstat_destructor(gpointer user_data)
     netstat *ns = (netstat *) user_data;
 
     ENTER;
-    g_source_remove(ns->ttag);
+    lxpanel_timer_remove(ns->ttag);
     netproc_netdevlist_clear(&ns->fnetd->netdevlist);
     /* The widget is destroyed in plugin_stop().
     gtk_widget_destroy(ns->mainw);
@@ -475,16 +472,14 @@ static GtkWidget *netstat_constructor(LXPanel *panel, config_setting_t *settings
     gtk_widget_show_all(ns->mainw);
 
     /* Initializing network device list*/
-    ns->fnetd->netdev_fp = netproc_open();
     ns->fnetd->dev_count = netproc_netdevlist_clear(&ns->fnetd->netdevlist);
-    ns->fnetd->dev_count = netproc_scandevice(ns->fnetd->sockfd, ns->fnetd->iwsockfd, ns->fnetd->netdev_fp, &ns->fnetd->netdevlist);
-    netproc_close(ns->fnetd->netdev_fp);
+    ns->fnetd->dev_count = netproc_scandevice(ns->fnetd->sockfd, ns->fnetd->iwsockfd, &ns->fnetd->netdevlist);
     refresh_systray(ns, ns->fnetd->netdevlist);
 
-    ns->ttag = g_timeout_add(NETSTAT_IFACE_POLL_DELAY, (GSourceFunc)refresh_devstat, ns);
-
     p = gtk_event_box_new();
     lxpanel_plugin_set_data(p, ns, netstat_destructor);
+
+    ns->ttag = lxpanel_timer_add(p, NETSTAT_IFACE_POLL_DELAY, (GSourceFunc)refresh_devstat, ns);
     gtk_widget_set_has_window(p, FALSE);
     gtk_container_add((GtkContainer*)p, ns->mainw);
 
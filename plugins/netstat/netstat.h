@@ -14,6 +14,9 @@
 #define NETDEV_STAT_SENDDATA	4
 #define NETDEV_STAT_RECVDATA	5
 
+/* 3 seconds */
+#define NETSTAT_IFACE_POLL_DELAY 3000
+
 /* forward declaration for UI interaction. */
 struct statusicon;
 
@@ -65,7 +68,6 @@ typedef struct {
 	int sockfd;
 	int iwsockfd;
 	GIOChannel *lxnmchannel;
-	FILE *netdev_fp;
 	NETDEVLIST_PTR netdevlist;
 } FNETD;
 
@@ -55,6 +55,7 @@
 #define NETSTATUS_IFACE_POLL_DELAY       500  /* milliseconds between polls */
 #define NETSTATUS_IFACE_POLLS_IN_ERROR   10   /* no. of polls in error before increasing delay */
 #define NETSTATUS_IFACE_ERROR_POLL_DELAY 5000 /* delay to use when in error state */
+#define NETSTATUS_IFACE_MIN_POLL_DELAY   100  /* shortest delay user may set */
 
 enum
 {
@@ -78,6 +79,11 @@ struct _NetstatusIfacePrivate
 
   int             sockfd;
   guint           monitor_id;
+  guint           monitor_delay;
+  guint           poll_delay;
+
+  int             link_fd;
+  guint           link_watch_id;
 
   guint           error_polling : 1;
   guint           is_wireless : 1;
@@ -97,6 +103,7 @@ static void     netstatus_iface_get_property    (GObject             *object,
 						 GParamSpec          *pspec);
 static gboolean netstatus_iface_monitor_timeout (NetstatusIface      *iface);
 static void     netstatus_iface_init_monitor    (NetstatusIface      *iface);
+static void     netstatus_iface_schedule_poll   (NetstatusIface      *iface);
 
 static GObjectClass *parent_class;
 
@@ -130,6 +137,8 @@ netstatus_iface_instance_init (NetstatusIface      *iface,
 {
   iface->priv = g_new0 (NetstatusIfacePrivate, 1);
   iface->priv->state = NETSTATUS_STATE_DISCONNECTED;
+  iface->priv->poll_delay = NETSTATUS_IFACE_POLL_DELAY;
+  iface->priv->link_fd = -1;
 }
 
 static void
@@ -208,6 +217,14 @@ netstatus_iface_finalize (GObject *object)
     g_source_remove (iface->priv->monitor_id);
   iface->priv->monitor_id = 0;
 
+  if (iface->priv->link_watch_id)
+    g_source_remove (iface->priv->link_watch_id);
+  iface->priv->link_watch_id = 0;
+
+  if (iface->priv->link_fd >= 0)
+    close (iface->priv->link_fd);
+  iface->priv->link_fd = -1;
+
   if (iface->priv->sockfd)
     close (iface->priv->sockfd);
   iface->priv->sockfd = 0;
@@ -309,6 +326,18 @@ netstatus_iface_set_name (NetstatusIface *iface,
   g_object_notify (G_OBJECT (iface), "name");
 }
 
+/* Sets delay between polls of statistics while interface is connected */
+void
+netstatus_iface_set_poll_delay (NetstatusIface *iface,
+				guint           delay)
+{
+  g_return_if_fail (NETSTATUS_IS_IFACE (iface));
+
+  iface->priv->poll_delay = MAX (delay, NETSTATUS_IFACE_MIN_POLL_DELAY);
+  if (iface->priv->monitor_id)
+    netstatus_iface_schedule_poll (iface);
+}
+
 const char *
 netstatus_iface_get_name (NetstatusIface *iface)
 {
@@ -490,6 +519,37 @@ netstatus_iface_poll_state (NetstatusIface *iface)
   gulong         in_packets, out_packets;
   gulong         in_bytes, out_bytes;
 
+  if (iface->priv->link_fd >= 0)
+    {
+      char     *error_message;
+      gboolean  is_up;
+
+      /* flags and statistics of the interface with a single request */
+      error_message = netstatus_sysdeps_read_iface_link (iface->priv->name,
+							 &is_up,
+							 &in_packets,
+							 &out_packets,
+							 &in_bytes,
+							 &out_bytes);
+      if (error_message)
+	{
+	  netstatus_iface_set_polling_error (iface,
+					     NETSTATUS_ERROR_IOCTL_IFFLAGS,
+					     "%s", error_message);
+	  g_free (error_message);
+	  return NETSTATUS_STATE_DISCONNECTED;
+	}
+
+      netstatus_iface_clear_error (iface, NETSTATUS_ERROR_IOCTL_IFFLAGS);
+
+      dprintf (POLLING, "Interface is %sup and running\n", is_up ? "" : "not ");
+
+      if (!is_up)
+	return NETSTATUS_STATE_DISCONNECTED;
+
+      goto got_statistics;
+    }
+
   if (!(fd = netstatus_iface_get_sockfd (iface)))
     return NETSTATUS_STATE_DISCONNECTED;
 
@@ -517,6 +577,7 @@ netstatus_iface_poll_state (NetstatusIface *iface)
   if (!netstatus_iface_poll_iface_statistics (iface, &in_packets, &out_packets, &in_bytes, &out_bytes))
     return NETSTATUS_STATE_IDLE;
 
+got_statistics:
   dprintf (POLLING, "Packets in: %ld out: %ld. Prev in: %ld out: %ld\n",
 	   in_packets, out_packets,
 	   iface->priv->stats.in_packets, iface->priv->stats.out_packets);
@@ -591,10 +652,6 @@ netstatus_iface_increase_poll_delay_in_error (NetstatusIface *iface)
 	{
 	  dprintf (POLLING, "Increasing polling delay after too many errors\n");
 	  iface->priv->error_polling = TRUE;
-	  g_source_remove (iface->priv->monitor_id);
-	  iface->priv->monitor_id = g_timeout_add (NETSTATUS_IFACE_ERROR_POLL_DELAY,
-						   (GSourceFunc) netstatus_iface_monitor_timeout,
-						   iface);
 	}
     }
   else if (iface->priv->error_polling)
@@ -603,24 +660,50 @@ netstatus_iface_increase_poll_delay_in_error (NetstatusIface *iface)
 
       iface->priv->error_polling = FALSE;
       polls_in_error = 0;
+    }
+}
 
-      g_source_remove (iface->priv->monitor_id);
-      iface->priv->monitor_id = g_timeout_add (NETSTATUS_IFACE_POLL_DELAY,
+/* Set the timer to the delay needed for the current state. If the link
+ * is monitored via netlink then a disconnected interface is not polled
+ * at all, we will be notified when it comes up. */
+static void
+netstatus_iface_schedule_poll (NetstatusIface *iface)
+{
+  guint delay = 0;
+
+  if (iface->priv->name)
+    {
+      if (iface->priv->error_polling)
+	delay = NETSTATUS_IFACE_ERROR_POLL_DELAY;
+      else if (iface->priv->link_fd < 0 ||
+	       iface->priv->state != NETSTATUS_STATE_DISCONNECTED)
+	delay = iface->priv->poll_delay;
+    }
+
+  if (iface->priv->monitor_id && delay == iface->priv->monitor_delay)
+    return;
+
+  if (iface->priv->monitor_id)
+    g_source_remove (iface->priv->monitor_id);
+  iface->priv->monitor_id = 0;
+  iface->priv->monitor_delay = delay;
+
+  if (delay)
+    {
+      dprintf (POLLING, "Polling with delay of %d\n", delay);
+      iface->priv->monitor_id = g_timeout_add (delay,
 					       (GSourceFunc) netstatus_iface_monitor_timeout,
 					       iface);
     }
 }
 
-static gboolean
-netstatus_iface_monitor_timeout (NetstatusIface *iface)
+static void
+netstatus_iface_poll (NetstatusIface *iface)
 {
   NetstatusState state;
   int            signal_strength;
   gboolean       is_wireless;
 
-  if (g_source_is_destroyed(g_main_current_source()))
-    return FALSE;
-
   state = netstatus_iface_poll_state (iface);
 
   if (iface->priv->state != state &&
@@ -644,6 +727,45 @@ netstatus_iface_monitor_timeout (NetstatusIface *iface)
     }
 
   netstatus_iface_increase_poll_delay_in_error (iface);
+  netstatus_iface_schedule_poll (iface);
+}
+
+static gboolean
+netstatus_iface_monitor_timeout (NetstatusIface *iface)
+{
+  if (g_source_is_destroyed(g_main_current_source()))
+    return FALSE;
+
+  netstatus_iface_poll (iface);
+
+  return TRUE;
+}
+
+static gboolean
+netstatus_iface_link_event (GIOChannel     *source __attribute__((unused)),
+			    GIOCondition    condition,
+			    NetstatusIface *iface)
+{
+  if (g_source_is_destroyed(g_main_current_source()))
+    return FALSE;
+
+  if (condition & (G_IO_ERR | G_IO_HUP))
+    {
+      /* netlink socket is broken, fall back to polling */
+      dprintf (POLLING, "Link monitor failed, polling instead\n");
+      close (iface->priv->link_fd);
+      iface->priv->link_fd = -1;
+      iface->priv->link_watch_id = 0;
+      netstatus_iface_schedule_poll (iface);
+      return FALSE;
+    }
+
+  if (iface->priv->name &&
+      netstatus_sysdeps_link_monitor_read (iface->priv->link_fd, iface->priv->name))
+    {
+      dprintf (POLLING, "Link of interface changed\n");
+      netstatus_iface_poll (iface);
+    }
 
   return TRUE;
 }
@@ -671,10 +793,26 @@ netstatus_iface_init_monitor (NetstatusIface *iface)
       iface->priv->monitor_id = 0;
     }
 
+  if (iface->priv->name && iface->priv->link_watch_id == 0 &&
+      (iface->priv->link_fd = netstatus_sysdeps_link_monitor_open ()) >= 0)
+    {
+      GIOChannel *channel;
+
+      dprintf (POLLING, "Monitoring link changes via netlink\n");
+      channel = g_io_channel_unix_new (iface->priv->link_fd);
+      iface->priv->link_watch_id = g_io_add_watch (channel,
+						   G_IO_IN | G_IO_ERR | G_IO_HUP,
+						   (GIOFunc) netstatus_iface_link_event,
+						   iface);
+      g_io_channel_unref (channel);
+    }
+
   if (iface->priv->name)
     {
-      dprintf (POLLING, "Initialising monitor with delay of %d\n", NETSTATUS_IFACE_POLL_DELAY);
-      iface->priv->monitor_id = g_timeout_add (NETSTATUS_IFACE_POLL_DELAY,
+      /* the first poll is always done, later ones depend on the state */
+      dprintf (POLLING, "Initialising monitor with delay of %d\n", iface->priv->poll_delay);
+      iface->priv->monitor_delay = iface->priv->poll_delay;
+      iface->priv->monitor_id = g_timeout_add (iface->priv->poll_delay,
 					       (GSourceFunc) netstatus_iface_monitor_timeout,
 					       iface);
 
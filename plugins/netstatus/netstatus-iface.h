@@ -64,6 +64,8 @@ NetstatusIface *       netstatus_iface_new                   (const char      *n
 const char *           netstatus_iface_get_name              (NetstatusIface  *iface);
 void                   netstatus_iface_set_name              (NetstatusIface  *iface,
 							      const char      *name);
+void                   netstatus_iface_set_poll_delay        (NetstatusIface  *iface,
+							      guint            delay);
 NetstatusState         netstatus_iface_get_state             (NetstatusIface  *iface);
 void                   netstatus_iface_get_statistics        (NetstatusIface  *iface,
 							      NetstatusStats  *stats);
@@ -26,6 +26,7 @@
 #include <config.h>
 
 #include "netstatus-sysdeps.h"
+#include "proc-net-dev.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -106,50 +107,9 @@ parse_iface_name (const char *buf)
   return NULL;
 }
 
-static inline void
-parse_stats_header (char *buf,
-		    int  *prx_idx,
-		    int  *ptx_idx,
-		    int  *brx_idx,
-		    int  *btx_idx)
-{
-  char *p;
-  int   i;
-
-  *prx_idx = *ptx_idx = -1;
-  *brx_idx = *btx_idx = -1;
-
-  p = strtok (buf, "| \t\n");
-  p = strtok (NULL, "| \t\n"); /* Skip the first one */
-  for (i = 0; p; i++, p = strtok (NULL, "| \t\n"))
-    {
-      if (!strcmp (p, "packets"))
-	{
-	  if (*prx_idx == -1)
-	    *prx_idx = i;
-	  else
-	    *ptx_idx = i;
-	}
-      else if (!strcmp (p, "bytes"))
-	{
-	  if (*brx_idx == -1)
-	    *brx_idx = i;
-	  else
-	    *btx_idx = i;
-	}
-    }
-}
-
-static inline FILE *
-get_proc_net_dev_fh (void)
-{
-  static FILE *retval = NULL;
-
-  if (retval != NULL)
-    return retval;
-
-  return retval = fopen ("/proc/net/dev", "r");
-}
+/* Snapshot of /proc/net/dev is shared with other plugins, so allow it
+   to be a bit older than the poll interval of the interface. */
+#define NETSTATUS_PROC_NET_DEV_MAX_AGE 250
 
 char *
 netstatus_sysdeps_read_iface_statistics (const char  *iface,
@@ -158,11 +118,8 @@ netstatus_sysdeps_read_iface_statistics (const char  *iface,
 					 gulong      *in_bytes,
 					 gulong      *out_bytes)
 {
-  FILE *fh;
-  char  buf [512];
-  int   prx_idx, ptx_idx;
-  int   brx_idx, btx_idx;
-  char *error_message = NULL;
+  const LXPanelNetDev *dev;
+  guint                n_devs;
 
   g_return_val_if_fail (iface != NULL, NULL);
   g_return_val_if_fail (in_packets != NULL, NULL);
@@ -175,62 +132,19 @@ netstatus_sysdeps_read_iface_statistics (const char  *iface,
   *in_bytes    = -1;
   *out_bytes   = -1;
 
-  fh = get_proc_net_dev_fh ();
-  if (!fh)
-    return g_strdup_printf (_("Cannot open /proc/net/dev: %s"),
-			    g_strerror (errno));
-
-  if (fgets (buf, sizeof (buf), fh) == NULL ||
-      fgets (buf, sizeof (buf), fh) == NULL)
-    return g_strdup (_("Could not parse /proc/net/dev. No data."));
-
-  parse_stats_header (buf, &prx_idx, &ptx_idx, &brx_idx, &btx_idx);
-  if (prx_idx == -1 || ptx_idx == -1 ||
-      brx_idx == -1 || btx_idx == -1)
+  if (lxpanel_net_dev_list (NETSTATUS_PROC_NET_DEV_MAX_AGE, &n_devs) == NULL)
     return g_strdup (_("Could not parse /proc/net/dev. Unknown format."));
 
-  while (fgets (buf, sizeof (buf), fh))
-    {
-      char *stats;
-      char *name;
+  dev = lxpanel_net_dev_get (iface, NETSTATUS_PROC_NET_DEV_MAX_AGE);
+  if (dev == NULL)
+    return g_strdup_printf ("Could not find information on interface '%s' in /proc/net/dev", iface);
 
-      name = buf;
-      while (g_ascii_isspace (name [0]))
-	name++;
-
-      stats = parse_iface_name (name);
-      if (!stats)
-	{
-	  if (!error_message)
-	    error_message = g_strdup_printf (_("Could not parse interface name from '%s'"), buf);
-	  continue;
-	}
+  *in_packets  = dev->rx_packets;
+  *out_packets = dev->tx_packets;
+  *in_bytes    = dev->rx_bytes;
+  *out_bytes   = dev->tx_bytes;
 
-      if (strcmp (name, iface) != 0)
-	continue;
-
-      if (!parse_stats (stats,
-			prx_idx, ptx_idx, in_packets, out_packets,
-			brx_idx, btx_idx, in_bytes, out_bytes))
-	{
-	  if (error_message)
-	    g_free (error_message);
-	  error_message = g_strdup_printf (_("Could not parse interface statistics from '%s'. "
-					     "prx_idx = %d; ptx_idx = %d; brx_idx = %d; btx_idx = %d;"),
-					   buf, prx_idx, ptx_idx, brx_idx, btx_idx);
-	  continue;
-	}
-
-      break;
-    }
-
-  if ((*in_packets == (gulong) -1 || *out_packets == (gulong) -1 || *in_bytes == (gulong) -1 || *out_bytes == (gulong) -1) && !error_message)
-    error_message = g_strdup_printf ("Could not find information on interface '%s' in /proc/net/dev", iface);
-
-  rewind (fh);
-  fflush (fh);
-
-  return error_message;
+  return NULL;
 }
 
 static inline gboolean
@@ -673,3 +587,273 @@ netstatus_sysdeps_read_iface_statistics (const char *iface,
 }
 
 #endif /* !defined(__FreeBSD__) */
+
+#ifdef __linux__
+
+/* Link state and statistics from rtnetlink, it lets us get data for a
+ * single interface instead of parsing /proc/net/dev and to be notified
+ * when the link changes instead of polling it. */
+
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+#define NETLINK_BUFFER_SIZE 16384
+
+static char netlink_buffer [NETLINK_BUFFER_SIZE]
+	__attribute__((aligned(NLMSG_ALIGNTO)));
+
+static int
+netlink_open (guint32 groups)
+{
+  struct sockaddr_nl addr;
+  int                fd;
+
+  fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (fd < 0)
+    return -1;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = groups;
+  if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    {
+      close (fd);
+      return -1;
+    }
+
+  return fd;
+}
+
+/* Find string attribute and check if it is the interface name, labels
+ * of IPv4 addresses may have a ":alias" suffix. */
+static gboolean
+netlink_attr_is_iface (struct rtattr *rta,
+		       int            len,
+		       unsigned short type,
+		       const char    *iface)
+{
+  size_t iface_len = strlen (iface);
+
+  for (; RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+    if (rta->rta_type == type)
+      {
+	const char *name = RTA_DATA (rta);
+
+	if (RTA_PAYLOAD (rta) <= iface_len ||
+	    strncmp (name, iface, iface_len) != 0)
+	  return FALSE;
+	return (name [iface_len] == '\0' || name [iface_len] == ':');
+      }
+
+  return FALSE;
+}
+
+int
+netstatus_sysdeps_link_monitor_open (void)
+{
+  return netlink_open (RTMGRP_LINK | RTMGRP_IPV4_IFADDR);
+}
+
+gboolean
+netstatus_sysdeps_link_monitor_read (int         fd,
+				     const char *iface)
+{
+  struct nlmsghdr *nh;
+  gboolean         changed = FALSE;
+  ssize_t          len;
+
+  g_return_val_if_fail (iface != NULL, FALSE);
+
+  while ((len = recv (fd, netlink_buffer, sizeof (netlink_buffer), MSG_DONTWAIT)) != 0)
+    {
+      if (len < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  /* on overflow we lost some events, so assume we missed ours */
+	  if (errno == ENOBUFS)
+	    changed = TRUE;
+	  break;
+	}
+
+      for (nh = (struct nlmsghdr *) netlink_buffer;
+	   NLMSG_OK (nh, len);
+	   nh = NLMSG_NEXT (nh, len))
+	{
+	  switch (nh->nlmsg_type)
+	    {
+	    case RTM_NEWLINK:
+	    case RTM_DELLINK:
+	      if (netlink_attr_is_iface (IFLA_RTA (NLMSG_DATA (nh)), IFLA_PAYLOAD (nh),
+					 IFLA_IFNAME, iface))
+		changed = TRUE;
+	      break;
+	    case RTM_NEWADDR:
+	    case RTM_DELADDR:
+	      if (netlink_attr_is_iface (IFA_RTA (NLMSG_DATA (nh)), IFA_PAYLOAD (nh),
+					 IFA_LABEL, iface))
+		changed = TRUE;
+	      break;
+	    }
+	}
+    }
+
+  return changed;
+}
+
+char *
+netstatus_sysdeps_read_iface_link (const char *iface,
+				   gboolean   *is_up,
+				   gulong     *in_packets,
+				   gulong     *out_packets,
+				   gulong     *in_bytes,
+				   gulong     *out_bytes)
+{
+  static int      fd = -1;
+  static guint32  seq = 0;
+  struct {
+    struct nlmsghdr  nh;
+    struct ifinfomsg ifi;
+    char             attrs [RTA_SPACE (IF_NAMESIZE)];
+  } req;
+  struct rtattr    *rta;
+  struct nlmsghdr  *nh;
+  struct ifinfomsg *ifi;
+  ssize_t           len;
+  int               attrlen;
+  gboolean          have_stats = FALSE;
+
+  g_return_val_if_fail (iface != NULL, NULL);
+  g_return_val_if_fail (is_up != NULL, NULL);
+  g_return_val_if_fail (in_packets != NULL, NULL);
+  g_return_val_if_fail (out_packets != NULL, NULL);
+  g_return_val_if_fail (in_bytes != NULL, NULL);
+  g_return_val_if_fail (out_bytes != NULL, NULL);
+
+  *is_up = FALSE;
+
+  if (strlen (iface) >= IF_NAMESIZE)
+    return g_strdup_printf (_("Interface name '%s' is too long"), iface);
+
+  if (fd < 0 && (fd = netlink_open (0)) < 0)
+    return g_strdup_printf (_("Unable to open netlink socket: %s"),
+			    g_strerror (errno));
+
+  /* ask for exactly this interface, selected by name */
+  memset (&req, 0, sizeof (req));
+  req.nh.nlmsg_len   = NLMSG_LENGTH (sizeof (struct ifinfomsg));
+  req.nh.nlmsg_type  = RTM_GETLINK;
+  req.nh.nlmsg_flags = NLM_F_REQUEST;
+  req.nh.nlmsg_seq   = ++seq;
+  req.ifi.ifi_family = AF_UNSPEC;
+  rta = (struct rtattr *) ((char *) &req + NLMSG_ALIGN (req.nh.nlmsg_len));
+  rta->rta_type = IFLA_IFNAME;
+  rta->rta_len  = RTA_LENGTH (strlen (iface) + 1);
+  strcpy (RTA_DATA (rta), iface);
+  req.nh.nlmsg_len = NLMSG_ALIGN (req.nh.nlmsg_len) + RTA_ALIGN (rta->rta_len);
+
+  if (send (fd, &req, req.nh.nlmsg_len, 0) < 0)
+    return g_strdup_printf (_("Netlink request failed: %s"), g_strerror (errno));
+
+  for (;;)
+    {
+      len = recv (fd, netlink_buffer, sizeof (netlink_buffer), 0);
+      if (len < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  return g_strdup_printf (_("Netlink request failed: %s"), g_strerror (errno));
+	}
+
+      for (nh = (struct nlmsghdr *) netlink_buffer;
+	   NLMSG_OK (nh, len);
+	   nh = NLMSG_NEXT (nh, len))
+	{
+	  /* skip replies to older requests which were interrupted */
+	  if (nh->nlmsg_seq != seq)
+	    continue;
+
+	  if (nh->nlmsg_type == NLMSG_ERROR)
+	    {
+	      struct nlmsgerr *err = NLMSG_DATA (nh);
+
+	      return g_strdup_printf (_("Could not get link of interface '%s': %s"),
+				      iface, g_strerror (-err->error));
+	    }
+
+	  if (nh->nlmsg_type != RTM_NEWLINK)
+	    continue;
+
+	  ifi = NLMSG_DATA (nh);
+	  *is_up = (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_RUNNING);
+
+	  attrlen = IFLA_PAYLOAD (nh);
+	  for (rta = IFLA_RTA (ifi); RTA_OK (rta, attrlen); rta = RTA_NEXT (rta, attrlen))
+	    {
+	      if (rta->rta_type == IFLA_STATS64 &&
+		  RTA_PAYLOAD (rta) >= sizeof (struct rtnl_link_stats64))
+		{
+		  struct rtnl_link_stats64 stats;
+
+		  memcpy (&stats, RTA_DATA (rta), sizeof (stats));
+		  *in_packets  = stats.rx_packets;
+		  *out_packets = stats.tx_packets;
+		  *in_bytes    = stats.rx_bytes;
+		  *out_bytes   = stats.tx_bytes;
+		  have_stats = TRUE;
+		  break;
+		}
+	      /* older kernels have only 32-bit counters */
+	      if (rta->rta_type == IFLA_STATS &&
+		  RTA_PAYLOAD (rta) >= sizeof (struct rtnl_link_stats))
+		{
+		  struct rtnl_link_stats stats;
+
+		  memcpy (&stats, RTA_DATA (rta), sizeof (stats));
+		  *in_packets  = stats.rx_packets;
+		  *out_packets = stats.tx_packets;
+		  *in_bytes    = stats.rx_bytes;
+		  *out_bytes   = stats.tx_bytes;
+		  have_stats = TRUE;
+		}
+	    }
+
+	  if (!have_stats)
+	    return g_strdup_printf (_("Could not find statistics of interface '%s'"), iface);
+
+	  return NULL;
+	}
+    }
+}
+
+#else /* !__linux__ */
+
+int
+netstatus_sysdeps_link_monitor_open (void)
+{
+  return -1;
+}
+
+gboolean
+netstatus_sysdeps_link_monitor_read (int         fd __attribute__((unused)),
+				     const char *iface __attribute__((unused)))
+{
+  return FALSE;
+}
+
+char *
+netstatus_sysdeps_read_iface_link (const char *iface __attribute__((unused)),
+				   gboolean   *is_up,
+				   gulong     *in_packets __attribute__((unused)),
+				   gulong     *out_packets __attribute__((unused)),
+				   gulong     *in_bytes __attribute__((unused)),
+				   gulong     *out_bytes __attribute__((unused)))
+{
+  *is_up = FALSE;
+  return g_strdup (_("Link monitoring is not supported on this system"));
+}
+
+#endif /* __linux__ */
@@ -38,6 +38,18 @@ char *netstatus_sysdeps_read_iface_wireless_details (const char *iface,
 						     gboolean   *is_wireless,
 						     int        *signal_strength);
 
+/* rtnetlink backend, netstatus_sysdeps_link_monitor_open() returns -1
+ * if it is not available and polling should be used instead */
+int   netstatus_sysdeps_link_monitor_open           (void);
+gboolean netstatus_sysdeps_link_monitor_read        (int         fd,
+						     const char *iface);
+char *netstatus_sysdeps_read_iface_link             (const char *iface,
+						     gboolean   *is_up,
+						     gulong     *in_packets,
+						     gulong     *out_packets,
+						     gulong     *in_bytes,
+						     gulong     *out_bytes);
+
 G_END_DECLS
 
 #endif /* __NETSTATUS_SYSDEPS_H__ */
@@ -33,10 +33,15 @@
 #include "netstatus-icon.h"
 #include "netstatus-dialog.h"
 
+/* sane range for the statistics update interval, in milliseconds */
+#define POLL_DELAY_MIN 100
+#define POLL_DELAY_MAX 60000
+
 typedef struct {
     config_setting_t *settings;
     char *iface;
     char *config_tool;
+    int poll_delay;         /* milliseconds between statistics updates */
     GtkWidget *dlg;
 } netstatus;
 
@@ -124,8 +129,12 @@ netstatus_constructor(LXPanel *panel, config_setting_t *settings)
     if (!config_setting_lookup_string(settings, "configtool", &tmp))
         tmp = "nm-connection-editor";
     ns->config_tool = g_strdup(tmp);
+    if (!config_setting_lookup_int(settings, "polldelay", &ns->poll_delay))
+        ns->poll_delay = 500;
+    ns->poll_delay = CLAMP(ns->poll_delay, POLL_DELAY_MIN, POLL_DELAY_MAX);
 
     iface = netstatus_iface_new(ns->iface);
+    netstatus_iface_set_poll_delay(iface, ns->poll_delay);
     p = netstatus_icon_new( iface );
     lxpanel_plugin_set_data(p, ns, netstatus_destructor);
     netstatus_icon_set_show_signal((NetstatusIcon *)p, TRUE);
@@ -140,11 +149,15 @@ static gboolean apply_config(gpointer user_data)
     netstatus *ns = lxpanel_plugin_get_data(p);
     NetstatusIface* iface;
 
+    /* the value comes from user, may be anything */
+    ns->poll_delay = CLAMP(ns->poll_delay, POLL_DELAY_MIN, POLL_DELAY_MAX);
     iface = netstatus_iface_new(ns->iface);
+    netstatus_iface_set_poll_delay(iface, ns->poll_delay);
     netstatus_icon_set_iface((NetstatusIcon *)p, iface);
     g_object_unref(iface);
     config_group_set_string(ns->settings, "iface", ns->iface);
     config_group_set_string(ns->settings, "configtool", ns->config_tool);
+    config_group_set_int(ns->settings, "polldelay", ns->poll_delay);
     return FALSE;
 }
 
@@ -156,6 +169,7 @@ static GtkWidget *netstatus_config(LXPanel *panel, GtkWidget *p)
                 panel, apply_config, p,
                 _("Interface to monitor"), &ns->iface, CONF_TYPE_STR,
                 _("Config tool"), &ns->config_tool, CONF_TYPE_STR,
+                _("Statistics update interval (ms)"), &ns->poll_delay, CONF_TYPE_INT,
                 NULL );
     return dlg;
 }
@@ -39,6 +39,7 @@
 #endif
 
 #include "task-button.h"
+#include "task-icon-pixels.h"
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -62,14 +63,40 @@ static Atom a_NET_WM_STATE_MAXIMIZED_HORZ;
  * Class data
  */
 
+/* an icon published in _NET_WM_ICON property */
+typedef struct
+{
+    guint width, height;        /* icon size */
+    glong offset;               /* offset of pixel data in the property, in 32-bit units */
+    GdkPixbuf * pixbuf;         /* unscaled icon, loaded on demand */
+} TaskIconFrame;
+
+/* an icon made from _NET_WM_ICON for some size */
+typedef struct
+{
+    guint width, height;        /* requested size */
+    gboolean no_upscale;        /* disable_taskbar_upscale flag it was made with */
+    GdkPixbuf * pixbuf;         /* rescaled icon, or frame pixbuf if no scaling needed */
+} TaskIconScaled;
+
+/* how many sizes of icon are kept for each window */
+#define TASK_ICON_SCALED_MAX 3
+
+/* how much of _NET_WM_ICON is fetched at once to find icon headers, in
+   32-bit units: it covers the usual set of icons up to 128x128 */
+#define NET_WM_ICON_PREFETCH 32768
+
 /* individual task data */
 typedef struct
 {
     Window win;                             /* X window ID */
+    TaskButton * button;        /* button which contains this window */
     gint desktop;                           /* Desktop that contains task, needed to switch to it on Raise */
     gint monitor;                           /* Monitor that the window is on or closest to */
     char * name;                            /* Taskbar label when normal, from WM_NAME or NET_WM_NAME */
     GdkPixbuf * icon;           /* the taskbar icon */
+    GArray * icon_frames;       /* TaskIconFrame list from _NET_WM_ICON or NULL if not read yet */
+    GSList * icon_scaled;       /* TaskIconScaled list, most recently used first */
     GtkWidget * menu_item;      /* if menu_list exists then it's an item in it */
     Atom name_source;                       /* Atom that is the source of taskbar label */
     Atom image_source;                      /* Atom that is the source of taskbar icon */
@@ -93,6 +120,7 @@ struct _TaskButton
     guint n_visible;            /* number of windows that are shown */
     guint idle_loader;          /* id of icons loader */
     GList * details;            /* details for each window, TaskDetails */
+    GHashTable * index;         /* taskbar-wide index: Window -> TaskDetails */
     gint desktop;               /* Current desktop of the button */
     gint n_desktops;            /* total number of desktops */
     gint monitor;               /* current monitor for the panel */
@@ -105,6 +133,13 @@ struct _TaskButton
     unsigned int has_flash :1;  /* used by task_button_set_flash_state() */
 };
 
+/* parts of button which task_button_update() found changed */
+typedef enum {
+    TASK_DIRTY_VISIBILITY = 1 << 0,
+    TASK_DIRTY_LABEL = 1 << 1,
+    TASK_DIRTY_ICON = 1 << 2
+} TaskDirtyFlags;
+
 enum {
     MENU_BUILT,
     MENU_TARGET_SET,
@@ -212,32 +247,23 @@ static gboolean task_is_visible(TaskButton *b, TaskDetails *task)
             (b->flags.use_urgency_hint && task->urgency));
 }
 
-static TaskDetails *task_details_for_window(TaskButton *button, Window win)
+static TaskDetails *task_details_for_window(TaskButton *button,
+                                            const NetWMClientProps *props)
 {
     TaskDetails *details = g_slice_new0(TaskDetails);
-    GdkDisplay *display = gdk_display_get_default();
-    /* NOTE
-     * 1. the extended mask is sum of taskbar and pager needs
-     * see bug [ 940441 ] pager loose track of windows
-     *
-     * Do not change event mask to gtk windows spawned by this gtk client
-     * this breaks gtk internals */
-#if GTK_CHECK_VERSION(2, 24, 0)
-    if (!gdk_x11_window_lookup_for_display(display, win))
-#else
-    if (!gdk_window_lookup(win))
-#endif
-        XSelectInput(GDK_DISPLAY_XDISPLAY(display), win,
-                     PropertyChangeMask | StructureNotifyMask);
+    Window win = props->win;
 
-    /* fetch task details */
+    /* events were selected by caller before props were fetched */
+    /* fetch task details, most of them were prefetched by caller */
     details->win = win;
-    details->desktop = get_net_wm_desktop(win);
+    details->button = button;
+    details->desktop = props->desktop;
     details->monitor = get_window_monitor(win);
-    task_set_names(details, None);
+    details->name = g_strdup(props->name);
+    details->name_source = props->name_source;
     task_update_icon(button, details, None);
-    details->urgency = task_has_urgency(win);
-    details->iconified = (get_wm_state(win) == IconicState);
+    details->urgency = props->urgency;
+    details->iconified = (props->wm_state == IconicState);
     // FIXME: may want _NET_WM_STATE check
     // FIXME: check if task is focused
     /* check task visibility by flags */
@@ -245,22 +271,58 @@ static TaskDetails *task_details_for_window(TaskButton *button, Window win)
     return details;
 }
 
+static void task_icon_scaled_free(gpointer data)
+{
+    TaskIconScaled *scaled = data;
+
+    g_object_unref(scaled->pixbuf);
+    g_slice_free(TaskIconScaled, scaled);
+}
+
+/* drops all icons fetched from _NET_WM_ICON for the window */
+static void task_icon_cache_free(TaskDetails *details)
+{
+    guint i;
+
+    if (details->icon_frames)
+    {
+        for (i = 0; i < details->icon_frames->len; i++)
+        {
+            TaskIconFrame *frame = &g_array_index(details->icon_frames, TaskIconFrame, i);
+
+            if (frame->pixbuf)
+                g_object_unref(frame->pixbuf);
+        }
+        g_array_free(details->icon_frames, TRUE);
+        details->icon_frames = NULL;
+    }
+    g_slist_free_full(details->icon_scaled, task_icon_scaled_free);
+    details->icon_scaled = NULL;
+}
+
 static void free_task_details(TaskDetails *details)
 {
     g_free(details->name);
     if (details->icon)
         g_object_unref(details->icon);
+    task_icon_cache_free(details);
     g_slice_free(TaskDetails, details);
 }
 
 static TaskDetails *task_details_lookup(TaskButton *task, Window win)
 {
-    GList *l;
+    TaskDetails *details = g_hash_table_lookup(task->index, GUINT_TO_POINTER(win));
 
-    for (l = task->details; l; l = l->next)
-        if (((TaskDetails *)l->data)->win == win)
-            return l->data;
-    return NULL;
+    if (details == NULL || details->button != task)
+        return NULL;
+    return details;
+}
+
+/* removes details from taskbar index if it is still registered there */
+static void task_details_unindex(TaskButton *task, TaskDetails *details)
+{
+    if (g_hash_table_lookup(task->index, GUINT_TO_POINTER(details->win)) == details)
+        g_hash_table_remove(task->index, GUINT_TO_POINTER(details->win));
 }
 
 /* Position-calculation callback for grouped-task and window-management popup menu. */
@@ -780,148 +842,280 @@ static GdkPixbuf * apply_mask(GdkPixbuf * pixbuf, GdkPixbuf * mask)
     /* Loop to do the work. */
     int i;
     for (i = 0; i < h; i += 1)
+        task_icon_apply_mask_row(src + i * src_stride, dst + i * dst_stride, w);
+
+    return with_alpha;
+}
+
+/* Important Notes:
+ * According to freedesktop.org document:
+ * http://standards.freedesktop.org/wm-spec/wm-spec-1.4.html#id2552223
+ * _NET_WM_ICON contains an array of 32-bit packed CARDINAL ARGB.
+ * However, this is incorrect. Actually it's an array of long integers.
+ * Toolkits like gtk+ use unsigned long here to store icons.
+ * Besides, according to manpage of XGetWindowProperty, when returned format,
+ * is 32, the property data will be stored as an array of longs
+ * (which in a 64-bit application will be 64-bit values that are
+ * padded in the upper 4 bytes).
+ */
+
+/* Read list of icons in _NET_WM_ICON of the window without pixel data.
+ * The property may be several megabytes so only its start is fetched here,
+ * it contains headers of all icons usually. Only headers of icons past it
+ * are fetched separately. Pixels of the icon of most suitable size are
+ * fetched later. */
+static GArray *net_wm_icon_read_frames(Display *xdisplay, Window win)
+{
+    GArray *frames = g_array_new(FALSE, FALSE, sizeof(TaskIconFrame));
+    TaskIconFrame frame;
+    gulong offset = 0;
+    Atom type = None;
+    int format;
+    gulong nitems, n;
+    gulong bytes_after;
+    gulong * data = NULL;
+    gulong * header;
+    gulong size, total;
+
+    if (XGetWindowProperty(xdisplay, win, a_NET_WM_ICON, 0, NET_WM_ICON_PREFETCH,
+                           False, XA_CARDINAL, &type, &format, &nitems,
+                           &bytes_after, (void *) &data) != Success)
+        return frames;
+    if ((type != XA_CARDINAL) || (nitems < 2))
+    {
+        if (data != NULL)
+            XFree(data);
+        return frames;
+    }
+    total = nitems + bytes_after / 4;
+
+    while (offset + 2 <= total)
+    {
+        if (offset + 2 <= nitems)
+        {
+            frame.width = data[offset];
+            frame.height = data[offset + 1];
+        }
+        else
+        {
+            /* the header is past the fetched part */
+            header = NULL;
+            type = None;
+            if (XGetWindowProperty(xdisplay, win, a_NET_WM_ICON, offset, 2,
+                                   False, XA_CARDINAL, &type, &format, &n,
+                                   &bytes_after, (void *) &header) != Success)
+                break;
+            if ((type != XA_CARDINAL) || (n < 2))
+            {
+                if (header != NULL)
+                    XFree(header);
+                break;
+            }
+            frame.width = header[0];
+            frame.height = header[1];
+            XFree(header);
+        }
+        size = (gulong)frame.width * frame.height;
+
+        /* Bounds check the icon. Also check for invalid width and height,
+           see http://bugs.debian.org/cgi-bin/bugreport.cgi?bug=801319 */
+        if (size == 0 || frame.width > 1024 || frame.height > 1024 ||
+            size > total - offset - 2)
+            break;
+
+        frame.offset = offset + 2;
+        frame.pixbuf = NULL;
+        g_array_append_val(frames, frame);
+        offset = frame.offset + size;
+    }
+    XFree(data);
+    return frames;
+}
+
+/* Choose the icon which is the same as required size or the smallest one
+   of bigger icons, or the largest one if all of them are smaller. */
+static TaskIconFrame *net_wm_icon_choose_frame(GArray *frames, guint required_width,
+                                               guint required_height)
+{
+    TaskIconFrame *best = NULL, *frame;
+    guint i;
+
+    for (i = 0; i < frames->len; i++)
     {
-        int j;
-        for (j = 0; j < w; j += 1)
+        frame = &g_array_index(frames, TaskIconFrame, i);
+        if (frame->width == required_width && frame->height == required_height)
+            return frame;
+        if (best == NULL)
+            best = frame;
+        else if (best->width < required_width || best->height < required_height)
         {
-            guchar * s = src + i * src_stride + j * 3;
-            guchar * d = dst + i * dst_stride + j * 4;
+            /* best is too small, any bigger one is better */
+            if (frame->width > best->width && frame->height > best->height)
+                best = frame;
+        }
+        else if (frame->width >= required_width && frame->height >= required_height &&
+                 frame->width < best->width && frame->height < best->height)
+            best = frame;
+    }
+    return best;
+}
+
+/* Fetch pixel data of the icon and convert them into a pixbuf. */
+static GdkPixbuf *net_wm_icon_load_frame(Display *xdisplay, Window win,
+                                         TaskIconFrame *frame)
+{
+    GdkPixbuf * pixmap = NULL;
+    Atom type = None;
+    int format;
+    gulong nitems;
+    gulong bytes_after;
+    gulong * data = NULL;
+    gulong len = (gulong)frame->width * frame->height;
+
+    if (XGetWindowProperty(xdisplay, win, a_NET_WM_ICON, frame->offset, len,
+                           False, XA_CARDINAL, &type, &format, &nitems,
+                           &bytes_after, (void *) &data) != Success)
+        return NULL;
 
-            /* s[0] == s[1] == s[2], they are 255 if the bit was set, 0 otherwise. */
-            d[3] = ((s[0] == 0) ? 0 : 255); /* 0 = transparent, 255 = opaque */
+    /* Inspect the result to see if it is usable, property might be changed. */
+    if ((type == XA_CARDINAL) && (nitems == len))
+    {
+        /* Allocate enough space for the pixel data. */
+        guchar * pixdata = g_new(guchar, len * 4);
+
+        /* Convert the pixel data. */
+        task_icon_argb_to_rgba(data, pixdata, len);
+
+        /* Initialize a pixmap with the pixel data. */
+        pixmap = gdk_pixbuf_new_from_data(
+            pixdata,
+            GDK_COLORSPACE_RGB,
+            TRUE, 8,    /* has_alpha, bits_per_sample */
+            frame->width, frame->height, frame->width * 4,
+            (GdkPixbufDestroyNotify) g_free,
+            NULL);
+    }
+
+    /* Free the X property data. */
+    if (data != NULL)
+        XFree(data);
+    return pixmap;
+}
+
+/* Drop pixels of icons other than the one chosen for the current size,
+   they are big and only a few sizes are ever used. */
+static void task_icon_frames_trim(TaskDetails *details, TaskIconFrame *keep)
+{
+    TaskIconFrame *frame;
+    guint i;
+
+    for (i = 0; i < details->icon_frames->len; i++)
+    {
+        frame = &g_array_index(details->icon_frames, TaskIconFrame, i);
+        if (frame != keep && frame->pixbuf != NULL)
+        {
+            g_object_unref(frame->pixbuf);
+            frame->pixbuf = NULL;
         }
     }
+}
 
-    return with_alpha;
+/* Get an icon from _NET_WM_ICON cache of the window, fetch it from X if
+   needed, and scale it to a specified size. Returns a new reference. */
+static GdkPixbuf * get_net_wm_icon(TaskDetails *details, guint required_width,
+                                   guint required_height, Display *xdisplay,
+                                   TaskButton * tb)
+{
+    TaskIconFrame *frame;
+    TaskIconScaled *scaled;
+    GdkPixbuf *pixbuf;
+    gboolean no_upscale = tb->flags.disable_taskbar_upscale;
+    GSList *l;
+
+    /* Reuse icon made for this size before, keep the list in LRU order. */
+    for (l = details->icon_scaled; l; l = l->next)
+    {
+        scaled = l->data;
+        if (scaled->width == required_width && scaled->height == required_height &&
+            scaled->no_upscale == no_upscale)
+        {
+            details->icon_scaled = g_slist_remove_link(details->icon_scaled, l);
+            details->icon_scaled = g_slist_concat(l, details->icon_scaled);
+            return g_object_ref(scaled->pixbuf);
+        }
+    }
+
+    /* Read the list of available icons once. */
+    if (details->icon_frames == NULL)
+        details->icon_frames = net_wm_icon_read_frames(xdisplay, details->win);
+    frame = net_wm_icon_choose_frame(details->icon_frames, required_width,
+                                     required_height);
+    if (frame == NULL)
+        return NULL;
+    task_icon_frames_trim(details, frame);
+
+    /* Fetch pixels of chosen icon once. */
+    if (frame->pixbuf == NULL)
+    {
+        frame->pixbuf = net_wm_icon_load_frame(xdisplay, details->win, frame);
+        if (frame->pixbuf == NULL)
+            return NULL;
+    }
+
+    if ((frame->width == required_width && frame->height == required_height) ||
+        (no_upscale &&
+         (frame->width <= required_width || frame->height <= required_height)))
+        pixbuf = g_object_ref(frame->pixbuf);
+    else
+        pixbuf = gdk_pixbuf_scale_simple(frame->pixbuf, required_width,
+                                         required_height, GDK_INTERP_BILINEAR);
+    if (pixbuf == NULL)
+        return NULL;
+
+    /* Remember it, dropping the least recently used size. */
+    scaled = g_slice_new(TaskIconScaled);
+    scaled->width = required_width;
+    scaled->height = required_height;
+    scaled->no_upscale = no_upscale;
+    scaled->pixbuf = g_object_ref(pixbuf);
+    details->icon_scaled = g_slist_prepend(details->icon_scaled, scaled);
+    if (g_slist_length(details->icon_scaled) > TASK_ICON_SCALED_MAX)
+    {
+        l = g_slist_nth(details->icon_scaled, TASK_ICON_SCALED_MAX - 1);
+        g_slist_free_full(l->next, task_icon_scaled_free);
+        l->next = NULL;
+    }
+    return pixbuf;
 }
 
 /* Get an icon from the window manager for a task, and scale it to a specified size. */
-static GdkPixbuf * get_wm_icon(Window task_win, guint required_width,
+static GdkPixbuf * get_wm_icon(TaskDetails *details, guint required_width,
                                guint required_height, Atom source,
-                               Atom * current_source, TaskButton * tb)
+                               TaskButton * tb)
 {
     /* The result. */
     GdkPixbuf * pixmap = NULL;
     Atom possible_source = None;
+    Atom * current_source = &details->image_source;
+    Window task_win = details->win;
     int result = -1;
     Display *xdisplay = GDK_DISPLAY_XDISPLAY(gdk_display_get_default());
     GdkScreen *screen = gtk_widget_get_screen(GTK_WIDGET(tb));
 
     if ((source == None) || (source == a_NET_WM_ICON))
     {
-        /* Important Notes:
-         * According to freedesktop.org document:
-         * http://standards.freedesktop.org/wm-spec/wm-spec-1.4.html#id2552223
-         * _NET_WM_ICON contains an array of 32-bit packed CARDINAL ARGB.
-         * However, this is incorrect. Actually it's an array of long integers.
-         * Toolkits like gtk+ use unsigned long here to store icons.
-         * Besides, according to manpage of XGetWindowProperty, when returned format,
-         * is 32, the property data will be stored as an array of longs
-         * (which in a 64-bit application will be 64-bit values that are
-         * padded in the upper 4 bytes).
-         */
+        /* The property was changed, forget all icons fetched before. */
+        if (source == a_NET_WM_ICON)
+            task_icon_cache_free(details);
 
         /* Get the window property _NET_WM_ICON, if possible. */
-        Atom type = None;
-        int format;
-        gulong nitems;
-        gulong bytes_after;
-        gulong * data = NULL;
-        result = XGetWindowProperty(
-            xdisplay,
-            task_win,
-            a_NET_WM_ICON,
-            0, G_MAXLONG,
-            False, XA_CARDINAL,
-            &type, &format, &nitems, &bytes_after, (void *) &data);
-
-        /* Inspect the result to see if it is usable.  If not, and we got data, free it. */
-        if ((type != XA_CARDINAL) || (nitems <= 0))
+        pixmap = get_net_wm_icon(details, required_width, required_height,
+                                 xdisplay, tb);
+        if (pixmap != NULL)
         {
-            if (data != NULL)
-                XFree(data);
-            result = -1;
-        }
-
-        /* If the result is usable, extract the icon from it. */
-        if (result == Success)
-        {
-            /* Get the largest icon available, unless there is one that is the desired size. */
-            /* FIXME: should we try to find an icon whose size is closest to
-             * required_width and required_height to reduce unnecessary resizing? */
-            gulong * pdata = data;
-            gulong * pdata_end = data + nitems;
-            gulong * max_icon = NULL;
-            gulong max_w = 0;
-            gulong max_h = 0;
-            while ((pdata + 2) < pdata_end)
-            {
-                /* Extract the width and height. */
-                guint w = pdata[0];
-                guint h = pdata[1];
-                gulong size = w * h;
-                pdata += 2;
-
-                /* Bounds check the icon. Also check for invalid width and height,
-                   see http://bugs.debian.org/cgi-bin/bugreport.cgi?bug=801319 */
-                if (size == 0 || w > 1024 || h > 1024 || pdata + size > pdata_end)
-                    break;
-
-                /* Rare special case: the desired size is the same as icon size. */
-                if ((required_width == w) && (required_height == h))
-                {
-                    max_icon = pdata;
-                    max_w = w;
-                    max_h = h;
-                    break;
-                }
-
-                /* If the icon is the largest so far, capture it. */
-                if ((w > max_w) && (h > max_h))
-                {
-                    max_icon = pdata;
-                    max_w = w;
-                    max_h = h;
-                }
-                pdata += size;
-            }
-
-            /* If an icon was extracted, convert it to a pixbuf.
-             * Its size is max_w and max_h. */
-            if (max_icon != NULL)
-            {
-                /* Allocate enough space for the pixel data. */
-                gulong len = max_w * max_h;
-                guchar * pixdata = g_new(guchar, len * 4);
-
-                /* Loop to convert the pixel data. */
-                guchar * p = pixdata;
-                gulong i;
-                for (i = 0; i < len; p += 4, i += 1)
-                {
-                    guint argb = max_icon[i];
-                    guint rgba = (argb << 8) | (argb >> 24);
-                    p[0] = rgba >> 24;
-                    p[1] = (rgba >> 16) & 0xff;
-                    p[2] = (rgba >> 8) & 0xff;
-                    p[3] = rgba & 0xff;
-                }
-
-                /* Initialize a pixmap with the pixel data. */
-                pixmap = gdk_pixbuf_new_from_data(
-                    pixdata,
-                    GDK_COLORSPACE_RGB,
-                    TRUE, 8,    /* has_alpha, bits_per_sample */
-                    max_w, max_h, max_w * 4,
-                    (GdkPixbufDestroyNotify) g_free,
-                    NULL);
-                possible_source = a_NET_WM_ICON;
-            }
-            else
-                result = -1;
-
-            /* Free the X property data. */
-            XFree(data);
+            /* It is scaled already. */
+            *current_source = a_NET_WM_ICON;
+            return pixmap;
         }
     }
 
@@ -1068,8 +1262,8 @@ static void _task_update_icon(TaskButton *task, TaskDetails *details, Atom sourc
     /* Get the icon from the window's hints. */
     if (details != NULL && pixbuf == NULL)
     {
-        pixbuf = get_wm_icon(details->win, task->icon_size, task->icon_size,
-                             source, &details->image_source, task);
+        pixbuf = get_wm_icon(details, task->icon_size, task->icon_size,
+                             source, task);
         if (pixbuf)
         {
             /* replace old cached image */
@@ -1225,6 +1419,19 @@ static gboolean task_update_visibility(TaskButton *task)
  */
 G_DEFINE_TYPE(TaskButton, task_button, GTK_TYPE_TOGGLE_BUTTON)
 
+static void task_button_dispose(GObject *object)
+{
+    TaskButton *self = (TaskButton *)object;
+    GList *l;
+
+    /* button is being destroyed, windows should be not found by it anymore */
+    if (self->index)
+        for (l = self->details; l; l = l->next)
+            task_details_unindex(self, l->data);
+
+    G_OBJECT_CLASS(task_button_parent_class)->dispose(object);
+}
+
 static void task_button_finalize(GObject *object)
 {
     TaskButton *self = (TaskButton *)object;
@@ -1237,6 +1444,8 @@ static void task_button_finalize(GObject *object)
     if (self->idle_loader)
         g_source_remove(self->idle_loader);
     g_list_free_full(self->details, (GDestroyNotify)free_task_details);
+    if (self->index)
+        g_hash_table_unref(self->index);
 
     G_OBJECT_CLASS(task_button_parent_class)->finalize(object);
 }
@@ -1412,6 +1621,7 @@ static void task_button_class_init(TaskButtonClass *klass)
     GObjectClass *object_class = G_OBJECT_CLASS(klass);
     GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
 
+    object_class->dispose = task_button_dispose;
     object_class->finalize = task_button_finalize;
     widget_class->button_press_event = task_button_button_press_event;
     widget_class->button_release_event = task_button_button_release_event;
@@ -1469,9 +1679,42 @@ static void task_button_init(TaskButton *self)
  * Interface functions
  */
 
+/* requests events from the window which taskbar needs */
+void task_button_select_window_events(Window win)
+{
+    GdkDisplay *display = gdk_display_get_default();
+    /* NOTE
+     * 1. the extended mask is sum of taskbar and pager needs
+     * see bug [ 940441 ] pager loose track of windows
+     *
+     * Do not change event mask to gtk windows spawned by this gtk client
+     * this breaks gtk internals */
+#if GTK_CHECK_VERSION(2, 24, 0)
+    if (!gdk_x11_window_lookup_for_display(display, win))
+#else
+    if (!gdk_window_lookup(win))
+#endif
+        XSelectInput(GDK_DISPLAY_XDISPLAY(display), win,
+                     PropertyChangeMask | StructureNotifyMask);
+}
+
+/* creates an index of windows to share between all buttons of a taskbar */
+GHashTable *task_button_window_index_new(void)
+{
+    return g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/* returns button which contains the window, using index */
+TaskButton *task_button_window_index_lookup(GHashTable *index, Window win)
+{
+    TaskDetails *details = g_hash_table_lookup(index, GUINT_TO_POINTER(win));
+
+    return details ? details->button : NULL;
+}
+
 /* creates new button and sets rendering options */
-TaskButton *task_button_new(Window win, gint desk, gint desks, LXPanel *panel,
-                            const char *res_class, TaskShowFlags flags)
+TaskButton *task_button_new(const NetWMClientProps *props, gint desk, gint desks,
+                            LXPanel *panel, TaskShowFlags flags, GHashTable *index)
 {
     TaskButton *self = g_object_new(PANEL_TYPE_TASK_BUTTON,
                                     "relief", flags.flat_button ? GTK_RELIEF_NONE : GTK_RELIEF_NORMAL,
@@ -1485,13 +1728,14 @@ TaskButton *task_button_new(Window win, gint desk, gint desks, LXPanel *panel,
     self->icon_size = panel_get_icon_size(panel);
     if (flags.use_smaller_icons)
         self->icon_size -= 4;
-    self->res_class = g_strdup(res_class);
+    self->res_class = g_strdup(props->res_class);
     self->flags = flags;
+    self->index = g_hash_table_ref(index);
     /* create empty image and label */
     self->image = gtk_image_new();
     self->label = gtk_label_new(NULL);
     /* append the window and set icon/label by that */
-    task_button_add_window(self, win, self->res_class);
+    task_button_add_window(self, props);
     /* and now let assemble all widgets we got */
     assemble_gui(self);
     /* and finally set visibility on it */
@@ -1501,22 +1745,16 @@ TaskButton *task_button_new(Window win, gint desk, gint desks, LXPanel *panel,
 
 gboolean task_button_has_window(TaskButton *button, Window win)
 {
-    GList *l;
-
     g_return_val_if_fail(PANEL_IS_TASK_BUTTON(button), FALSE);
 
-    for (l = button->details; l; l = l->next)
-        if (((TaskDetails *)l->data)->win == win)
-            return TRUE;
-    return FALSE;
+    return (task_details_lookup(button, win) != NULL);
 }
 
-/* removes windows from button, that are missing in list */
-void task_button_update_windows_list(TaskButton *button, Window *list, gint n)
+/* removes windows from button, that are missing in set of clients */
+void task_button_update_windows_list(TaskButton *button, GHashTable *clients)
 {
     GList *l, *next;
     TaskDetails *details;
-    gint i;
     gboolean has_removed = FALSE;
 
     g_return_if_fail(PANEL_IS_TASK_BUTTON(button));
@@ -1525,12 +1763,11 @@ void task_button_update_windows_list(TaskButton *button, Window *list, gint n)
     {
         next = l->next;
         details = l->data;
-        for (i = 0; i < n; i++)
-            if (list[i] == details->win)
-                break;
-        if (i >= n) /* not found, remove details now */
+        if (g_hash_table_lookup(clients, GUINT_TO_POINTER(details->win)) == NULL)
         {
+            /* not found, remove details now */
             button->details = g_list_delete_link(button->details, l);
+            task_details_unindex(button, details);
             free_task_details(details);
             if (button->last_focused == details)
                 button->last_focused = NULL;
@@ -1735,30 +1972,53 @@ gboolean task_button_window_reconfigured(TaskButton *button, Window win)
 }
 
 /* updates rendering options */
+/* returns TRUE if visibility of any window may depend on the desktop */
+static gboolean task_button_has_desktop(TaskButton *button, gint desk)
+{
+    GList *l;
+    TaskDetails *details;
+
+    for (l = button->details; l; l = l->next)
+    {
+        details = l->data;
+        if (details->desktop == desk)
+            return TRUE;
+    }
+    return FALSE;
+}
+
 void task_button_update(TaskButton *button, gint desk, gint desks,
                         gint mon, guint icon_size, TaskShowFlags flags)
 {
-    gboolean changed = FALSE, changed_icon = FALSE, changed_label = FALSE;
+    guint dirty = 0;
 
     g_return_if_fail(PANEL_IS_TASK_BUTTON(button));
 
-    if (button->desktop != desk
-        || button->monitor != mon
+    if (button->monitor != mon
         || button->flags.show_all_desks != flags.show_all_desks
-        || button->flags.same_monitor_only != flags.same_monitor_only)
-        changed = TRUE;
+        || button->flags.same_monitor_only != flags.same_monitor_only
+        || button->flags.use_urgency_hint != flags.use_urgency_hint)
+        dirty |= TASK_DIRTY_VISIBILITY;
+    else if (button->desktop != desk && !flags.show_all_desks &&
+             /* only windows on old or new desktop may change visibility */
+             (task_button_has_desktop(button, button->desktop) ||
+              task_button_has_desktop(button, desk)))
+        dirty |= TASK_DIRTY_VISIBILITY;
     if (button->n_desktops != desks)
         task_button_reset_menu(gtk_widget_get_parent(GTK_WIDGET(button)));
     if (button->icon_size != icon_size
         || button->flags.disable_taskbar_upscale != flags.disable_taskbar_upscale)
-        changed_icon = TRUE;
+        dirty |= TASK_DIRTY_ICON;
     if (button->flags.flat_button != flags.flat_button ||
         button->flags.show_square_brackets != flags.show_square_brackets)
-        changed_label = TRUE;
+        dirty |= TASK_DIRTY_LABEL;
     if (button->flags.icons_only != flags.icons_only)
     {
-        changed_label = !flags.icons_only;
-        gtk_widget_set_visible(button->label, changed_label);
+        if (flags.icons_only)
+            dirty &= ~TASK_DIRTY_LABEL;
+        else
+            dirty |= TASK_DIRTY_LABEL;
+        gtk_widget_set_visible(button->label, !flags.icons_only);
     }
     if (button->flags.flat_button != flags.flat_button)
     {
@@ -1776,15 +2036,18 @@ void task_button_update(TaskButton *button, gint desk, gint desks,
     button->icon_size = icon_size;
     button->flags = flags;
 
-    if (changed)
+    /* skip unchanged parts, nothing at all if nothing has changed */
+    if (dirty == 0)
+        return;
+    if (dirty & TASK_DIRTY_VISIBILITY)
     {
         if (task_update_visibility(button))
-            changed_label = TRUE;
+            dirty |= TASK_DIRTY_LABEL;
         // FIXME: test if need to update menu
     }
-    if (changed_label)
+    if (dirty & TASK_DIRTY_LABEL)
         task_redraw_label(button);
-    if (changed_icon)
+    if (dirty & TASK_DIRTY_ICON)
         task_update_icon(button, button->last_focused, None);
 }
 
@@ -1836,18 +2099,19 @@ void task_button_set_flash_state(TaskButton *button, gboolean state)
 }
 
 /* adds task only if it's the same class */
-gboolean task_button_add_window(TaskButton *button, Window win, const char *cl)
+gboolean task_button_add_window(TaskButton *button, const NetWMClientProps *props)
 {
     TaskDetails *details;
     GtkAllocation alloc;
 
     g_return_val_if_fail(PANEL_IS_TASK_BUTTON(button), FALSE);
 
-    if (g_strcmp0(button->res_class, cl) != 0)
+    if (g_strcmp0(button->res_class, props->res_class) != 0)
         return FALSE;
     /* fetch task details */
-    details = task_details_for_window(button, win);
+    details = task_details_for_window(button, props);
     button->details = g_list_append(button->details, details);
+    g_hash_table_insert(button->index, GUINT_TO_POINTER(props->win), details);
     /* redraw label on the button if need */
     if (details->visible)
     {
@@ -1856,7 +2120,7 @@ gboolean task_button_add_window(TaskButton *button, Window win, const char *cl)
         // FIXME: test if need to update menu
     }
     gtk_widget_get_allocation(GTK_WIDGET(button), &alloc);
-    map_xwindow_animation(GTK_WIDGET(button), win, &alloc);
+    map_xwindow_animation(GTK_WIDGET(button), props->win, &alloc);
     return TRUE;
 }
 
@@ -1868,20 +2132,19 @@ gboolean task_button_drop_window(TaskButton *button, Window win, gboolean leave_
 
     g_return_val_if_fail(PANEL_IS_TASK_BUTTON(button), FALSE);
 
-    if (leave_last && g_list_length(button->details) <= 1)
+    if (leave_last && button->details != NULL && button->details->next == NULL)
         return FALSE;
-    for (l = button->details; l; l = l->next)
-        if (((TaskDetails *)l->data)->win == win)
-            break;
-    if (l == NULL) /* not our window */
+    details = task_details_lookup(button, win);
+    if (details == NULL) /* not our window */
         return FALSE;
-    if (g_list_length(button->details) == 1)
+    task_details_unindex(button, details);
+    if (button->details->next == NULL)
     {
         /* this was last window, destroy the button */
         gtk_widget_destroy(GTK_WIDGET(button));
         return TRUE;
     }
-    details = l->data;
+    l = g_list_find(button->details, details);
     button->details = g_list_delete_link(button->details, l);
     was_last_focused = (button->last_focused == details);
     if (was_last_focused)
@@ -1905,7 +2168,7 @@ gboolean task_button_drop_window(TaskButton *button, Window win, gboolean leave_
 TaskButton *task_button_split(TaskButton *button)
 {
     TaskButton *sibling;
-    GList *llast;
+    GList *llast, *l;
 
     g_return_val_if_fail(PANEL_IS_TASK_BUTTON(button), NULL);
 
@@ -1916,11 +2179,14 @@ TaskButton *task_button_split(TaskButton *button)
                            NULL);
     sibling->res_class = g_strdup(button->res_class);
     sibling->panel = button->panel;
+    sibling->index = g_hash_table_ref(button->index);
     sibling->image = gtk_image_new();
     sibling->label = gtk_label_new(NULL);
     llast = g_list_last(button->details);
     sibling->details = g_list_remove_link(button->details, llast);
     button->details = llast;
+    for (l = sibling->details; l; l = l->next)
+        ((TaskDetails *)l->data)->button = sibling;
     if (button->last_focused != llast->data)
     {
         /* focused item migrated to sibling */
@@ -1953,11 +2219,15 @@ TaskButton *task_button_split(TaskButton *button)
 /* merges buttons if they are the same class */
 gboolean task_button_merge(TaskButton *button, TaskButton *sibling)
 {
+    GList *l;
+
     g_return_val_if_fail(PANEL_IS_TASK_BUTTON(button) && PANEL_IS_TASK_BUTTON(sibling), FALSE);
 
     if (g_strcmp0(button->res_class, sibling->res_class) != 0)
         return FALSE;
     /* move data lists from sibling appending to button */
+    for (l = sibling->details; l; l = l->next)
+        ((TaskDetails *)l->data)->button = button;
     button->details = g_list_concat(button->details, sibling->details);
     sibling->details = NULL;
     /* update visibility */
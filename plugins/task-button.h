@@ -20,6 +20,7 @@
 #define __TASK_BUTTON_H__ 1
 
 #include "plugin.h"
+#include "misc.h"
 
 #include <gtk/gtk.h>
 
@@ -62,13 +63,20 @@ struct _TaskButtonClass
     void (*menu_target_set)(TaskButton *button, gulong win); /* "menu-target-set" signal */
 };
 
+/* selects X events on the window needed to track it, should be called
+   before its properties are fetched with get_net_wm_client_props() */
+void task_button_select_window_events(Window win);
+/* index of windows shared by all buttons of one taskbar */
+GHashTable *task_button_window_index_new(void);
+/* returns button containing the window or NULL */
+TaskButton *task_button_window_index_lookup(GHashTable *index, Window win);
 /* creates new button and sets rendering options */
-TaskButton *task_button_new(Window win, gint desk, gint desks, LXPanel *panel,
-                            const char *cl, TaskShowFlags flags);
+TaskButton *task_button_new(const NetWMClientProps *props, gint desk, gint desks,
+                            LXPanel *panel, TaskShowFlags flags, GHashTable *index);
 
 gboolean task_button_has_window(TaskButton *button, Window win);
-/* removes windows from button, that are missing in list */
-void task_button_update_windows_list(TaskButton *button, Window *list, gint n);
+/* removes windows from button, that are missing in set of clients */
+void task_button_update_windows_list(TaskButton *button, GHashTable *clients);
 /* returns TRUE if found and updated */
 gboolean task_button_window_xprop_changed(TaskButton *button, Window win, Atom atom);
 gboolean task_button_window_focus_changed(TaskButton *button, Window *win);
@@ -78,7 +86,7 @@ void task_button_update(TaskButton *button, gint desk, gint desks,
                         gint mon, guint icon_size, TaskShowFlags flags);
 void task_button_set_flash_state(TaskButton *button, gboolean state);
 /* adds task only if it's the same class */
-gboolean task_button_add_window(TaskButton *button, Window win, const char *cl);
+gboolean task_button_add_window(TaskButton *button, const NetWMClientProps *props);
 gboolean task_button_drop_window(TaskButton *button, Window win, gboolean leave_last);
 /* leaves only last task in button and returns rest if not empty */
 TaskButton *task_button_split(TaskButton *button);
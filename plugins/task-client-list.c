@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Reconciliation of _NET_CLIENT_LIST against the previous snapshot. It
+ * costs one hash insert per window of the new list and one lookup per
+ * window of both lists, independent of the number of task buttons. It
+ * has no X or GTK dependencies so test/task-client-list-bench.c can
+ * time it alone. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "task-client-list.h"
+
+void task_client_list_diff(GHashTable *prev, const gulong *list, guint n,
+                           TaskClientListDiff *diff)
+{
+    GHashTableIter iter;
+    gpointer key;
+    guint i;
+
+    diff->clients = g_hash_table_new(g_direct_hash, g_direct_equal);
+    diff->vanished = NULL;
+    diff->n_vanished = 0;
+    diff->appeared = NULL;
+    diff->n_appeared = 0;
+
+    for (i = 0; i < n; i++)
+        g_hash_table_insert(diff->clients, GUINT_TO_POINTER(list[i]),
+                            GINT_TO_POINTER(1));
+
+    /* Find windows not present in the new list. */
+    g_hash_table_iter_init(&iter, prev);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+        if (g_hash_table_lookup(diff->clients, key) == NULL)
+        {
+            if (diff->vanished == NULL)
+                diff->vanished = g_new(gulong, g_hash_table_size(prev));
+            diff->vanished[diff->n_vanished++] = GPOINTER_TO_UINT(key);
+        }
+
+    /* Find windows which were not present in the previous list,
+       preserving the order. */
+    for (i = 0; i < n; i++)
+        if (g_hash_table_lookup(prev, GUINT_TO_POINTER(list[i])) == NULL)
+        {
+            if (diff->appeared == NULL)
+                diff->appeared = g_new(gulong, n - i);
+            diff->appeared[diff->n_appeared++] = list[i];
+        }
+}
+
+void task_client_list_diff_clear(TaskClientListDiff *diff)
+{
+    g_free(diff->vanished);
+    diff->vanished = NULL;
+    diff->n_vanished = 0;
+    g_free(diff->appeared);
+    diff->appeared = NULL;
+    diff->n_appeared = 0;
+}
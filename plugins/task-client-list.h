@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __TASK_CLIENT_LIST_H__
+#define __TASK_CLIENT_LIST_H__ 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* result of comparing _NET_CLIENT_LIST with the previous one, windows
+   are X window ids */
+typedef struct
+{
+    GHashTable *clients;        /* set of windows in the new list */
+    gulong *vanished;           /* windows of the previous list which are gone */
+    guint n_vanished;
+    gulong *appeared;           /* new windows, in order of the list */
+    guint n_appeared;
+} TaskClientListDiff;
+
+/* compares n windows in list with set of windows from previous list */
+void task_client_list_diff(GHashTable *prev, const gulong *list, guint n,
+                           TaskClientListDiff *diff);
+
+/* frees vanished and appeared arrays, the caller owns diff->clients */
+void task_client_list_diff_clear(TaskClientListDiff *diff);
+
+G_END_DECLS
+
+#endif
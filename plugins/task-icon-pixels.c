@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Pixel conversion loops for task icons. Vectorized variants are used
+ * where the CPU supports them, the plain C variant otherwise. Vector
+ * variants expect 64-bit longs, since _NET_WM_ICON data are returned by
+ * XGetWindowProperty() as array of longs with pixel in lower 32 bits. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "task-icon-pixels.h"
+
+#if GLIB_SIZEOF_LONG == 8 && defined(__GNUC__) && defined(__x86_64__)
+# define TASK_ICON_X86 1
+# include <immintrin.h>
+#elif GLIB_SIZEOF_LONG == 8 && defined(__aarch64__) && defined(__ARM_NEON) && \
+      (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+# define TASK_ICON_NEON 1
+# include <arm_neon.h>
+#endif
+
+typedef void (*ConvertFunc)(const gulong *src, guchar *dst, gsize n);
+typedef void (*MaskFunc)(const guchar *src, guchar *dst, gsize n);
+
+static void argb_to_rgba_c(const gulong *src, guchar *dst, gsize n)
+{
+    gsize i;
+
+    for (i = 0; i < n; dst += 4, i += 1)
+    {
+        guint argb = src[i];
+        guint rgba = (argb << 8) | (argb >> 24);
+        dst[0] = rgba >> 24;
+        dst[1] = (rgba >> 16) & 0xff;
+        dst[2] = (rgba >> 8) & 0xff;
+        dst[3] = rgba & 0xff;
+    }
+}
+
+static void apply_mask_c(const guchar *src, guchar *dst, gsize n)
+{
+    gsize i;
+
+    /* s[0] == s[1] == s[2], they are 255 if the bit was set, 0 otherwise. */
+    for (i = 0; i < n; src += 3, dst += 4, i += 1)
+        dst[3] = ((src[0] == 0) ? 0 : 255); /* 0 = transparent, 255 = opaque */
+}
+
+#ifdef TASK_ICON_X86
+/* SSE2 is always available on x86_64 */
+static void argb_to_rgba_sse2(const gulong *src, guchar *dst, gsize n)
+{
+    const __m128i ga_mask = _mm_set1_epi32((int)0xff00ff00);
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    gsize i;
+
+    for (i = 0; i + 4 <= n; i += 4, src += 4, dst += 16)
+    {
+        /* pick lower halves of four longs: 0 2 1 3 then combine */
+        __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)src),
+                                      _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src + 2)),
+                                      _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i x = _mm_unpacklo_epi64(a, b);
+        /* BGRA in memory -> RGBA: swap R and B bytes */
+        __m128i r = _mm_and_si128(_mm_srli_epi32(x, 16), byte_mask);
+        __m128i bl = _mm_slli_epi32(_mm_and_si128(x, byte_mask), 16);
+        x = _mm_or_si128(_mm_and_si128(x, ga_mask), _mm_or_si128(r, bl));
+        _mm_storeu_si128((__m128i *)dst, x);
+    }
+    argb_to_rgba_c(src, dst, n - i);
+}
+
+__attribute__((target("avx2")))
+static void argb_to_rgba_avx2(const gulong *src, guchar *dst, gsize n)
+{
+    const __m256i lo_idx = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i swap = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7,
+                                          10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7,
+                                          10, 9, 8, 11, 14, 13, 12, 15);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8, src += 8, dst += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)src);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 4));
+        __m256i x;
+
+        a = _mm256_permutevar8x32_epi32(a, lo_idx);
+        b = _mm256_permutevar8x32_epi32(b, lo_idx);
+        x = _mm256_blend_epi32(a, b, 0xf0);
+        x = _mm256_shuffle_epi8(x, swap);
+        _mm256_storeu_si256((__m256i *)dst, x);
+    }
+    argb_to_rgba_sse2(src, dst, n - i);
+}
+
+__attribute__((target("ssse3")))
+static void apply_mask_ssse3(const guchar *src, guchar *dst, gsize n)
+{
+    /* put first byte of each of four RGB pixels into alpha position */
+    const __m128i spread = _mm_setr_epi8(-1, -1, -1, 0, -1, -1, -1, 3,
+                                         -1, -1, -1, 6, -1, -1, -1, 9);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    const __m128i zero = _mm_setzero_si128();
+    gsize i;
+
+    /* 16 bytes are read for 4 pixels so leave enough for the last load */
+    for (i = 0; i + 6 <= n; i += 4, src += 12, dst += 16)
+    {
+        __m128i m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), spread);
+        __m128i d = _mm_loadu_si128((const __m128i *)dst);
+
+        m = _mm_andnot_si128(_mm_cmpeq_epi8(m, zero), alpha);
+        d = _mm_or_si128(_mm_andnot_si128(alpha, d), m);
+        _mm_storeu_si128((__m128i *)dst, d);
+    }
+    apply_mask_c(src, dst, n - i);
+}
+
+#endif /* TASK_ICON_X86 */
+
+#ifdef TASK_ICON_NEON
+static void argb_to_rgba_neon(const gulong *src, guchar *dst, gsize n)
+{
+    static const guint8 swap_idx[16] = { 2, 1, 0, 3, 6, 5, 4, 7,
+                                         10, 9, 8, 11, 14, 13, 12, 15 };
+    const uint8x16_t swap = vld1q_u8(swap_idx);
+    gsize i;
+
+    for (i = 0; i + 4 <= n; i += 4, src += 4, dst += 16)
+    {
+        /* val[0] gets lower halves of four longs */
+        uint32x4x2_t v = vld2q_u32((const uint32_t *)src);
+
+        vst1q_u8(dst, vqtbl1q_u8(vreinterpretq_u8_u32(v.val[0]), swap));
+    }
+    argb_to_rgba_c(src, dst, n - i);
+}
+
+static void apply_mask_neon(const guchar *src, guchar *dst, gsize n)
+{
+    gsize i;
+
+    for (i = 0; i + 16 <= n; i += 16, src += 48, dst += 64)
+    {
+        uint8x16x3_t m = vld3q_u8(src);
+        uint8x16x4_t d = vld4q_u8(dst);
+
+        d.val[3] = vtstq_u8(m.val[0], m.val[0]);
+        vst4q_u8(dst, d);
+    }
+    apply_mask_c(src, dst, n - i);
+}
+#endif /* TASK_ICON_NEON */
+
+static ConvertFunc convert_func = NULL;
+static MaskFunc mask_func = NULL;
+
+static void task_icon_pixels_init(void)
+{
+#if defined(TASK_ICON_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        convert_func = argb_to_rgba_avx2;
+    else
+        convert_func = argb_to_rgba_sse2;
+    /* AVX2 mask needs a cross-lane insert per 8 pixels and measured slower
+       than SSSE3 in plugins/test/task-icon-pixels-bench.c */
+    if (__builtin_cpu_supports("ssse3"))
+        mask_func = apply_mask_ssse3;
+    else
+        mask_func = apply_mask_c;
+#elif defined(TASK_ICON_NEON)
+    convert_func = argb_to_rgba_neon;
+    mask_func = apply_mask_neon;
+#else
+    convert_func = argb_to_rgba_c;
+    mask_func = apply_mask_c;
+#endif
+}
+
+void task_icon_argb_to_rgba(const gulong *src, guchar *dst, gsize n)
+{
+    if (G_UNLIKELY(convert_func == NULL))
+        task_icon_pixels_init();
+    convert_func(src, dst, n);
+}
+
+void task_icon_apply_mask_row(const guchar *src, guchar *dst, gsize n)
+{
+    if (G_UNLIKELY(mask_func == NULL))
+        task_icon_pixels_init();
+    mask_func(src, dst, n);
+}
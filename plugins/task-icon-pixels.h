@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __TASK_ICON_PIXELS_H__
+#define __TASK_ICON_PIXELS_H__ 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* converts n pixels from _NET_WM_ICON data (ARGB in a long) into RGBA bytes */
+void task_icon_argb_to_rgba(const gulong *src, guchar *dst, gsize n);
+
+/* sets alpha of n RGBA pixels in dst from a RGB mask row in src */
+void task_icon_apply_mask_row(const guchar *src, guchar *dst, gsize n);
+
+G_END_DECLS
+
+#endif
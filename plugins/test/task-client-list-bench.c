@@ -0,0 +1,91 @@
+// gcc -O2 -I.. task-client-list-bench.c ../task-client-list.c -o task-client-list-bench `pkg-config --cflags --libs glib-2.0`
+
+/*
+ * Measures reconciliation of a _NET_CLIENT_LIST of 1000 windows against
+ * the previous snapshot: unchanged list, one window closed, one window
+ * opened, and every window replaced.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "task-client-list.h"
+
+#define N_WINDOWS 1000
+#define ROUNDS 2000
+
+static GHashTable *snapshot(const gulong *list, guint n)
+{
+    TaskClientListDiff diff;
+    GHashTable *empty = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    task_client_list_diff(empty, list, n, &diff);
+    task_client_list_diff_clear(&diff);
+    g_hash_table_destroy(empty);
+    return diff.clients;
+}
+
+static void bench(const char *name, const gulong *prev_list, guint n_prev,
+                  const gulong *list, guint n, guint vanished, guint appeared)
+{
+    GHashTable *prev = snapshot(prev_list, n_prev);
+    TaskClientListDiff diff;
+    gint64 start;
+    double us;
+    int r;
+
+    start = g_get_monotonic_time();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        task_client_list_diff(prev, list, n, &diff);
+        if (diff.n_vanished != vanished || diff.n_appeared != appeared)
+        {
+            printf("%s: wrong result %u/%u\n", name, diff.n_vanished, diff.n_appeared);
+            exit(1);
+        }
+        task_client_list_diff_clear(&diff);
+        g_hash_table_destroy(diff.clients);
+    }
+    us = (double)(g_get_monotonic_time() - start) / ROUNDS;
+    printf("%-16s %8.1f us per reconciliation\n", name, us);
+    g_hash_table_destroy(prev);
+}
+
+int main(void)
+{
+    gulong *list = g_new(gulong, N_WINDOWS + 1);
+    gulong *other = g_new(gulong, N_WINDOWS);
+    guint i;
+
+    /* window ids as a window manager allocates them */
+    for (i = 0; i <= N_WINDOWS; i++)
+        list[i] = 0x1400003 + i * 0x200000;
+    for (i = 0; i < N_WINDOWS; i++)
+        other[i] = 0x3000003 + i * 0x200000 + 1;
+
+    printf("%d windows\n", N_WINDOWS);
+    bench("unchanged", list, N_WINDOWS, list, N_WINDOWS, 0, 0);
+    bench("one closed", list, N_WINDOWS, list + 1, N_WINDOWS - 1, 1, 0);
+    bench("one opened", list, N_WINDOWS, list, N_WINDOWS + 1, 0, 1);
+    bench("all replaced", list, N_WINDOWS, other, N_WINDOWS, N_WINDOWS, N_WINDOWS);
+
+    g_free(list);
+    g_free(other);
+    return 0;
+}
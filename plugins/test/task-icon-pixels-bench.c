@@ -0,0 +1,89 @@
+// gcc -O2 -I.. task-icon-pixels-bench.c -o task-icon-pixels-bench `pkg-config --cflags --libs glib-2.0`
+
+/*
+ * Measures throughput of task icon pixel kernels on 256x256 icons.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "task-icon-pixels.c"
+
+#define ICON_SIZE 256
+#define N_PIXELS (ICON_SIZE * ICON_SIZE)
+
+static gulong *src;
+static guchar *mask_src, *dst;
+
+static void bench(const char *name, ConvertFunc convert, MaskFunc mask, int rounds)
+{
+    gint64 start;
+    double us;
+    int r, i;
+
+    if (convert)
+    {
+        start = g_get_monotonic_time();
+        for (r = 0; r < rounds; r++)
+            convert(src, dst, N_PIXELS);
+        us = (double)(g_get_monotonic_time() - start) / rounds;
+        printf("%-8s convert: %8.1f us/icon %8.1f Mpixel/s\n", name, us, N_PIXELS / us);
+    }
+    if (mask)
+    {
+        start = g_get_monotonic_time();
+        for (r = 0; r < rounds; r++)
+            for (i = 0; i < ICON_SIZE; i++)
+                mask(mask_src + i * ICON_SIZE * 3, dst + i * ICON_SIZE * 4, ICON_SIZE);
+        us = (double)(g_get_monotonic_time() - start) / rounds;
+        printf("%-8s mask:    %8.1f us/icon %8.1f Mpixel/s\n", name, us, N_PIXELS / us);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    int i;
+
+    src = g_new(gulong, N_PIXELS);
+    mask_src = g_new(guchar, N_PIXELS * 3);
+    dst = g_new(guchar, N_PIXELS * 4);
+    for (i = 0; i < N_PIXELS; i++)
+    {
+        src[i] = (gulong)rand();
+        mask_src[i * 3] = mask_src[i * 3 + 1] = mask_src[i * 3 + 2] = (i & 1) ? 255 : 0;
+    }
+
+    bench("c", argb_to_rgba_c, apply_mask_c, rounds);
+#if defined(TASK_ICON_X86)
+    __builtin_cpu_init();
+    bench("sse2", argb_to_rgba_sse2, NULL, rounds);
+    if (__builtin_cpu_supports("ssse3"))
+        bench("ssse3", NULL, apply_mask_ssse3, rounds);
+    if (__builtin_cpu_supports("avx2"))
+        bench("avx2", argb_to_rgba_avx2, NULL, rounds);
+#elif defined(TASK_ICON_NEON)
+    bench("neon", argb_to_rgba_neon, apply_mask_neon, rounds);
+#endif
+
+    g_free(src);
+    g_free(mask_src);
+    g_free(dst);
+    return 0;
+}
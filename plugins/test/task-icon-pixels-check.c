@@ -0,0 +1,118 @@
+// gcc -I.. task-icon-pixels-check.c -o task-icon-pixels-check `pkg-config --cflags --libs glib-2.0`
+
+/*
+ * Compares vectorized task icon pixel kernels against the plain C ones.
+ * Buffers are allocated with exact sizes so building with
+ * -fsanitize=address also catches reads and writes out of bounds.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* static kernels are tested directly */
+#include "task-icon-pixels.c"
+
+#define MAX_PIXELS 300
+
+typedef struct {
+    const char *name;
+    ConvertFunc convert;
+    MaskFunc mask;
+} Variant;
+
+static int check_variant(const Variant *v)
+{
+    gulong *src;
+    guchar *mask_src, *expect, *got;
+    gsize n, i;
+    int failed = 0;
+
+    for (n = 0; n <= MAX_PIXELS; n++)
+    {
+        src = g_new(gulong, n + 1);
+        mask_src = g_new(guchar, n * 3 + 1);
+        expect = g_new(guchar, n * 4 + 1);
+        got = g_new(guchar, n * 4 + 1);
+        for (i = 0; i < n; i++)
+        {
+            /* upper half of long must be ignored */
+            src[i] = ((gulong)rand() << 32 | (guint)rand()) ^ ((gulong)rand() << 16);
+            /* mostly 0 and 255 as in real masks, but any value must work */
+            mask_src[i * 3] = (rand() % 3 == 0) ? 0 : (rand() % 2) ? 255 : rand() & 0xff;
+            mask_src[i * 3 + 1] = mask_src[i * 3 + 2] = mask_src[i * 3];
+        }
+
+        if (v->convert)
+        {
+            argb_to_rgba_c(src, expect, n);
+            memset(got, 0xaa, n * 4);
+            v->convert(src, got, n);
+            if (memcmp(expect, got, n * 4) != 0)
+            {
+                printf("%s: conversion of %lu pixels differs\n", v->name, (unsigned long)n);
+                failed = 1;
+            }
+        }
+
+        if (v->mask)
+        {
+            for (i = 0; i < n * 4; i++)
+                expect[i] = got[i] = rand() & 0xff;
+            apply_mask_c(mask_src, expect, n);
+            v->mask(mask_src, got, n);
+            if (memcmp(expect, got, n * 4) != 0)
+            {
+                printf("%s: mask of %lu pixels differs\n", v->name, (unsigned long)n);
+                failed = 1;
+            }
+        }
+
+        g_free(src);
+        g_free(mask_src);
+        g_free(expect);
+        g_free(got);
+    }
+    printf("%s: %s\n", v->name, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    Variant variants[4];
+    int n = 0, i, failed = 0;
+
+#if defined(TASK_ICON_X86)
+    __builtin_cpu_init();
+    variants[n++] = (Variant){ "sse2", argb_to_rgba_sse2, NULL };
+    if (__builtin_cpu_supports("ssse3"))
+        variants[n++] = (Variant){ "ssse3", NULL, apply_mask_ssse3 };
+    if (__builtin_cpu_supports("avx2"))
+        variants[n++] = (Variant){ "avx2", argb_to_rgba_avx2, NULL };
+#elif defined(TASK_ICON_NEON)
+    variants[n++] = (Variant){ "neon", argb_to_rgba_neon, apply_mask_neon };
+#endif
+    /* the dispatcher must pick one of the above or the C variant */
+    variants[n++] = (Variant){ "dispatch", task_icon_argb_to_rgba, task_icon_apply_mask_row };
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    for (i = 0; i < n; i++)
+        failed |= check_variant(&variants[i]);
+    return failed;
+}
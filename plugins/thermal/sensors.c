@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sensors.h"
+
+#define PROC_THERMAL_DIRECTORY "/proc/acpi/thermal_zone/" /* must be slash-terminated */
+#define PROC_THERMAL_TEMPF  "temperature"
+#define PROC_THERMAL_TRIP  "trip_points"
+#define PROC_TRIP_CRITICAL "critical (S5):"
+
+#define SYSFS_THERMAL_DIRECTORY "/sys/class/thermal/" /* must be slash-terminated */
+#define SYSFS_THERMAL_SUBDIR_PREFIX "thermal_zone"
+#define SYSFS_THERMAL_TEMPF  "temp"
+#define SYSFS_THERMAL_TRIP  "trip_point_0_temp"
+
+#define SYSFS_HWMON_DIRECTORY "/sys/class/hwmon/" /* must be slash-terminated */
+
+#if !GLIB_CHECK_VERSION(2, 40, 0)
+# define g_info(...) g_log(G_LOG_DOMAIN, G_LOG_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+/* readings newer than this are shared by all consumers, in microseconds */
+#define SENSOR_MAX_AGE 1000000
+
+struct _ThermalSensor {
+    ThermalSensorType type;
+    char *path;
+    char *name;
+    guint refcount;
+    int fd;                     /* temperature file, kept open */
+    gboolean failed;            /* cannot be opened, don't spam warnings */
+    gint temperature;
+    gint64 read_time;
+    gint critical;
+    gboolean critical_read;
+};
+
+/* path -> ThermalSensor, sensors currently used by any consumer */
+static GHashTable *registry = NULL;
+
+/* Read the file from the beginning into buffer, returns length or -1 */
+static gssize sensor_pread(int fd, char *buf, gsize size)
+{
+    gssize len = pread(fd, buf, size - 1, 0);
+
+    if (len >= 0)
+        buf[len] = '\0';
+    return len;
+}
+
+/* Find value after "label:" in contents of /proc/acpi file */
+static gint proc_parse(const char *buf, const char *label)
+{
+    const char *p = strstr(buf, label);
+
+    if (p == NULL)
+        return -1;
+    p += strlen(label);
+    while (*p == ' ')
+        p++;
+    return atoi(p);
+}
+
+static char *sensor_temp_file(ThermalSensor *sensor)
+{
+    switch (sensor->type)
+    {
+    case THERMAL_SENSOR_PROC:
+        return g_strconcat(sensor->path, PROC_THERMAL_TEMPF, NULL);
+    case THERMAL_SENSOR_SYSFS:
+        return g_strconcat(sensor->path, SYSFS_THERMAL_TEMPF, NULL);
+    case THERMAL_SENSOR_HWMON:
+    default:
+        return g_strdup(sensor->path);
+    }
+}
+
+static gint sensor_parse(ThermalSensor *sensor, const char *buf)
+{
+    if (sensor->type == THERMAL_SENSOR_PROC)
+        return proc_parse(buf, "temperature:");
+    /* sysfs values are in millidegrees */
+    return atoi(buf) / 1000;
+}
+
+static gint sensor_read(ThermalSensor *sensor)
+{
+    char buf[256];
+
+    if (sensor->fd < 0)
+    {
+        char *file = sensor_temp_file(sensor);
+
+        sensor->fd = open(file, O_RDONLY | O_CLOEXEC);
+        if (sensor->fd < 0)
+        {
+            if (!sensor->failed)
+                g_warning("thermal: cannot open %s", file);
+            sensor->failed = TRUE;
+            g_free(file);
+            return -1;
+        }
+        sensor->failed = FALSE;
+        g_free(file);
+    }
+    if (sensor_pread(sensor->fd, buf, sizeof(buf)) <= 0)
+    {
+        /* sensor may be gone, try to reopen it next time */
+        close(sensor->fd);
+        sensor->fd = -1;
+        return -1;
+    }
+    return sensor_parse(sensor, buf);
+}
+
+/* Read a file which is used only once, returns value or -1 */
+static gint read_file_once(const char *file, const char *proc_label)
+{
+    char buf[1024];
+    gssize len;
+    int fd;
+
+    fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = sensor_pread(fd, buf, sizeof(buf));
+    close(fd);
+    if (len <= 0)
+        return -1;
+    if (proc_label)
+        return proc_parse(buf, proc_label);
+    return atoi(buf) / 1000;
+}
+
+static ThermalSensor *sensor_new(ThermalSensorType type, const char *path,
+                                 const char *name)
+{
+    ThermalSensor *sensor = g_slice_new0(ThermalSensor);
+
+    sensor->type = type;
+    sensor->path = g_strdup(path);
+    sensor->name = g_strdup(name);
+    sensor->refcount = 1;
+    sensor->fd = -1;
+    sensor->temperature = -1;
+    sensor->critical = -1;
+    if (registry == NULL)
+        registry = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_insert(registry, sensor->path, sensor);
+    g_debug("thermal: Added sensor %s", path);
+    return sensor;
+}
+
+static ThermalSensor *sensor_lookup(ThermalSensorType type, const char *path,
+                                    const char *name)
+{
+    ThermalSensor *sensor = registry ? g_hash_table_lookup(registry, path) : NULL;
+
+    if (sensor)
+        return thermal_sensor_ref(sensor);
+    return sensor_new(type, path, name);
+}
+
+ThermalSensor *thermal_sensor_get(const char *path, const char *name)
+{
+    ThermalSensorType type;
+
+    g_return_val_if_fail(path != NULL, NULL);
+    if (strncmp(path, "/sys/", 5) != 0)
+        type = THERMAL_SENSOR_PROC;
+    else if (strncmp(path, SYSFS_HWMON_DIRECTORY, strlen(SYSFS_HWMON_DIRECTORY)) != 0)
+        type = THERMAL_SENSOR_SYSFS;
+    else
+        type = THERMAL_SENSOR_HWMON;
+    return sensor_lookup(type, path, name ? name : path);
+}
+
+ThermalSensor *thermal_sensor_ref(ThermalSensor *sensor)
+{
+    sensor->refcount++;
+    return sensor;
+}
+
+void thermal_sensor_unref(ThermalSensor *sensor)
+{
+    if (--sensor->refcount > 0)
+        return;
+    g_hash_table_remove(registry, sensor->path);
+    if (sensor->fd >= 0)
+        close(sensor->fd);
+    g_free(sensor->path);
+    g_free(sensor->name);
+    g_slice_free(ThermalSensor, sensor);
+}
+
+const char *thermal_sensor_get_path(ThermalSensor *sensor)
+{
+    return sensor->path;
+}
+
+const char *thermal_sensor_get_name(ThermalSensor *sensor)
+{
+    return sensor->name;
+}
+
+gint thermal_sensor_get_critical(ThermalSensor *sensor)
+{
+    char *file;
+    gsize len;
+
+    if (sensor->critical_read)
+        return sensor->critical;
+    switch (sensor->type)
+    {
+    case THERMAL_SENSOR_PROC:
+        file = g_strconcat(sensor->path, PROC_THERMAL_TRIP, NULL);
+        sensor->critical = read_file_once(file, PROC_TRIP_CRITICAL);
+        g_free(file);
+        break;
+    case THERMAL_SENSOR_SYSFS:
+        file = g_strconcat(sensor->path, SYSFS_THERMAL_TRIP, NULL);
+        sensor->critical = read_file_once(file, NULL);
+        g_free(file);
+        break;
+    case THERMAL_SENSOR_HWMON:
+        /* tempN_input -> tempN_crit */
+        len = strlen(sensor->path);
+        if (len > 6 && strcmp(&sensor->path[len - 6], "_input") == 0)
+        {
+            file = g_strdup_printf("%.*s_crit", (int)(len - 6), sensor->path);
+            sensor->critical = read_file_once(file, NULL);
+            g_free(file);
+        }
+        break;
+    }
+    sensor->critical_read = TRUE;
+    return sensor->critical;
+}
+
+gboolean thermal_sensors_read(ThermalSensor **sensors, guint n, gint *values,
+                              ThermalSensorsSummary *summary)
+{
+    gint64 now = g_get_monotonic_time();
+    gint64 sum = 0;
+    gint min = G_MAXINT, max = G_MININT;
+    guint i, count = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        ThermalSensor *sensor = sensors[i];
+
+        if (sensor->read_time == 0 || now - sensor->read_time >= SENSOR_MAX_AGE)
+        {
+            sensor->temperature = sensor_read(sensor);
+            sensor->read_time = now;
+        }
+        if (values)
+            values[i] = sensor->temperature;
+        if (sensor->temperature == -1)
+            continue;
+        min = MIN(min, sensor->temperature);
+        max = MAX(max, sensor->temperature);
+        sum += sensor->temperature;
+        count++;
+    }
+    if (summary)
+    {
+        summary->count = count;
+        summary->min = count ? min : -1;
+        summary->max = count ? max : -1;
+        summary->average = count ? (gint)((sum + (gint64)count / 2) / count) : -1;
+    }
+    return (count > 0);
+}
+
+/* Add subdirectories of @directory which work as sensors. If @subdir_prefix
+   is not NULL then only subdirectories starting with it are considered. */
+static void find_zone_sensors(GPtrArray *list, ThermalSensorType type,
+                              const char *directory, const char *subdir_prefix)
+{
+    GDir *dir;
+    const char *entry;
+    char *path;
+    ThermalSensor *sensor;
+
+    if (!(dir = g_dir_open(directory, 0, NULL)))
+        return;
+    while ((entry = g_dir_read_name(dir)))
+    {
+        if (entry[0] == '.')
+            continue;
+        if (subdir_prefix && !g_str_has_prefix(entry, subdir_prefix))
+            continue;
+        path = g_strconcat(directory, entry, "/", NULL);
+        sensor = sensor_lookup(type, path, entry);
+        g_free(path);
+        /* make sure sensor works: https://bugzilla.kernel.org/show_bug.cgi?id=201761 */
+        sensor->failed = TRUE; /* don't warn about not working ones */
+        if (sensor_read(sensor) >= 0)
+            g_ptr_array_add(list, sensor);
+        else
+            thermal_sensor_unref(sensor);
+    }
+    g_dir_close(dir);
+}
+
+/* Add all tempN_input files in @path, returns FALSE if there are none */
+static gboolean try_hwmon_sensors(GPtrArray *list, const char *path)
+{
+    GDir *dir;
+    const char *entry, *p;
+    char *file, *label;
+    gboolean found = FALSE;
+
+    if (!(dir = g_dir_open(path, 0, NULL)))
+        return FALSE;
+    while ((entry = g_dir_read_name(dir)))
+    {
+        if (strncmp(entry, "temp", 4) != 0)
+            continue;
+        for (p = &entry[4]; g_ascii_isdigit(*p); p++);
+        if (p == &entry[4] || strcmp(p, "_input") != 0)
+            continue;
+
+        file = g_strdup_printf("%s/%.*s_label", path, (int)(p - entry), entry);
+        label = NULL;
+        if (g_file_get_contents(file, &label, NULL, NULL))
+            g_strstrip(label);
+        g_free(file);
+
+        file = g_strdup_printf("%s/%s", path, entry);
+        g_ptr_array_add(list, sensor_lookup(THERMAL_SENSOR_HWMON, file,
+                                            (label && label[0]) ? label : entry));
+        g_free(file);
+        g_free(label);
+        found = TRUE;
+    }
+    g_dir_close(dir);
+    return found;
+}
+
+/* Read name of a thermal zone type or a hwmon device from @file. The
+   kernel names a hwmon device of a thermal zone after the zone type,
+   with '-' replaced by '_' in newer versions, so that is done here too. */
+static char *read_device_name(const char *file)
+{
+    char *name, *p;
+
+    if (!g_file_get_contents(file, &name, NULL, NULL))
+        return NULL;
+    g_strstrip(name);
+    for (p = name; *p; p++)
+        if (*p == '-')
+            *p = '_';
+    return name;
+}
+
+/* Collect types of sysfs thermal zones found already. */
+static GHashTable *zone_types(GPtrArray *list)
+{
+    GHashTable *types = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    ThermalSensor *sensor;
+    char *file, *name;
+    guint i;
+
+    for (i = 0; i < list->len; i++)
+    {
+        sensor = g_ptr_array_index(list, i);
+        if (sensor->type != THERMAL_SENSOR_SYSFS)
+            continue;
+        file = g_strconcat(sensor->path, "type", NULL);
+        name = read_device_name(file);
+        g_free(file);
+        if (name)
+            g_hash_table_insert(types, name, name);
+    }
+    return types;
+}
+
+/* Add sensors of all hwmon devices except ones named in @skip. */
+static void find_hwmon_sensors(GPtrArray *list, GHashTable *skip)
+{
+    GDir *dir;
+    const char *entry;
+    char *path, *file, *name;
+
+    if (!(dir = g_dir_open(SYSFS_HWMON_DIRECTORY, 0, NULL)))
+        return;
+    while ((entry = g_dir_read_name(dir)))
+    {
+        if (entry[0] == '.')
+            continue;
+        file = g_strconcat(SYSFS_HWMON_DIRECTORY, entry, "/name", NULL);
+        name = read_device_name(file);
+        g_free(file);
+        if (name == NULL)
+        {
+            file = g_strconcat(SYSFS_HWMON_DIRECTORY, entry, "/device/name", NULL);
+            name = read_device_name(file);
+            g_free(file);
+        }
+        if (name && g_hash_table_lookup(skip, name) != NULL)
+        {
+            /* the same sensor is in the list as a thermal zone */
+            g_free(name);
+            continue;
+        }
+        g_free(name);
+        /* older kernels have attributes under device/ */
+        path = g_strconcat(SYSFS_HWMON_DIRECTORY, entry, "/device", NULL);
+        if (!try_hwmon_sensors(list, path))
+        {
+            path[strlen(path) - 7] = '\0';
+            try_hwmon_sensors(list, path);
+        }
+        g_free(path);
+    }
+    g_dir_close(dir);
+}
+
+GPtrArray *thermal_sensors_find(void)
+{
+    GPtrArray *list = g_ptr_array_new_with_free_func((GDestroyNotify)thermal_sensor_unref);
+    GHashTable *types;
+
+    find_zone_sensors(list, THERMAL_SENSOR_PROC, PROC_THERMAL_DIRECTORY, NULL);
+    find_zone_sensors(list, THERMAL_SENSOR_SYSFS, SYSFS_THERMAL_DIRECTORY,
+                      SYSFS_THERMAL_SUBDIR_PREFIX);
+    /* zones rarely cover all sensors, e.g. there is one ACPI zone and many
+       per-core coretemp sensors, so hwmon devices are always added */
+    types = zone_types(list);
+    find_hwmon_sensors(list, types);
+    g_hash_table_destroy(types);
+    g_info("thermal: Found %u sensors", list->len);
+    return list;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __THERMAL_SENSORS_H__
+#define __THERMAL_SENSORS_H__ 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+    THERMAL_SENSOR_PROC,        /* /proc/acpi/thermal_zone/X/ */
+    THERMAL_SENSOR_SYSFS,       /* /sys/class/thermal/thermal_zoneN/ */
+    THERMAL_SENSOR_HWMON        /* /sys/class/hwmon/hwmonN/.../tempM_input */
+} ThermalSensorType;
+
+typedef struct _ThermalSensor ThermalSensor;
+
+typedef struct {
+    gint min, max, average;     /* in degrees Celsius */
+    guint count;                /* number of sensors with valid readings */
+} ThermalSensorsSummary;
+
+/* Find all available sensors: thermal zones and hwmon sensors. Hwmon
+   devices which the kernel registers for thermal zones are skipped, as
+   they duplicate the zones. The array owns references to the sensors. */
+GPtrArray *thermal_sensors_find(void);
+
+/* Get sensor by its path, type is deduced from the path. If the sensor is
+   already used then the same object is returned with new reference. */
+ThermalSensor *thermal_sensor_get(const char *path, const char *name);
+ThermalSensor *thermal_sensor_ref(ThermalSensor *sensor);
+void thermal_sensor_unref(ThermalSensor *sensor);
+
+const char *thermal_sensor_get_path(ThermalSensor *sensor);
+const char *thermal_sensor_get_name(ThermalSensor *sensor);
+
+/* Critical temperature, or -1 if unknown. Read once and cached. */
+gint thermal_sensor_get_critical(ThermalSensor *sensor);
+
+/* Read all @sensors, storing temperatures into @values (if not NULL),
+   -1 for sensors which cannot be read. Sensors which were read by
+   another consumer less than a second ago are not read again.
+   Returns FALSE if none of sensors has valid reading. */
+gboolean thermal_sensors_read(ThermalSensor **sensors, guint n, gint *values,
+                              ThermalSensorsSummary *summary);
+
+G_END_DECLS
+
+#endif
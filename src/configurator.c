@@ -40,6 +40,7 @@
 
 #include "private.h"
 #include "misc.h"
+#include "icon-cache.h"
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -60,6 +61,8 @@ enum{
 static void save_global_config();
 
 static char* logout_cmd = NULL;
+static int icon_cache_size = 0; /* in KiB */
+static int event_latency = -1; /* in milliseconds, -1 means default */
 
 /* macros to update config */
 #define UPDATE_GLOBAL_INT(panel,name,val) do { \
@@ -1713,6 +1716,8 @@ GtkWidget* create_generic_config_dlg( const char* title, GtkWidget* parent,
 }
 
 #define COMMAND_GROUP "Command"
+#define CACHE_GROUP "Cache"
+#define EVENTS_GROUP "Events"
 
 void load_global_config()
 {
@@ -1750,6 +1755,9 @@ void load_global_config()
         GList *apps, *l;
 
         logout_cmd = g_key_file_get_string( kf, COMMAND_GROUP, "Logout", NULL );
+        icon_cache_size = g_key_file_get_integer( kf, CACHE_GROUP, "IconCacheSize", NULL );
+        if (g_key_file_has_key(kf, EVENTS_GROUP, "FlushLatency", NULL))
+            event_latency = g_key_file_get_integer(kf, EVENTS_GROUP, "FlushLatency", NULL);
         /* check for terminal setting on upgrade */
         if (fm_config->terminal == NULL)
         {
@@ -1789,6 +1797,11 @@ void load_global_config()
         }
     }
     g_key_file_free( kf );
+    /* size is in KiB, 0 means default */
+    lxpanel_icon_cache_set_budget((gsize)MAX(icon_cache_size, 0) * 1024);
+    /* delay limit for root window signals, 0 means they wait for idle only */
+    if (event_latency >= 0)
+        fb_ev_set_flush_latency(fbev, event_latency);
 }
 
 static void save_global_config()
@@ -1800,6 +1813,10 @@ static void save_global_config()
         fprintf( f, "[" COMMAND_GROUP "]\n");
         if( logout_cmd )
             fprintf( f, "Logout=%s\n", logout_cmd );
+        if( icon_cache_size > 0 )
+            fprintf( f, "\n[" CACHE_GROUP "]\nIconCacheSize=%d\n", icon_cache_size );
+        if( event_latency >= 0 )
+            fprintf( f, "\n[" EVENTS_GROUP "]\nFlushLatency=%d\n", event_latency );
         fclose( f );
     }
     g_free(file);
@@ -52,13 +52,23 @@ struct _FbEvClass {
 struct _FbEv {
     GObject    parent_instance;
 
+    /* cached root window properties, they are fetched on first request
+       and invalidated when panel_event_filter() reports their change */
     int current_desktop;
     int number_of_desktops;
     char **desktop_names;
+    int desktop_names_len;      /* -1 if not fetched yet */
     Window active_window;
+    gboolean active_window_valid;
     Window *client_list;
+    int client_list_len;        /* -1 if not fetched yet */
     Window *client_list_stacking;
 
+    guint dirty;                /* bitmask of queued signals */
+    guint flush_idle;           /* idle source to emit queued signals */
+    guint flush_timeout;        /* timeout source to limit the delay */
+    guint flush_latency;        /* delay limit, in milliseconds */
+
     Window   xroot;
     Atom     id;
     GC       gc;
@@ -69,6 +79,20 @@ struct _FbEv {
 /* it is created in main.c */
 FbEv *fbev = NULL;
 
+/* default limit of delay of queued signals, in milliseconds */
+#define FB_EV_FLUSH_LATENCY 50
+
+/* order in which queued signals are emitted: desktops first, then the
+   windows list, and active window last so it can be found in the list */
+static const int flush_order[] = {
+    EV_NUMBER_OF_DESKTOPS,
+    EV_DESKTOP_NAMES,
+    EV_CURRENT_DESKTOP,
+    EV_CLIENT_LIST,
+    EV_CLIENT_LIST_STACKING,
+    EV_ACTIVE_WINDOW
+};
+
 static void fb_ev_class_init (FbEvClass *klass);
 static void fb_ev_init (FbEv *monitor);
 static void fb_ev_finalize (GObject *object);
@@ -187,8 +211,13 @@ fb_ev_init (FbEv *ev)
     ev->number_of_desktops = -1;
     ev->current_desktop = -1;
     ev->active_window = None;
+    ev->active_window_valid = FALSE;
+    ev->desktop_names = NULL;
+    ev->desktop_names_len = -1;
     ev->client_list_stacking = NULL;
     ev->client_list = NULL;
+    ev->client_list_len = -1;
+    ev->flush_latency = FB_EV_FLUSH_LATENCY;
 }
 
 
@@ -201,10 +230,18 @@ fb_ev_new()
 static void
 fb_ev_finalize (GObject *object)
 {
-    //FbEv *ev;
-
-    //ev = FB_EV (object);
+    FbEv *ev;
+
+    ev = FB_EV (object);
+    if (ev->flush_idle)
+        g_source_remove(ev->flush_idle);
+    if (ev->flush_timeout)
+        g_source_remove(ev->flush_timeout);
+    ev_desktop_names(ev, NULL);
+    ev_client_list(ev, NULL);
+    ev_client_list_stacking(ev, NULL);
     //XFreeGC(ev->dpy, ev->gc);
+    G_OBJECT_CLASS(g_type_class_peek_parent(FB_EV_GET_CLASS(object)))->finalize(object);
 }
 
 void
@@ -213,18 +250,69 @@ fb_ev_emit(FbEv *ev, int signal)
     DBG("signal=%d\n", signal);
     g_assert(signal >=0 && signal < LAST_SIGNAL);
     DBG("\n");
-    if( signal == EV_ACTIVE_WINDOW )
+    g_signal_emit(ev, signals [signal], 0);
+}
+
+/* emits all queued signals, each one once */
+void
+fb_ev_flush(FbEv *ev)
+{
+    guint i;
+
+    ENTER;
+    if (ev->flush_idle)
     {
-        Window* win = None;
-        ev->active_window = None;
-        win = (Window*)get_xaproperty (GDK_ROOT_WINDOW(), a_NET_ACTIVE_WINDOW, XA_WINDOW, 0);
-        if (win) {
-            ev->active_window = *win;
-            /* g_debug( "WIN: %p", *win ); */
-            XFree (win);
+        g_source_remove(ev->flush_idle);
+        ev->flush_idle = 0;
+    }
+    if (ev->flush_timeout)
+    {
+        g_source_remove(ev->flush_timeout);
+        ev->flush_timeout = 0;
+    }
+    for (i = 0; i < G_N_ELEMENTS(flush_order) && ev->dirty; i++)
+    {
+        if (ev->dirty & (1U << flush_order[i]))
+        {
+            /* reset it before emission so handlers can queue it again */
+            ev->dirty &= ~(1U << flush_order[i]);
+            fb_ev_emit(ev, flush_order[i]);
         }
     }
-    g_signal_emit(ev, signals [signal], 0);
+    RET();
+}
+
+static gboolean fb_ev_flush_cb(gpointer user_data)
+{
+    FbEv *ev = user_data;
+
+    if (g_source_is_destroyed(g_main_current_source()))
+        return FALSE;
+    fb_ev_flush(ev);
+    return FALSE;
+}
+
+/* Queues the signal to be emitted when pending X events are processed,
+ * so a burst of property changes results in a single emission. If events
+ * keep coming, queued signals are emitted after flush latency anyway. */
+void
+fb_ev_queue(FbEv *ev, int signal)
+{
+    DBG("signal=%d\n", signal);
+    g_assert(signal >=0 && signal < LAST_SIGNAL && signal != EV_DESTROY_WINDOW);
+    ev->dirty |= (1U << signal);
+    if (ev->flush_idle == 0)
+        ev->flush_idle = g_idle_add(fb_ev_flush_cb, ev);
+    if (ev->flush_timeout == 0 && ev->flush_latency > 0)
+        ev->flush_timeout = g_timeout_add(ev->flush_latency, fb_ev_flush_cb, ev);
+}
+
+/* sets delay limit for queued signals, 0 means no limit; it is set from
+ * FlushLatency key in Events group of global config */
+void
+fb_ev_set_flush_latency(FbEv *ev, guint msec)
+{
+    ev->flush_latency = msec;
 }
 
 void fb_ev_emit_destroy(FbEv *ev, Window win)
@@ -244,7 +332,7 @@ static void
 ev_active_window(FbEv *ev, gpointer p)
 {
     ENTER;
-//    ev->active_window = None;		// Wrecks fb_ev_active window
+    ev->active_window_valid = FALSE;
     RET();
 }
 
@@ -264,6 +352,7 @@ ev_desktop_names(FbEv *ev, gpointer p)
         g_strfreev (ev->desktop_names);
         ev->desktop_names = NULL;
     }
+    ev->desktop_names_len = -1;
     RET();
 }
 static void
@@ -274,6 +363,7 @@ ev_client_list(FbEv *ev, gpointer p)
         XFree(ev->client_list);
         ev->client_list = NULL;
     }
+    ev->client_list_len = -1;
     RET();
 }
 
@@ -325,16 +415,58 @@ fb_ev_number_of_desktops(FbEv *ev)
 
 Window *fb_ev_active_window(FbEv *ev)
 {
-    return &ev->active_window;
+    ENTER;
+    if (!ev->active_window_valid) {
+        Window *win;
+
+        win = get_xaproperty (GDK_ROOT_WINDOW(), a_NET_ACTIVE_WINDOW, XA_WINDOW, 0);
+        if (win) {
+            ev->active_window = *win;
+            XFree (win);
+        } else
+            ev->active_window = None;
+        ev->active_window_valid = TRUE;
+    }
+    RET(&ev->active_window);
+}
+
+static void
+fetch_client_list(FbEv *ev)
+{
+    if (ev->client_list_len == -1) {
+        ev->client_list = get_xaproperty (GDK_ROOT_WINDOW(), a_NET_CLIENT_LIST,
+                                          XA_WINDOW, &ev->client_list_len);
+        if (!ev->client_list)
+            ev->client_list_len = 0;
+    }
 }
 
+/* returned data are owned by FbEv and valid until the next signal */
 Window *fb_ev_client_list(FbEv *ev)
 {
+    fetch_client_list(ev);
     return ev->client_list;
 }
 
+int fb_ev_client_list_length(FbEv *ev)
+{
+    fetch_client_list(ev);
+    return ev->client_list_len;
+}
+
 Window *fb_ev_client_list_stacking(FbEv *ev)
 {
     return ev->client_list_stacking;
 }
 
+char **fb_ev_desktop_names(FbEv *ev, int *len)
+{
+    ENTER;
+    if (ev->desktop_names_len == -1)
+        ev->desktop_names = get_utf8_property_list (GDK_ROOT_WINDOW(),
+                                                    a_NET_DESKTOP_NAMES,
+                                                    &ev->desktop_names_len);
+    if (len)
+        *len = ev->desktop_names_len;
+    RET(ev->desktop_names);
+}
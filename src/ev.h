@@ -69,13 +69,18 @@ GType fb_ev_get_type       (void);
 FbEv *fb_ev_new(void);
 void fb_ev_notify_changed_ev(FbEv *ev);
 void fb_ev_emit(FbEv *ev, int signal);
+void fb_ev_queue(FbEv *ev, int signal);
+void fb_ev_flush(FbEv *ev);
+void fb_ev_set_flush_latency(FbEv *ev, guint msec);
 void fb_ev_emit_destroy(FbEv *ev, Window win);
 
 extern int fb_ev_current_desktop(FbEv *ev);
 extern int fb_ev_number_of_desktops(FbEv *ev);
 extern Window *fb_ev_active_window(FbEv *ev);
 extern Window *fb_ev_client_list(FbEv *ev);
+extern int fb_ev_client_list_length(FbEv *ev);
 extern Window *fb_ev_client_list_stacking(FbEv *ev);
+extern char **fb_ev_desktop_names(FbEv *ev, int *len);
 
 /* it is created in the main.c */
 extern FbEv *fbev;
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtk.h>
+
+#include "icon-cache.h"
+
+typedef struct
+{
+    FmIcon *icon;
+    const char *fallback;       /* interned string */
+    gint size;
+    GdkPixbuf *pixbuf;          /* NULL if icon could not be loaded */
+    gsize bytes;
+    GList link;                 /* link in LRU queue, data is the entry */
+} IconCacheEntry;
+
+static GHashTable *cache = NULL;
+static GQueue lru = G_QUEUE_INIT; /* most recently used are at head */
+static gsize budget = LXPANEL_ICON_CACHE_DEFAULT_BUDGET;
+static guint generation = 0;
+static LXPanelIconCacheStats stats;
+
+static guint icon_cache_hash(gconstpointer key)
+{
+    const IconCacheEntry *entry = key;
+
+    return g_direct_hash(entry->icon) ^ g_direct_hash(entry->fallback) ^
+           (guint)entry->size * 2654435761U;
+}
+
+static gboolean icon_cache_equal(gconstpointer a, gconstpointer b)
+{
+    const IconCacheEntry *ea = a, *eb = b;
+
+    return (ea->icon == eb->icon && ea->size == eb->size &&
+            ea->fallback == eb->fallback);
+}
+
+static void icon_cache_entry_free(gpointer data)
+{
+    IconCacheEntry *entry = data;
+
+    g_queue_unlink(&lru, &entry->link);
+    stats.used -= entry->bytes;
+    g_object_unref(entry->icon);
+    if (entry->pixbuf)
+        g_object_unref(entry->pixbuf);
+    g_slice_free(IconCacheEntry, entry);
+}
+
+/* Drop least recently used entries until cache fits into budget. */
+static void icon_cache_trim(void)
+{
+    IconCacheEntry *entry;
+
+    /* keep at least one entry, it may be just added */
+    while (stats.used > budget && lru.length > 1)
+    {
+        entry = lru.tail->data;
+        g_hash_table_remove(cache, entry);
+        stats.evictions++;
+    }
+}
+
+static void on_theme_changed(GtkIconTheme *theme, gpointer unused)
+{
+    lxpanel_icon_cache_flush();
+}
+
+static void icon_cache_init(void)
+{
+    cache = g_hash_table_new_full(icon_cache_hash, icon_cache_equal, NULL,
+                                  icon_cache_entry_free);
+    /* this should be connected before any image so they get new icons */
+    g_signal_connect(gtk_icon_theme_get_default(), "changed",
+                     G_CALLBACK(on_theme_changed), NULL);
+}
+
+/* Find entry and move it to head of LRU queue. */
+static IconCacheEntry *icon_cache_lookup(IconCacheEntry *key)
+{
+    IconCacheEntry *entry;
+
+    if (G_UNLIKELY(cache == NULL))
+        icon_cache_init();
+    entry = g_hash_table_lookup(cache, key);
+    if (entry != NULL)
+    {
+        stats.hits++;
+        g_queue_unlink(&lru, &entry->link);
+        g_queue_push_head_link(&lru, &entry->link);
+    }
+    return entry;
+}
+
+/* Add new entry, consumes reference on pixbuf. If the key is in cache
+   already, e.g. it was loaded synchronously while being decoded in
+   background, then the existing entry is kept and pixbuf is dropped. */
+static IconCacheEntry *icon_cache_add(IconCacheEntry *key, GdkPixbuf *pixbuf)
+{
+    IconCacheEntry *entry = g_hash_table_lookup(cache, key);
+
+    if (entry != NULL)
+    {
+        if (pixbuf)
+            g_object_unref(pixbuf);
+        return entry;
+    }
+    entry = g_slice_new(IconCacheEntry);
+    entry->icon = g_object_ref(key->icon);
+    entry->fallback = key->fallback;
+    entry->size = key->size;
+    entry->pixbuf = pixbuf;
+    entry->bytes = sizeof(IconCacheEntry);
+    if (pixbuf)
+        entry->bytes += (gsize)gdk_pixbuf_get_rowstride(pixbuf)
+                        * gdk_pixbuf_get_height(pixbuf);
+    entry->link.data = entry;
+    entry->link.prev = entry->link.next = NULL;
+    g_queue_push_head_link(&lru, &entry->link);
+    stats.used += entry->bytes;
+    g_hash_table_insert(cache, entry, entry);
+    icon_cache_trim();
+    return entry;
+}
+
+GdkPixbuf *lxpanel_icon_cache_load(FmIcon *icon, gint size, const char *fallback)
+{
+    IconCacheEntry key, *entry;
+
+    g_return_val_if_fail(icon != NULL, NULL);
+
+    key.icon = icon;
+    key.fallback = fallback ? g_intern_string(fallback) : NULL;
+    key.size = size;
+    entry = icon_cache_lookup(&key);
+    if (entry == NULL)
+    {
+        stats.misses++;
+        entry = icon_cache_add(&key, fm_pixbuf_from_icon_with_fallback(icon, size, fallback));
+    }
+    return entry->pixbuf ? g_object_ref(entry->pixbuf) : NULL;
+}
+
+/* Loading in background: icon theme is not thread safe so the file is
+   looked up in main thread and only decoding is done by workers. */
+typedef struct
+{
+    IconCacheEntry key;         /* only icon, fallback and size are used */
+    char *filename;
+    GdkPixbuf *pixbuf;          /* result of decoding */
+    guint generation;           /* cache generation when it was queued */
+    GSList *images;             /* weak pointers to images waiting for it */
+} IconCacheRequest;
+
+static GThreadPool *pool = NULL;
+static GHashTable *pending = NULL;
+static GQuark request_quark = 0;
+
+/* worker threads which decode icons */
+#define ICON_CACHE_WORKERS 2
+
+static char *icon_cache_find_file(FmIcon *icon, gint size, const char *fallback)
+{
+    GtkIconTheme *theme = gtk_icon_theme_get_default();
+    GtkIconInfo *info;
+    char *filename = NULL;
+
+    info = gtk_icon_theme_lookup_by_gicon(theme, fm_icon_get_gicon(icon), size,
+                                          GTK_ICON_LOOKUP_FORCE_SIZE);
+    if (info == NULL && fallback != NULL)
+        info = gtk_icon_theme_lookup_icon(theme, fallback, size,
+                                          GTK_ICON_LOOKUP_FORCE_SIZE);
+    if (info != NULL)
+    {
+        filename = g_strdup(gtk_icon_info_get_filename(info));
+#if GTK_CHECK_VERSION(3, 8, 0)
+        g_object_unref(info);
+#else
+        gtk_icon_info_free(info);
+#endif
+    }
+    return filename;
+}
+
+static gboolean icon_cache_request_done(gpointer data)
+{
+    IconCacheRequest *req = data;
+    IconCacheEntry *entry = NULL;
+    GSList *l;
+
+    /* after a flush there may be a newer request for the same icon */
+    if (g_hash_table_lookup(pending, req) == req)
+        g_hash_table_remove(pending, req);
+    if (req->generation == generation)
+    {
+        /* decoding may fail, e.g. there is no loader, try usual way then */
+        if (req->pixbuf == NULL)
+            req->pixbuf = fm_pixbuf_from_icon_with_fallback(req->key.icon,
+                                                            req->key.size,
+                                                            req->key.fallback);
+        entry = icon_cache_add(&req->key, req->pixbuf);
+        req->pixbuf = NULL;
+    }
+    /* otherwise theme was changed, images will be reloaded by their owners */
+    for (l = req->images; l; l = l->next)
+    {
+        if (l->data == NULL) /* destroyed already */
+            continue;
+        g_object_remove_weak_pointer(l->data, &l->data);
+        /* image might be requested for another icon since then */
+        if (g_object_get_qdata(l->data, request_quark) != req)
+            continue;
+        g_object_set_qdata(l->data, request_quark, NULL);
+        if (entry != NULL && entry->pixbuf != NULL)
+            gtk_image_set_from_pixbuf(l->data, entry->pixbuf);
+    }
+    g_slist_free(req->images);
+    if (req->pixbuf)
+        g_object_unref(req->pixbuf);
+    g_object_unref(req->key.icon);
+    g_free(req->filename);
+    g_slice_free(IconCacheRequest, req);
+    return FALSE;
+}
+
+static void icon_cache_decode(gpointer data, gpointer unused)
+{
+    IconCacheRequest *req = data;
+
+    req->pixbuf = gdk_pixbuf_new_from_file_at_size(req->filename, req->key.size,
+                                                   req->key.size, NULL);
+    /* deliver it before next redraw */
+    g_idle_add_full(G_PRIORITY_HIGH_IDLE, icon_cache_request_done, req, NULL);
+}
+
+/* Queue loading of the icon, returns entry if it is in cache already. */
+static IconCacheEntry *icon_cache_queue(FmIcon *icon, gint size,
+                                        const char *fallback, GtkImage *image)
+{
+    IconCacheEntry key, *entry;
+    IconCacheRequest *req;
+    char *filename;
+
+    key.icon = icon;
+    key.fallback = fallback ? g_intern_string(fallback) : NULL;
+    key.size = size;
+    entry = icon_cache_lookup(&key);
+    if (entry != NULL)
+        return entry;
+    if (G_UNLIKELY(pool == NULL))
+    {
+        pool = g_thread_pool_new(icon_cache_decode, NULL, ICON_CACHE_WORKERS,
+                                 FALSE, NULL);
+        pending = g_hash_table_new(icon_cache_hash, icon_cache_equal);
+        request_quark = g_quark_from_static_string("lxpanel-icon-cache-request");
+    }
+    req = g_hash_table_lookup(pending, &key);
+    if (req == NULL)
+    {
+        filename = icon_cache_find_file(icon, size, key.fallback);
+        if (filename == NULL) /* builtin icon or so, load it right away */
+        {
+            stats.misses++;
+            return icon_cache_add(&key, fm_pixbuf_from_icon_with_fallback(icon, size, fallback));
+        }
+        stats.misses++;
+        req = g_slice_new0(IconCacheRequest);
+        req->key = key;
+        g_object_ref(icon);
+        req->filename = filename;
+        req->generation = generation;
+        g_hash_table_insert(pending, req, req);
+        g_thread_pool_push(pool, req, NULL);
+    }
+    if (image != NULL && g_object_get_qdata(G_OBJECT(image), request_quark) != req)
+    {
+        g_object_set_qdata(G_OBJECT(image), request_quark, req);
+        req->images = g_slist_prepend(req->images, image);
+        g_object_add_weak_pointer(G_OBJECT(image), &req->images->data);
+    }
+    return NULL;
+}
+
+gboolean lxpanel_icon_cache_load_image(GtkImage *image, FmIcon *icon, gint size,
+                                       const char *fallback)
+{
+    IconCacheEntry *entry;
+
+    g_return_val_if_fail(GTK_IS_IMAGE(image) && icon != NULL, FALSE);
+
+    entry = icon_cache_queue(icon, size, fallback, image);
+    if (entry == NULL)
+        return FALSE;
+    /* drop any request queued for this image before */
+    if (request_quark != 0)
+        g_object_set_qdata(G_OBJECT(image), request_quark, NULL);
+    if (entry->pixbuf != NULL)
+        gtk_image_set_from_pixbuf(image, entry->pixbuf);
+    return TRUE;
+}
+
+void lxpanel_icon_cache_prefetch(FmIcon *icon, gint size, const char *fallback)
+{
+    g_return_if_fail(icon != NULL);
+
+    icon_cache_queue(icon, size, fallback, NULL);
+}
+
+void lxpanel_icon_cache_set_budget(gsize new_budget)
+{
+    budget = new_budget ? new_budget : LXPANEL_ICON_CACHE_DEFAULT_BUDGET;
+    if (G_UNLIKELY(cache == NULL))
+        icon_cache_init();
+    else
+        icon_cache_trim();
+}
+
+void lxpanel_icon_cache_get_stats(LXPanelIconCacheStats *result)
+{
+    *result = stats;
+    result->n_entries = lru.length;
+    result->budget = budget;
+}
+
+guint lxpanel_icon_cache_get_generation(void)
+{
+    return generation;
+}
+
+void lxpanel_icon_cache_flush(void)
+{
+    generation++;
+    stats.flushes++;
+    if (cache != NULL)
+        g_hash_table_remove_all(cache);
+    /* requests in progress will be dropped when done */
+    if (pending != NULL)
+        g_hash_table_remove_all(pending);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ICON_CACHE_H__
+#define __ICON_CACHE_H__ 1
+
+#include <libfm/fm.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* default memory budget of the icon cache, in bytes */
+#define LXPANEL_ICON_CACHE_DEFAULT_BUDGET (4 * 1024 * 1024)
+
+typedef struct
+{
+    guint hits;                 /* lookups which found a pixbuf in cache */
+    guint misses;               /* lookups which had to load an icon */
+    guint evictions;            /* entries dropped to fit into budget */
+    guint flushes;              /* icon theme changes */
+    guint n_entries;            /* number of cached pixbufs */
+    gsize used;                 /* memory used by entries, in bytes */
+    gsize budget;               /* memory budget, in bytes */
+} LXPanelIconCacheStats;
+
+/**
+ * lxpanel_icon_cache_load
+ * @icon: icon to load
+ * @size: size in pixels
+ * @fallback: (allow-none): name of icon to use if @icon isn't available
+ *
+ * Retrieves pixbuf for @icon from the panel-wide cache, loading it with
+ * fm_pixbuf_from_icon_with_fallback() if it isn't cached yet. The least
+ * recently used pixbufs are dropped when cache exceeds its memory budget.
+ * The cache is flushed when the default icon theme is changed.
+ *
+ * Returns: (transfer full): pixbuf or %NULL if @icon could not be loaded.
+ */
+extern GdkPixbuf *lxpanel_icon_cache_load(FmIcon *icon, gint size, const char *fallback);
+
+/**
+ * lxpanel_icon_cache_load_image
+ * @image: image to set icon into
+ * @icon: icon to load
+ * @size: size in pixels
+ * @fallback: (allow-none): name of icon to use if @icon isn't available
+ *
+ * Sets pixbuf for @icon into @image if it is in cache. Otherwise the icon
+ * file is decoded in background thread and pixbuf is set into @image from
+ * main loop when it's ready, unless @image is destroyed or another icon
+ * is requested for it before that.
+ *
+ * Returns: %TRUE if @image was updated immediately.
+ */
+extern gboolean lxpanel_icon_cache_load_image(GtkImage *image, FmIcon *icon,
+                                              gint size, const char *fallback);
+
+/**
+ * lxpanel_icon_cache_prefetch
+ * @icon: icon to load
+ * @size: size in pixels
+ * @fallback: (allow-none): name of icon to use if @icon isn't available
+ *
+ * Queues decoding of @icon in background thread if it isn't cached yet,
+ * so it will be ready when requested later.
+ */
+extern void lxpanel_icon_cache_prefetch(FmIcon *icon, gint size, const char *fallback);
+
+/**
+ * lxpanel_icon_cache_set_budget
+ * @budget: memory limit in bytes, 0 to use default
+ *
+ * Changes memory budget of the cache, dropping entries if needed. The
+ * panel calls it on start, before any icon is loaded.
+ */
+extern void lxpanel_icon_cache_set_budget(gsize budget);
+
+/**
+ * lxpanel_icon_cache_get_stats
+ * @stats: (out): location to save statistics
+ *
+ * Retrieves counters of the cache since start.
+ */
+extern void lxpanel_icon_cache_get_stats(LXPanelIconCacheStats *stats);
+
+/**
+ * lxpanel_icon_cache_get_generation
+ *
+ * Retrieves the counter which is increased each time the cache is flushed
+ * due to icon theme change. Pixbufs loaded with older generation should
+ * not be used anymore.
+ *
+ * Returns: the current generation.
+ */
+extern guint lxpanel_icon_cache_get_generation(void);
+
+/**
+ * lxpanel_icon_cache_flush
+ *
+ * Drops all cached pixbufs and increases the generation.
+ */
+extern void lxpanel_icon_cache_flush(void);
+
+G_END_DECLS
+
+#endif
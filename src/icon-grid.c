@@ -44,6 +44,24 @@ enum {
   CHILD_PROP_POSITION
 };
 
+/* Placement of a child made by last size allocation. */
+typedef struct
+{
+    GtkAllocation allocation;			/* Allocation given to the child */
+    gint req_width;				/* Checked requisition width of the child */
+    guint x, y, next_coord;			/* Placement state after the child */
+    int x_delta;
+    guint line;					/* Column (or row if vertical) of the child */
+    gboolean visible : 1;			/* Whether the child was visible */
+} IconGridSlot;
+
+/* A column of children in horizontal orientation or a row in vertical one. */
+typedef struct
+{
+    GList *first;				/* First child placed in the line */
+    gint start, end;				/* Extent of the line across it */
+} IconGridLine;
+
 /* Representative of an icon grid.  This is a manager that packs widgets into a rectangular grid whose size adapts to conditions. */
 struct _PanelIconGrid
 {
@@ -62,6 +80,14 @@ struct _PanelIconGrid
     GdkWindow *event_window;			/* Event window if NO_WINDOW is set */
     GtkWidget *dest_item;			/* Drag destination to draw focus */
     PanelIconGridDropPosition dest_pos;		/* Position to draw focus */
+    GArray *layout;				/* IconGridSlot for each child */
+    GArray *lines;				/* IconGridLine, index for hit-testing */
+    guint first_dirty;				/* Index of first child needing relayout */
+    GtkAllocation layout_allocation;		/* Allocation the layout was made for */
+    gint layout_child_width;			/* Constrained child width of the layout */
+    gint layout_child_height;			/* Constrained child height of the layout */
+    guint layout_border;			/* Border width of the layout */
+    GtkTextDirection layout_direction;		/* Text direction of the layout */
 };
 
 struct _PanelIconGridClass
@@ -89,6 +115,17 @@ static void icon_grid_element_check_requisition(PanelIconGrid *ig,
 static void panel_icon_grid_size_request(GtkWidget *widget,
                                          GtkRequisition *requisition);
 
+/* Mark placement of children starting from index as invalid. */
+static void icon_grid_invalidate_layout(PanelIconGrid *ig, guint index)
+{
+    if (index < ig->first_dirty)
+        ig->first_dirty = index;
+    if (index < ig->layout->len)
+        g_array_set_size(ig->layout, index);
+    /* lines may refer to removed children, they are rebuilt on allocation */
+    g_array_set_size(ig->lines, 0);
+}
+
 static gboolean check_for_recalc(PanelIconGrid *ig)
 {
     GtkWidget *toplevel = gtk_widget_get_toplevel((GtkWidget *)ig);
@@ -106,6 +143,63 @@ static gboolean check_for_recalc(PanelIconGrid *ig)
     return FALSE;
 }
 
+/* Add placed child into index of lines. */
+static void icon_grid_add_to_line(PanelIconGrid *ig, GList *ige, IconGridSlot *slot)
+{
+    IconGridLine *line;
+    gint start, end;
+
+    if (ig->orientation == GTK_ORIENTATION_HORIZONTAL)
+    {
+        start = slot->allocation.x;
+        end = start + slot->allocation.width;
+    }
+    else
+    {
+        start = slot->allocation.y;
+        end = start + slot->allocation.height;
+    }
+    if (slot->line >= ig->lines->len)
+    {
+        g_array_set_size(ig->lines, slot->line + 1);
+        line = &g_array_index(ig->lines, IconGridLine, slot->line);
+        line->first = ige;
+        line->start = start;
+        line->end = end;
+    }
+    else
+    {
+        line = &g_array_index(ig->lines, IconGridLine, slot->line);
+        line->start = MIN(line->start, start);
+        line->end = MAX(line->end, end);
+    }
+}
+
+/* Find the child where hit-testing at coordinate should start: all children
+   before it are in lines which end before the coordinate (or start after it
+   for columns in RTL direction). Lines are ordered so binary search works. */
+static GList *icon_grid_find_line(PanelIconGrid *ig, gint coord, gboolean rtl_columns)
+{
+    guint lo = 0, hi = ig->lines->len, mid;
+    IconGridLine *line;
+
+    /* Index is not valid until the next allocation. */
+    if (ig->first_dirty != G_MAXUINT)
+        return ig->children;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        line = &g_array_index(ig->lines, IconGridLine, mid);
+        if (rtl_columns ? (line->start > coord) : (line->end <= coord))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == ig->lines->len)
+        return NULL;
+    return g_array_index(ig->lines, IconGridLine, lo).first;
+}
+
 /* Establish the widget placement of an icon grid. */
 static void panel_icon_grid_size_allocate(GtkWidget *widget,
                                           GtkAllocation *allocation)
@@ -123,6 +217,8 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
     guint x, y;
     GList *ige;
     GtkWidget *child;
+    IconGridSlot *slot;
+    guint i, start, n_line;
 
     /* Apply given allocation */
     gtk_widget_set_allocation(widget, allocation);
@@ -216,12 +312,60 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
     }
     y = y_border;
     x_delta = 0;
+    n_line = 0;
+    g_array_set_size(ig->lines, 0);
+
+    /* Placement of children before first changed one can be reused if
+       nothing else that affects placement was changed since last time. */
+    if (allocation->x == ig->layout_allocation.x &&
+        allocation->y == ig->layout_allocation.y &&
+        allocation->width == ig->layout_allocation.width &&
+        allocation->height == ig->layout_allocation.height &&
+        child_width == ig->layout_child_width &&
+        child_height == ig->layout_child_height &&
+        border == ig->layout_border && direction == ig->layout_direction)
+        start = MIN(ig->first_dirty, ig->layout->len);
+    else
+        start = 0;
+    ig->layout_allocation = *allocation;
+    ig->layout_child_width = child_width;
+    ig->layout_child_height = child_height;
+    ig->layout_border = border;
+    ig->layout_direction = direction;
+    g_array_set_size(ig->layout, g_list_length(ig->children));
 
     /* Reposition each visible child. */
-    for (ige = ig->children; ige != NULL; ige = ige->next)
+    for (ige = ig->children, i = 0; ige != NULL; ige = ige->next, i++)
     {
         child = ige->data;
-        if (gtk_widget_get_visible(child))
+        slot = &g_array_index(ig->layout, IconGridSlot, i);
+        if (i < start)
+        {
+            /* Reuse placement if the child visibility and size are the same */
+            if (!gtk_widget_get_visible(child) == !slot->visible)
+            {
+                if (!slot->visible)
+                    continue;
+                gtk_widget_get_child_requisition(child, &req);
+                icon_grid_element_check_requisition(ig, &req);
+                if (req.width == slot->req_width)
+                {
+                    x = slot->x;
+                    y = slot->y;
+                    next_coord = slot->next_coord;
+                    x_delta = slot->x_delta;
+                    n_line = slot->line;
+                    /* Child may still need to allocate its own children */
+                    gtk_widget_size_allocate(child, &slot->allocation);
+                    icon_grid_add_to_line(ig, ige, slot);
+                    continue;
+                }
+            }
+            /* It has changed, relayout this child and all after it. */
+            start = i;
+        }
+        slot->visible = gtk_widget_get_visible(child);
+        if (slot->visible)
         {
             /* Do necessary operations on the child. */
             gtk_widget_get_child_requisition(child, &req);
@@ -235,6 +379,7 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
                 y = next_coord;
                 if (y + child_height > allocation->height - y_border && y > y_border)
                 {
+                    n_line++;
                     y = y_border;
                     if (direction == GTK_TEXT_DIR_RTL)
                         x -= (x_delta + ig->spacing);
@@ -254,6 +399,7 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
                 {
                     if (x < allocation->width - x_border && x - child_allocation.width < x_border)
                     {
+                        n_line++;
                         x = allocation->width - x_border;
                         y += child_height + ig->spacing;
                     }
@@ -263,6 +409,7 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
                 {
                     if (x + child_allocation.width > allocation->width - x_border && x > x_border)
                     {
+                        n_line++;
                         x = x_border;
                         y += child_height + ig->spacing;
                     }
@@ -284,8 +431,19 @@ static void panel_icon_grid_size_allocate(GtkWidget *widget,
             }
             // FIXME: if fill_width and rows > 1 then delay allocation
             gtk_widget_size_allocate(child, &child_allocation);
+
+            /* Remember placement for the next allocation. */
+            slot->allocation = child_allocation;
+            slot->req_width = req.width;
+            slot->x = x;
+            slot->y = y;
+            slot->next_coord = next_coord;
+            slot->x_delta = x_delta;
+            slot->line = n_line;
+            icon_grid_add_to_line(ig, ige, slot);
         }
     }
+    ig->first_dirty = G_MAXUINT;
 }
 
 /* Establish the geometry of an icon grid. */
@@ -440,6 +598,9 @@ static void panel_icon_grid_add(GtkContainer *container, GtkWidget *widget)
     /* Insert at the tail of the child list.  This keeps the graphics in the order they were added. */
     ig->children = g_list_append(ig->children, widget);
 
+    /* Placement of existing children is not affected. */
+    icon_grid_invalidate_layout(ig, g_list_length(ig->children) - 1);
+
     /* Add the widget to the layout container. */
     gtk_widget_set_parent(widget, GTK_WIDGET(container));
 //    gtk_widget_queue_resize(GTK_WIDGET(container));
@@ -454,6 +615,7 @@ void panel_icon_grid_set_constrain_width(PanelIconGrid * ig, gboolean constrain_
         return;
 
     ig->constrain_width = !!constrain_width;
+    icon_grid_invalidate_layout(ig, 0);
     gtk_widget_queue_resize(GTK_WIDGET(ig));
 }
 
@@ -465,6 +627,7 @@ void panel_icon_grid_set_aspect_width(PanelIconGrid * ig, gboolean aspect_width)
         return;
 
     ig->aspect_width = !!aspect_width;
+    icon_grid_invalidate_layout(ig, 0);
     gtk_widget_queue_resize(GTK_WIDGET(ig));
 }
 
@@ -485,6 +648,7 @@ static void panel_icon_grid_remove(GtkContainer *container, GtkWidget *widget)
     PanelIconGrid *ig = PANEL_ICON_GRID(container);
     GList *children = ig->children;
     GtkWidget *child;
+    guint i = 0;
 
     while (children)
     {
@@ -494,6 +658,7 @@ static void panel_icon_grid_remove(GtkContainer *container, GtkWidget *widget)
             gboolean was_visible = gtk_widget_get_visible(widget);
 
             /* The child is found.  Remove from child list and layout container. */
+            icon_grid_invalidate_layout(ig, i);
             gtk_widget_unparent (widget);
             ig->children = g_list_remove_link(ig->children, children);
             g_list_free(children);
@@ -504,6 +669,7 @@ static void panel_icon_grid_remove(GtkContainer *container, GtkWidget *widget)
             break;
         }
         children = children->next;
+        i++;
     }
 }
 
@@ -544,6 +710,7 @@ void panel_icon_grid_reorder_child(PanelIconGrid * ig, GtkWidget * child, gint p
         return;
 
     /* Remove the child from its current position. */
+    icon_grid_invalidate_layout(ig, (position < 0) ? old_position : MIN(position, old_position));
     ig->children = g_list_delete_link(ig->children, old_link);
     if (position < 0)
         new_link = NULL;
@@ -583,6 +750,7 @@ void panel_icon_grid_set_geometry(PanelIconGrid * ig,
     ig->child_height = child_height;
     ig->spacing = MAX(spacing, 1);
     ig->target_dimension = MAX(target_dimension, 0);
+    icon_grid_invalidate_layout(ig, 0);
     gtk_widget_queue_resize(GTK_WIDGET(ig));
 }
 
@@ -607,8 +775,10 @@ gboolean panel_icon_grid_get_dest_at_pos(PanelIconGrid * ig, gint x, gint y,
     rtl = (gtk_widget_get_direction(widget) == GTK_TEXT_DIR_RTL);
     if (ig->orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-        for (ige = ig->children; ige != NULL; ige = ige->next)
+        for (ige = icon_grid_find_line(ig, x, rtl); ige != NULL; ige = ige->next)
         {
+            if (!gtk_widget_get_visible(ige->data))
+                continue;
             gtk_widget_get_allocation(ige->data, &allocation);
             if (x < allocation.x)
             {
@@ -649,8 +819,10 @@ gboolean panel_icon_grid_get_dest_at_pos(PanelIconGrid * ig, gint x, gint y,
     }
     else
     {
-        for (ige = ig->children; ige != NULL; ige = ige->next)
+        for (ige = icon_grid_find_line(ig, y, FALSE); ige != NULL; ige = ige->next)
         {
+            if (!gtk_widget_get_visible(ige->data))
+                continue;
             gtk_widget_get_allocation(ige->data, &allocation);
             if (y < allocation.y)
             {
@@ -826,6 +998,7 @@ static void panel_icon_grid_set_property(GObject *object, guint prop_id,
         if (orientation != ig->orientation)
         {
             ig->orientation = orientation;
+            icon_grid_invalidate_layout(ig, 0);
             gtk_widget_queue_resize(GTK_WIDGET(ig));
         }
         break;
@@ -834,6 +1007,7 @@ static void panel_icon_grid_set_property(GObject *object, guint prop_id,
         if (spacing != ig->spacing)
         {
             ig->spacing = spacing;
+            icon_grid_invalidate_layout(ig, 0);
             g_object_notify(object, "spacing");
             gtk_widget_queue_resize(GTK_WIDGET(ig));
         }
@@ -1142,6 +1316,16 @@ static void panel_icon_grid_get_child_property(GtkContainer *container,
     }
 }
 
+static void panel_icon_grid_finalize(GObject *object)
+{
+    PanelIconGrid *ig = PANEL_ICON_GRID(object);
+
+    g_array_free(ig->layout, TRUE);
+    g_array_free(ig->lines, TRUE);
+
+    G_OBJECT_CLASS(panel_icon_grid_parent_class)->finalize(object);
+}
+
 static void panel_icon_grid_class_init(PanelIconGridClass *klass)
 {
     GObjectClass *object_class = G_OBJECT_CLASS(klass);
@@ -1150,6 +1334,7 @@ static void panel_icon_grid_class_init(PanelIconGridClass *klass)
 
     object_class->set_property = panel_icon_grid_set_property;
     object_class->get_property = panel_icon_grid_get_property;
+    object_class->finalize = panel_icon_grid_finalize;
 
 #if GTK_CHECK_VERSION(3, 0, 0)
     widget_class->get_preferred_width = panel_icon_grid_get_preferred_width;
@@ -1215,6 +1400,9 @@ static void panel_icon_grid_init(PanelIconGrid *ig)
     gtk_widget_set_redraw_on_allocate(GTK_WIDGET(ig), FALSE);
 
     ig->orientation = GTK_ORIENTATION_HORIZONTAL;
+    ig->layout = g_array_new(FALSE, FALSE, sizeof(IconGridSlot));
+    ig->lines = g_array_new(FALSE, FALSE, sizeof(IconGridLine));
+    ig->first_dirty = 0;
 }
 
 /* Establish an icon grid in a specified container widget.
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <poll.h>
 
 static Display* dpy;
 
@@ -43,6 +44,7 @@ static const char usage[] =
         "config\t\t\tshow configuration dialog\n"
         "restart\t\t\trestart lxpanel\n"
         "exit\t\t\texit lxpanel\n"
+        "iconcache\t\tprint icon cache statistics\n"
         "command <plugin> <cmd>\tsend a command to a plugin\n\n";
 
 static int get_cmd( const char* cmd )
@@ -59,6 +61,8 @@ static int get_cmd( const char* cmd )
         return LXPANEL_CMD_EXIT;
     else if( ! strcmp( cmd, "command") )
         return LXPANEL_CMD_COMMAND;
+    else if( ! strcmp( cmd, "iconcache") )
+        return LXPANEL_CMD_ICON_CACHE;
     return -1;
 }
 
@@ -84,6 +88,43 @@ static int parse_id(const char *arg, int *mon)
     return EDGE_NONE;
 }
 
+/* wait for lxpanel to set reply property on root window and print it */
+static int print_reply(Window root, Atom prop)
+{
+    XEvent ev;
+    struct pollfd pfd;
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data = NULL;
+
+    pfd.fd = ConnectionNumber(dpy);
+    pfd.events = POLLIN;
+    for (;;)
+    {
+        while (XPending(dpy))
+        {
+            XNextEvent(dpy, &ev);
+            if (ev.type == PropertyNotify && ev.xproperty.atom == prop &&
+                ev.xproperty.state == PropertyNewValue)
+                goto done;
+        }
+        if (poll(&pfd, 1, 2000) <= 0)
+        {
+            printf("No reply from lxpanel\n");
+            return 1;
+        }
+    }
+done:
+    if (XGetWindowProperty(dpy, root, prop, 0, 1024, True, XA_STRING, &type,
+                           &format, &nitems, &bytes_after, &data) != Success ||
+        data == NULL)
+        return 1;
+    printf("%.*s", (int)nitems, data);
+    XFree(data);
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
     char *display_name = (char *)getenv("DISPLAY");
@@ -131,6 +172,10 @@ int main( int argc, char** argv )
 
     ev.xclient.data.b[0] = cmd;
 
+    if (cmd == LXPANEL_CMD_ICON_CACHE)
+        /* select events before sending so the reply can't be missed */
+        XSelectInput(dpy, root, PropertyChangeMask);
+
     if (cmd == LXPANEL_CMD_COMMAND)
     {
         int i = 2;
@@ -151,6 +196,12 @@ int main( int argc, char** argv )
     XSendEvent(dpy, root, False,
                SubstructureRedirectMask|SubstructureNotifyMask, &ev);
     XSync(dpy, False);
+    if (cmd == LXPANEL_CMD_ICON_CACHE)
+    {
+        int ret = print_reply(root, XInternAtom(dpy, "_LXPANEL_ICON_CACHE", False));
+        XCloseDisplay(dpy);
+        return ret;
+    }
     XCloseDisplay(dpy);
 
 /*
@@ -53,6 +53,7 @@
 
 #include "private.h"
 #include "misc.h"
+#include "icon-cache.h"
 
 #include "lxpanelctl.h"
 #include "dbg.h"
@@ -200,9 +201,49 @@ static void process_client_msg ( XClientMessageEvent* ev )
             } while(0);
             g_free(plugin_type);
             break;
+        case LXPANEL_CMD_ICON_CACHE:
+            {
+            LXPanelIconCacheStats stats;
+            char *reply;
+
+            /* lxpanelctl waits for the property and prints it */
+            lxpanel_icon_cache_get_stats(&stats);
+            reply = g_strdup_printf("hits: %u\nmisses: %u\nevictions: %u\n"
+                                    "flushes: %u\nentries: %u\n"
+                                    "memory: %" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT " bytes\n",
+                                    stats.hits, stats.misses, stats.evictions,
+                                    stats.flushes, stats.n_entries,
+                                    stats.used, stats.budget);
+            XChangeProperty(GDK_DISPLAY_XDISPLAY(gdk_display_get_default()),
+                            GDK_ROOT_WINDOW(),
+                            gdk_x11_get_xatom_by_name("_LXPANEL_ICON_CACHE"),
+                            XA_STRING, 8, PropModeReplace,
+                            (guchar *)reply, strlen(reply));
+            g_free(reply);
+            }
+            break;
     }
 }
 
+/* these are connected before any plugin so panels are updated first */
+static void on_fbev_current_desktop(FbEv *ev, gpointer unused)
+{
+    GSList* l;
+    int curdesk = fb_ev_current_desktop(ev);
+
+    for( l = all_panels; l; l = l->next )
+        ((LXPanel*)l->data)->priv->curdesk = curdesk;
+}
+
+static void on_fbev_number_of_desktops(FbEv *ev, gpointer unused)
+{
+    GSList* l;
+    int desknum = fb_ev_number_of_desktops(ev);
+
+    for( l = all_panels; l; l = l->next )
+        ((LXPanel*)l->data)->priv->desknum = desknum;
+}
+
 static GdkFilterReturn
 panel_event_filter(GdkXEvent *xevent, GdkEvent *event, gpointer not_used)
 {
@@ -232,33 +273,27 @@ panel_event_filter(GdkXEvent *xevent, GdkEvent *event, gpointer not_used)
     {
         if (at == a_NET_CLIENT_LIST)
         {
-            fb_ev_emit(fbev, EV_CLIENT_LIST);
+            fb_ev_queue(fbev, EV_CLIENT_LIST);
         }
         else if (at == a_NET_CURRENT_DESKTOP)
         {
-            GSList* l;
-            for( l = all_panels; l; l = l->next )
-                ((LXPanel*)l->data)->priv->curdesk = get_net_current_desktop();
-            fb_ev_emit(fbev, EV_CURRENT_DESKTOP);
+            fb_ev_queue(fbev, EV_CURRENT_DESKTOP);
         }
         else if (at == a_NET_NUMBER_OF_DESKTOPS)
         {
-            GSList* l;
-            for( l = all_panels; l; l = l->next )
-                ((LXPanel*)l->data)->priv->desknum = get_net_number_of_desktops();
-            fb_ev_emit(fbev, EV_NUMBER_OF_DESKTOPS);
+            fb_ev_queue(fbev, EV_NUMBER_OF_DESKTOPS);
         }
         else if (at == a_NET_DESKTOP_NAMES)
         {
-            fb_ev_emit(fbev, EV_DESKTOP_NAMES);
+            fb_ev_queue(fbev, EV_DESKTOP_NAMES);
         }
         else if (at == a_NET_ACTIVE_WINDOW)
         {
-            fb_ev_emit(fbev, EV_ACTIVE_WINDOW );
+            fb_ev_queue(fbev, EV_ACTIVE_WINDOW);
         }
         else if (at == a_NET_CLIENT_LIST_STACKING)
         {
-            fb_ev_emit(fbev, EV_CLIENT_LIST_STACKING);
+            fb_ev_queue(fbev, EV_CLIENT_LIST_STACKING);
         }
         else if (at == a_XROOTPMAP_ID)
         {
@@ -542,6 +577,8 @@ int main(int argc, char *argv[], char *env[])
     gtk_icon_theme_append_search_path( gtk_icon_theme_get_default(), PACKAGE_DATA_DIR "/images" );
 
     fbev = fb_ev_new();
+    g_signal_connect(fbev, "current-desktop", G_CALLBACK(on_fbev_current_desktop), NULL);
+    g_signal_connect(fbev, "number-of-desktops", G_CALLBACK(on_fbev_number_of_desktops), NULL);
 
     is_restarting = FALSE;
 
@@ -27,8 +27,16 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 #include <X11/cursorfont.h>
+#ifdef HAVE_X11_XCB
+#include <X11/Xlib-xcb.h>
+#endif
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
@@ -42,6 +50,7 @@
 
 #include "misc.h"
 #include "private.h"
+#include "icon-cache.h"
 
 #include "dbg.h"
 
@@ -696,6 +705,30 @@ get_net_wm_pid(Window win)
     RET(pid);
 }
 
+static void
+net_wm_state_add(NetWMState *nws, Atom state)
+{
+    if (state == a_NET_WM_STATE_SKIP_PAGER) {
+        DBG("NET_WM_STATE_SKIP_PAGER ");
+        nws->skip_pager = 1;
+    } else if (state == a_NET_WM_STATE_SKIP_TASKBAR) {
+        DBG( "NET_WM_STATE_SKIP_TASKBAR ");
+        nws->skip_taskbar = 1;
+    } else if (state == a_NET_WM_STATE_STICKY) {
+        DBG( "NET_WM_STATE_STICKY ");
+        nws->sticky = 1;
+    } else if (state == a_NET_WM_STATE_HIDDEN) {
+        DBG( "NET_WM_STATE_HIDDEN ");
+        nws->hidden = 1;
+    } else if (state == a_NET_WM_STATE_SHADED) {
+        DBG( "NET_WM_STATE_SHADED ");
+        nws->shaded = 1;
+    //FIXME: modal maximized_vert maximized_horz fullscreen above below demands_attention
+    } else {
+        DBG( "... ");
+    }
+}
+
 void
 get_net_wm_state(Window win, NetWMState *nws)
 {
@@ -709,32 +742,45 @@ get_net_wm_state(Window win, NetWMState *nws)
         RET();
 
     DBG( "%x: netwm state = { ", (unsigned int)win);
-    while (--num3 >= 0) {
-        if (state[num3] == a_NET_WM_STATE_SKIP_PAGER) {
-            DBG("NET_WM_STATE_SKIP_PAGER ");
-            nws->skip_pager = 1;
-        } else if (state[num3] == a_NET_WM_STATE_SKIP_TASKBAR) {
-            DBG( "NET_WM_STATE_SKIP_TASKBAR ");
-        nws->skip_taskbar = 1;
-    } else if (state[num3] == a_NET_WM_STATE_STICKY) {
-            DBG( "NET_WM_STATE_STICKY ");
-        nws->sticky = 1;
-        } else if (state[num3] == a_NET_WM_STATE_HIDDEN) {
-            DBG( "NET_WM_STATE_HIDDEN ");
-            nws->hidden = 1;
-    } else if (state[num3] == a_NET_WM_STATE_SHADED) {
-            DBG( "NET_WM_STATE_SHADED ");
-            nws->shaded = 1;
-    //FIXME: modal maximized_vert maximized_horz fullscreen above below demands_attention
-    } else {
-        DBG( "... ");
-    }
-    }
+    while (--num3 >= 0)
+        net_wm_state_add(nws, state[num3]);
     XFree(state);
     DBG( "}\n");
     RET();
 }
 
+static void
+net_wm_window_type_add(NetWMWindowType *nwwt, Atom type)
+{
+    if (type == a_NET_WM_WINDOW_TYPE_DESKTOP) {
+        DBG("NET_WM_WINDOW_TYPE_DESKTOP ");
+        nwwt->desktop = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_DOCK) {
+        DBG( "NET_WM_WINDOW_TYPE_DOCK ");
+        nwwt->dock = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_TOOLBAR) {
+        DBG( "NET_WM_WINDOW_TYPE_TOOLBAR ");
+        nwwt->toolbar = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_MENU) {
+        DBG( "NET_WM_WINDOW_TYPE_MENU ");
+        nwwt->menu = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_UTILITY) {
+        DBG( "NET_WM_WINDOW_TYPE_UTILITY ");
+        nwwt->utility = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_SPLASH) {
+        DBG( "NET_WM_WINDOW_TYPE_SPLASH ");
+        nwwt->splash = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_DIALOG) {
+        DBG( "NET_WM_WINDOW_TYPE_DIALOG ");
+        nwwt->dialog = 1;
+    } else if (type == a_NET_WM_WINDOW_TYPE_NORMAL) {
+        DBG( "NET_WM_WINDOW_TYPE_NORMAL ");
+        nwwt->normal = 1;
+    } else {
+        DBG( "... ");
+    }
+}
+
 void
 get_net_wm_window_type(Window win, NetWMWindowType *nwwt)
 {
@@ -748,35 +794,8 @@ get_net_wm_window_type(Window win, NetWMWindowType *nwwt)
         RET();
 
     DBG( "%x: netwm state = { ", (unsigned int)win);
-    while (--num3 >= 0) {
-        if (state[num3] == a_NET_WM_WINDOW_TYPE_DESKTOP) {
-            DBG("NET_WM_WINDOW_TYPE_DESKTOP ");
-            nwwt->desktop = 1;
-        } else if (state[num3] == a_NET_WM_WINDOW_TYPE_DOCK) {
-            DBG( "NET_WM_WINDOW_TYPE_DOCK ");
-        nwwt->dock = 1;
-    } else if (state[num3] == a_NET_WM_WINDOW_TYPE_TOOLBAR) {
-            DBG( "NET_WM_WINDOW_TYPE_TOOLBAR ");
-        nwwt->toolbar = 1;
-        } else if (state[num3] == a_NET_WM_WINDOW_TYPE_MENU) {
-            DBG( "NET_WM_WINDOW_TYPE_MENU ");
-            nwwt->menu = 1;
-    } else if (state[num3] == a_NET_WM_WINDOW_TYPE_UTILITY) {
-            DBG( "NET_WM_WINDOW_TYPE_UTILITY ");
-            nwwt->utility = 1;
-    } else if (state[num3] == a_NET_WM_WINDOW_TYPE_SPLASH) {
-            DBG( "NET_WM_WINDOW_TYPE_SPLASH ");
-            nwwt->splash = 1;
-    } else if (state[num3] == a_NET_WM_WINDOW_TYPE_DIALOG) {
-            DBG( "NET_WM_WINDOW_TYPE_DIALOG ");
-            nwwt->dialog = 1;
-    } else if (state[num3] == a_NET_WM_WINDOW_TYPE_NORMAL) {
-            DBG( "NET_WM_WINDOW_TYPE_NORMAL ");
-            nwwt->normal = 1;
-    } else {
-        DBG( "... ");
-    }
-    }
+    while (--num3 >= 0)
+        net_wm_window_type_add(nwwt, state[num3]);
     XFree(state);
     DBG( "}\n");
     RET();
@@ -797,6 +816,220 @@ get_wm_state (Window win)
     RET(ret);
 }
 
+/* converts class part of WM_CLASS value "res_name\0res_class\0" to UTF-8 */
+static char *
+wm_class_to_utf8(const char *value, gsize len)
+{
+    const char *res_class = memchr(value, '\0', len);
+    char *tmp, *retval;
+
+    if (res_class == NULL || ++res_class >= value + len)
+        return NULL;
+    tmp = g_strndup(res_class, value + len - res_class);
+    retval = g_locale_to_utf8(tmp, -1, NULL, NULL, NULL);
+    g_free(tmp);
+    return retval;
+}
+
+#ifdef HAVE_X11_XCB
+/* properties requested by get_net_wm_client_props(), in order of decoding */
+enum {
+    CLIENT_PROP_NET_WM_STATE,
+    CLIENT_PROP_NET_WM_WINDOW_TYPE,
+    CLIENT_PROP_WM_CLASS,
+    CLIENT_PROP_NET_WM_DESKTOP,
+    CLIENT_PROP_WM_STATE,
+    CLIENT_PROP_WM_HINTS,
+    CLIENT_PROP_NET_WM_VISIBLE_NAME,
+    CLIENT_PROP_NET_WM_NAME,
+    CLIENT_PROP_WM_NAME,
+    N_CLIENT_PROPS
+};
+
+static void
+net_wm_client_props_set(NetWMClientProps *props, int prop,
+                        xcb_get_property_reply_t *reply)
+{
+    void *value = xcb_get_property_value(reply);
+    int len = xcb_get_property_value_length(reply);
+    uint32_t *data = value;
+    XTextProperty text_prop;
+    int i;
+
+    if (reply->type == XCB_NONE || len <= 0)
+        return;
+    switch (prop) {
+    case CLIENT_PROP_NET_WM_STATE:
+        if (reply->format == 32)
+            for (i = len / 4; --i >= 0; )
+                net_wm_state_add(&props->nws, data[i]);
+        break;
+    case CLIENT_PROP_NET_WM_WINDOW_TYPE:
+        if (reply->format == 32)
+            for (i = len / 4; --i >= 0; )
+                net_wm_window_type_add(&props->nwwt, data[i]);
+        break;
+    case CLIENT_PROP_WM_CLASS:
+        if (reply->format == 8)
+            props->res_class = wm_class_to_utf8(value, len);
+        break;
+    case CLIENT_PROP_NET_WM_DESKTOP:
+        if (reply->format == 32)
+            props->desktop = (int)data[0];
+        break;
+    case CLIENT_PROP_WM_STATE:
+        if (reply->format == 32)
+            props->wm_state = data[0];
+        break;
+    case CLIENT_PROP_WM_HINTS:
+        if (reply->format == 32)
+            props->urgency = ((data[0] & XUrgencyHint) != 0);
+        break;
+    case CLIENT_PROP_NET_WM_VISIBLE_NAME:
+    case CLIENT_PROP_NET_WM_NAME:
+        /* names arrive in order of preference, keep the first one */
+        if (props->name == NULL && reply->type == a_UTF8_STRING && reply->format == 8)
+        {
+            props->name = g_strndup(value, len);
+            props->name_source = (prop == CLIENT_PROP_NET_WM_NAME) ? a_NET_WM_NAME
+                                                                   : a_NET_WM_VISIBLE_NAME;
+        }
+        break;
+    case CLIENT_PROP_WM_NAME:
+        if (props->name == NULL)
+        {
+            text_prop.value = value;
+            text_prop.encoding = reply->type;
+            text_prop.format = reply->format;
+            text_prop.nitems = len * 8 / reply->format;
+            props->name = text_property_to_utf8(&text_prop);
+            if (props->name != NULL)
+                props->name_source = XA_WM_NAME;
+        }
+        break;
+    }
+}
+#endif
+
+void
+get_net_wm_client_props(Window *wins, int n, NetWMClientProps *props)
+{
+    int i;
+#ifdef HAVE_X11_XCB
+    xcb_connection_t *c = XGetXCBConnection(GDK_DISPLAY_XDISPLAY(gdk_display_get_default()));
+    xcb_get_property_cookie_t *cookies;
+    xcb_get_property_reply_t *reply;
+    xcb_generic_error_t *error;
+    Atom atoms[N_CLIENT_PROPS], types[N_CLIENT_PROPS];
+    uint32_t lengths[N_CLIENT_PROPS];
+    int k;
+
+    ENTER;
+    atoms[CLIENT_PROP_NET_WM_STATE] = a_NET_WM_STATE;
+    types[CLIENT_PROP_NET_WM_STATE] = XA_ATOM;
+    lengths[CLIENT_PROP_NET_WM_STATE] = G_MAXUINT32;
+    atoms[CLIENT_PROP_NET_WM_WINDOW_TYPE] = a_NET_WM_WINDOW_TYPE;
+    types[CLIENT_PROP_NET_WM_WINDOW_TYPE] = XA_ATOM;
+    lengths[CLIENT_PROP_NET_WM_WINDOW_TYPE] = G_MAXUINT32;
+    atoms[CLIENT_PROP_WM_CLASS] = XA_WM_CLASS;
+    types[CLIENT_PROP_WM_CLASS] = XA_STRING;
+    lengths[CLIENT_PROP_WM_CLASS] = G_MAXUINT32;
+    atoms[CLIENT_PROP_NET_WM_DESKTOP] = a_NET_WM_DESKTOP;
+    types[CLIENT_PROP_NET_WM_DESKTOP] = XA_CARDINAL;
+    lengths[CLIENT_PROP_NET_WM_DESKTOP] = 1;
+    atoms[CLIENT_PROP_WM_STATE] = a_WM_STATE;
+    types[CLIENT_PROP_WM_STATE] = a_WM_STATE;
+    lengths[CLIENT_PROP_WM_STATE] = 2;
+    atoms[CLIENT_PROP_WM_HINTS] = XA_WM_HINTS;
+    types[CLIENT_PROP_WM_HINTS] = XA_WM_HINTS;
+    lengths[CLIENT_PROP_WM_HINTS] = 9; /* NumPropWMHintsElements */
+    atoms[CLIENT_PROP_NET_WM_VISIBLE_NAME] = a_NET_WM_VISIBLE_NAME;
+    types[CLIENT_PROP_NET_WM_VISIBLE_NAME] = a_UTF8_STRING;
+    lengths[CLIENT_PROP_NET_WM_VISIBLE_NAME] = G_MAXUINT32;
+    atoms[CLIENT_PROP_NET_WM_NAME] = a_NET_WM_NAME;
+    types[CLIENT_PROP_NET_WM_NAME] = a_UTF8_STRING;
+    lengths[CLIENT_PROP_NET_WM_NAME] = G_MAXUINT32;
+    atoms[CLIENT_PROP_WM_NAME] = XA_WM_NAME;
+    types[CLIENT_PROP_WM_NAME] = XCB_GET_PROPERTY_TYPE_ANY;
+    lengths[CLIENT_PROP_WM_NAME] = G_MAXUINT32;
+
+    /* send all requests at once, then collect replies: a single round trip */
+    cookies = g_new(xcb_get_property_cookie_t, n * N_CLIENT_PROPS);
+    for (i = 0; i < n; i++)
+        for (k = 0; k < N_CLIENT_PROPS; k++)
+            cookies[i * N_CLIENT_PROPS + k] = xcb_get_property(c, 0, wins[i],
+                                                               atoms[k], types[k],
+                                                               0, lengths[k]);
+    for (i = 0; i < n; i++)
+    {
+        memset(&props[i], 0, sizeof(NetWMClientProps));
+        props[i].win = wins[i];
+        for (k = 0; k < N_CLIENT_PROPS; k++)
+        {
+            error = NULL;
+            reply = xcb_get_property_reply(c, cookies[i * N_CLIENT_PROPS + k], &error);
+            /* window may be already destroyed, that's not an error for us */
+            free(error);
+            if (reply == NULL)
+                continue;
+            net_wm_client_props_set(&props[i], k, reply);
+            free(reply);
+        }
+    }
+    g_free(cookies);
+#else
+    Display *xdisplay = GDK_DISPLAY_XDISPLAY(gdk_display_get_default());
+    XClassHint ch;
+    XWMHints *hints;
+
+    ENTER;
+    for (i = 0; i < n; i++)
+    {
+        memset(&props[i], 0, sizeof(NetWMClientProps));
+        props[i].win = wins[i];
+        get_net_wm_state(wins[i], &props[i].nws);
+        get_net_wm_window_type(wins[i], &props[i].nwwt);
+        ch.res_name = NULL;
+        ch.res_class = NULL;
+        XGetClassHint(xdisplay, wins[i], &ch);
+        if (ch.res_name != NULL)
+            XFree(ch.res_name);
+        if (ch.res_class != NULL)
+        {
+            props[i].res_class = g_locale_to_utf8(ch.res_class, -1, NULL, NULL, NULL);
+            XFree(ch.res_class);
+        }
+        props[i].desktop = get_net_wm_desktop(wins[i]);
+        props[i].wm_state = get_wm_state(wins[i]);
+        hints = get_xaproperty(wins[i], XA_WM_HINTS, XA_WM_HINTS, 0);
+        if (hints != NULL)
+        {
+            props[i].urgency = ((hints->flags & XUrgencyHint) != 0);
+            XFree(hints);
+        }
+        if ((props[i].name = get_utf8_property(wins[i], a_NET_WM_VISIBLE_NAME)) != NULL)
+            props[i].name_source = a_NET_WM_VISIBLE_NAME;
+        else if ((props[i].name = get_utf8_property(wins[i], a_NET_WM_NAME)) != NULL)
+            props[i].name_source = a_NET_WM_NAME;
+        else if ((props[i].name = get_textproperty(wins[i], XA_WM_NAME)) != NULL)
+            props[i].name_source = XA_WM_NAME;
+    }
+#endif
+    RET();
+}
+
+void
+free_net_wm_client_props(NetWMClientProps *props, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        g_free(props[i].res_class);
+        g_free(props[i].name);
+    }
+}
+
 int panel_handle_x_error(Display * d, XErrorEvent * ev)
 {
     char buf[256];
@@ -1068,7 +1301,7 @@ static void _gtk_image_set_from_file_scaled(GtkWidget * img, ImgData * data)
 
         if (fallback == NULL)
             fallback = "application-x-executable";
-        data->pixbuf = fm_pixbuf_from_icon_with_fallback(data->icon, size, fallback);
+        data->pixbuf = lxpanel_icon_cache_load(data->icon, size, fallback);
     }
     else
     {
@@ -1436,15 +1669,15 @@ void show_error( GtkWindow* parent_win, const char* msg )
     fm_show_error(parent_win, NULL, msg);
 }
 
-/* old plugins compatibility mode, use fm_pixbuf_from_icon_with_fallback() instead */
+/* old plugins compatibility mode, use lxpanel_icon_cache_load() instead */
 GdkPixbuf * lxpanel_load_icon(const char * name, int width, int height, gboolean use_fallback)
 {
     FmIcon * fm_icon;
     GdkPixbuf * icon = NULL;
 
     fm_icon = fm_icon_from_name(name ? name : "application-x-executable");
-    /* well, we don't use parameter width and not really use cache here */
-    icon = fm_pixbuf_from_icon_with_fallback(fm_icon, height,
+    /* well, we don't use parameter width */
+    icon = lxpanel_icon_cache_load(fm_icon, height,
                             use_fallback ? "application-x-executable" : NULL);
     g_object_unref(fm_icon);
     return icon;
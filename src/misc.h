@@ -117,6 +117,19 @@ typedef struct {
     unsigned int normal : 1;
 } NetWMWindowType;
 
+/* Properties of a client window which taskbar needs. */
+typedef struct {
+    Window win;
+    NetWMState nws;             /* _NET_WM_STATE */
+    NetWMWindowType nwwt;       /* _NET_WM_WINDOW_TYPE */
+    char *res_class;            /* class from WM_CLASS, in UTF-8 */
+    int desktop;                /* _NET_WM_DESKTOP */
+    int wm_state;               /* WM_STATE */
+    unsigned int urgency : 1;   /* XUrgencyHint is set in WM_HINTS */
+    char *name;                 /* window title, in UTF-8 */
+    Atom name_source;           /* property the title was taken from */
+} NetWMClientProps;
+
 void Xclimsgx(Screen *screen, Window win, Atom type, long l0, long l1, long l2, long l3, long l4);
 void Xclimsgwm(Window win, Atom type, Atom arg);
 void *get_xaproperty (Window win, Atom prop, Atom type, int *nitems);
@@ -133,6 +146,10 @@ int get_wm_state (Window win);
 void get_net_wm_state(Window win, NetWMState *nws);
 void get_net_wm_window_type(Window win, NetWMWindowType *nwwt);
 GPid get_net_wm_pid(Window win);
+/* fetches properties of @n windows in a single round trip if possible */
+void get_net_wm_client_props(Window *wins, int n, NetWMClientProps *props);
+/* frees data in @props but not the array itself */
+void free_net_wm_client_props(NetWMClientProps *props, int n);
 
 /**
  * panel_handle_x_error
@@ -1677,8 +1677,8 @@ panel_start_gui(LXPanel *panel, config_setting_t *list)
     ENTER;
 
     g_debug("panel_start_gui on '%s'", p->name);
-    p->curdesk = get_net_current_desktop();
-    p->desknum = get_net_number_of_desktops();
+    p->curdesk = fb_ev_current_desktop(fbev);
+    p->desknum = fb_ev_number_of_desktops(fbev);
     //p->workarea = get_xaproperty (GDK_ROOT_WINDOW(), a_NET_WORKAREA, XA_CARDINAL, &p->wa_len);
     p->ax = p->ay = p->aw = p->ah = 0;
 
@@ -375,6 +375,38 @@ extern gboolean lxpanel_apply_hotkey(char **hkptr, const char *keystring,
  */
 extern guint panel_config_click_parse(const char *keystring, GdkModifierType *mods);
 
+/**
+ * lxpanel_timer_add
+ * @widget: (allow-none): widget which is updated by @func
+ * @interval: interval between calls, in milliseconds
+ * @func: function to call
+ * @user_data: data to pass to @func
+ *
+ * Adds periodic timer. All timers of the panel share a single source,
+ * their calls are aligned to common ticks and may happen a bit earlier
+ * if some other timer fires anyway, so the panel wakes up as rarely as
+ * possible. If @widget is not %NULL then calls are paused while it is
+ * not visible, for example while the panel is hidden, and @func is
+ * called as soon as @widget is shown again. If @func returns %FALSE
+ * then the timer is removed.
+ *
+ * Returns: id to use with lxpanel_timer_remove().
+ *
+ * Since: 0.11.2
+ */
+extern guint lxpanel_timer_add(GtkWidget *widget, guint interval, GSourceFunc func,
+                               gpointer user_data);
+
+/**
+ * lxpanel_timer_remove
+ * @id: value returned by lxpanel_timer_add()
+ *
+ * Removes the timer.
+ *
+ * Since: 0.11.2
+ */
+extern void lxpanel_timer_remove(guint id);
+
 /* Add/remove plugin to/from panel */
 GtkWidget *lxpanel_add_plugin(LXPanel *p, const char *name, config_setting_t *cfg, gint at);
 void lxpanel_remove_plugin(LXPanel *p, GtkWidget *plugin);
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "proc-net-dev.h"
+
+/* file to read, test/proc-net-dev-check.c points it to a fixture */
+#ifndef PROC_NET_DEV_PATH
+#define PROC_NET_DEV_PATH "/proc/net/dev"
+#endif
+
+/* positions of counters in lines after the interface name */
+typedef struct
+{
+    int rx_bytes, rx_packets, tx_bytes, tx_packets;
+    int n_fields;
+} NetDevLayout;
+
+typedef struct
+{
+    LXPanelNetDev dev;
+    gboolean seen;              /* found in the last snapshot */
+} NetDevEntry;
+
+static int dev_fd = -1;
+static char *buffer = NULL;
+static gsize buffer_size = 0;
+static char *header = NULL;     /* header of the last read file */
+static NetDevLayout layout = { -1, -1, -1, -1, 0 };
+static GPtrArray *devs = NULL;  /* entries in file order */
+static GHashTable *devs_index = NULL; /* name -> entry */
+static gint64 last_update = 0;
+static gboolean last_ok = FALSE;
+
+/* Find columns of counters in the 2nd header line which looks like
+   "face |bytes packets errs ...|bytes packets errs ..." */
+static void parse_header(const char *p, const char *end)
+{
+    int i = 0;
+    gboolean tx = FALSE;
+
+    layout.rx_bytes = layout.rx_packets = layout.tx_bytes = layout.tx_packets = -1;
+    /* skip the "face" column */
+    p = memchr(p, '|', end - p);
+    if (p == NULL)
+        return;
+    while (p < end)
+    {
+        const char *word;
+
+        if (*p == '|')
+        {
+            tx = (i > 0);
+            p++;
+            continue;
+        }
+        if (*p == ' ' || *p == '\t')
+        {
+            p++;
+            continue;
+        }
+        word = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '|')
+            p++;
+        if (p - word == 5 && memcmp(word, "bytes", 5) == 0)
+        {
+            if (tx) layout.tx_bytes = i;
+            else layout.rx_bytes = i;
+        }
+        else if (p - word == 7 && memcmp(word, "packets", 7) == 0)
+        {
+            if (tx) layout.tx_packets = i;
+            else layout.rx_packets = i;
+        }
+        i++;
+    }
+    layout.n_fields = i;
+}
+
+/* Read the whole file into buffer, returns length or -1 on error */
+static gssize read_file(void)
+{
+    gsize len = 0;
+    gssize r;
+
+    if (dev_fd < 0)
+    {
+        dev_fd = open(PROC_NET_DEV_PATH, O_RDONLY | O_CLOEXEC);
+        if (dev_fd < 0)
+            return -1;
+    }
+    if (buffer == NULL)
+    {
+        buffer_size = 4096;
+        buffer = g_malloc(buffer_size);
+    }
+    if (lseek(dev_fd, 0, SEEK_SET) < 0)
+        goto _error;
+    for (;;)
+    {
+        if (len + 1 >= buffer_size)
+        {
+            buffer_size *= 2;
+            buffer = g_realloc(buffer, buffer_size);
+        }
+        r = read(dev_fd, buffer + len, buffer_size - len - 1);
+        if (r < 0)
+            goto _error;
+        if (r == 0)
+            break;
+        len += r;
+    }
+    buffer[len] = '\0';
+    return len;
+
+_error:
+    close(dev_fd);
+    dev_fd = -1;
+    return -1;
+}
+
+static gboolean update_snapshot(void)
+{
+    const char *p, *end, *line_end, *name, *name_end;
+    gint64 now = g_get_monotonic_time();
+    NetDevEntry *entry;
+    gssize len;
+    guint i;
+    int field;
+
+    len = read_file();
+    if (len < 0)
+        return FALSE;
+    p = buffer;
+    end = buffer + len;
+
+    /* skip the first header line and check if the second one changed */
+    p = memchr(p, '\n', end - p);
+    if (p == NULL)
+        return FALSE;
+    p++;
+    line_end = memchr(p, '\n', end - p);
+    if (line_end == NULL)
+        return FALSE;
+    if (header == NULL || strlen(header) != (gsize)(line_end - p) ||
+        memcmp(header, p, line_end - p) != 0)
+    {
+        g_free(header);
+        header = g_strndup(p, line_end - p);
+        parse_header(p, line_end);
+    }
+    if (layout.rx_bytes < 0 || layout.rx_packets < 0 ||
+        layout.tx_bytes < 0 || layout.tx_packets < 0)
+        return FALSE;
+
+    if (devs == NULL)
+    {
+        devs = g_ptr_array_new();
+        devs_index = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+    for (i = 0; i < devs->len; i++)
+        ((NetDevEntry *)g_ptr_array_index(devs, i))->seen = FALSE;
+    g_ptr_array_set_size(devs, 0);
+
+    for (p = line_end + 1; p < end; p = line_end + 1)
+    {
+        guint64 values[4] = { 0, 0, 0, 0 };
+
+        line_end = memchr(p, '\n', end - p);
+        if (line_end == NULL)
+            line_end = end;
+        /* interface name is padded with spaces and ends with a colon */
+        while (p < line_end && *p == ' ')
+            p++;
+        name = p;
+        name_end = memchr(p, ':', line_end - p);
+        if (name_end == NULL)
+            continue;
+        /* counters are in the same order as columns of the header */
+        for (p = name_end + 1, field = 0; p < line_end && field < layout.n_fields; field++)
+        {
+            guint64 v = 0;
+
+            while (p < line_end && *p == ' ')
+                p++;
+            while (p < line_end && *p >= '0' && *p <= '9')
+                v = v * 10 + (guint64)(*p++ - '0');
+            if (field == layout.rx_bytes)
+                values[0] = v;
+            else if (field == layout.rx_packets)
+                values[1] = v;
+            else if (field == layout.tx_bytes)
+                values[2] = v;
+            else if (field == layout.tx_packets)
+                values[3] = v;
+        }
+
+        /* lookup by name without allocation */
+        {
+            char key[64];
+            gsize key_len = MIN((gsize)(name_end - name), sizeof(key) - 1);
+
+            memcpy(key, name, key_len);
+            key[key_len] = '\0';
+            entry = g_hash_table_lookup(devs_index, key);
+            if (entry == NULL)
+            {
+                entry = g_slice_new0(NetDevEntry);
+                entry->dev.name = g_strdup(key);
+                g_hash_table_insert(devs_index, entry->dev.name, entry);
+            }
+        }
+        entry->dev.rx_bytes = values[0];
+        entry->dev.rx_packets = values[1];
+        entry->dev.tx_bytes = values[2];
+        entry->dev.tx_packets = values[3];
+        if (!entry->seen)
+        {
+            entry->seen = TRUE;
+            g_ptr_array_add(devs, entry);
+        }
+    }
+
+    /* drop interfaces which are gone */
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init(&iter, devs_index);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+        {
+            entry = value;
+            if (entry->seen)
+                continue;
+            g_hash_table_iter_remove(&iter);
+            g_free(entry->dev.name);
+            g_slice_free(NetDevEntry, entry);
+        }
+    }
+
+    last_update = now;
+    return TRUE;
+}
+
+static gboolean net_dev_refresh(guint max_age)
+{
+    gint64 now = g_get_monotonic_time();
+
+    if (last_update == 0 || now - last_update >= (gint64)max_age * 1000)
+        last_ok = update_snapshot();
+    return last_ok;
+}
+
+const LXPanelNetDev * const *lxpanel_net_dev_list(guint max_age, guint *n_devs)
+{
+    if (!net_dev_refresh(max_age))
+    {
+        *n_devs = 0;
+        return NULL;
+    }
+    *n_devs = devs->len;
+    /* LXPanelNetDev is the first member of NetDevEntry */
+    return (const LXPanelNetDev * const *)devs->pdata;
+}
+
+const LXPanelNetDev *lxpanel_net_dev_get(const char *name, guint max_age)
+{
+    NetDevEntry *entry;
+
+    g_return_val_if_fail(name != NULL, NULL);
+    if (!net_dev_refresh(max_age))
+        return NULL;
+    entry = g_hash_table_lookup(devs_index, name);
+    return entry ? &entry->dev : NULL;
+}
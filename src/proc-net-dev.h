@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PROC_NET_DEV_H__
+#define __PROC_NET_DEV_H__ 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* counters of one interface from /proc/net/dev */
+typedef struct
+{
+    char *name;
+    guint64 rx_bytes, rx_packets, tx_bytes, tx_packets;
+} LXPanelNetDev;
+
+/**
+ * lxpanel_net_dev_list
+ * @max_age: how old the snapshot may be, in milliseconds
+ * @n_devs: (out): location to store number of interfaces
+ *
+ * Retrieves all interfaces in order they are listed in /proc/net/dev.
+ * The file is read again only if the last snapshot is older than
+ * @max_age so all consumers polling with similar interval share the
+ * same snapshot. Returned data are owned by the service and are valid
+ * until the next call to lxpanel_net_dev_list() or lxpanel_net_dev_get().
+ *
+ * Returns: (transfer none): array of interfaces or %NULL if the file
+ * cannot be read.
+ */
+extern const LXPanelNetDev * const *lxpanel_net_dev_list(guint max_age, guint *n_devs);
+
+/**
+ * lxpanel_net_dev_get
+ * @name: interface name
+ * @max_age: how old the snapshot may be, in milliseconds
+ *
+ * Retrieves counters of the interface @name. See lxpanel_net_dev_list()
+ * for details.
+ *
+ * Returns: (transfer none): the interface data or %NULL if not found.
+ */
+extern const LXPanelNetDev *lxpanel_net_dev_get(const char *name, guint max_age);
+
+G_END_DECLS
+
+#endif
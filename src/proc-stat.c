@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "proc-stat.h"
+#include "plugin.h"
+
+/* file to sample, test/proc-stat-check.c points it to a fixture */
+#ifndef PROC_STAT_PATH
+#define PROC_STAT_PATH "/proc/stat"
+#endif
+
+/* number of recent samples kept */
+#define PROC_STAT_HISTORY 16
+
+/* the "cpu" lines are at start of the file so there is no need to read
+   the whole file which may be large due to "intr" line; the buffer grows
+   if all of them don't fit */
+#define PROC_STAT_READ_SIZE 4096
+
+/* a sample not older than this is reused by subscribers called in the
+   same wakeup of the panel timer, in microseconds */
+#define PROC_STAT_REUSE_AGE 100000
+
+typedef struct
+{
+    guint id;
+    guint timer;                /* lxpanel_timer_add() id */
+    LXPanelProcStatFunc func;
+    gpointer user_data;
+} ProcStatSubscriber;
+
+static int stat_fd = -1;
+static char *stat_buf = NULL;
+static gsize stat_buf_size = 0;
+static LXPanelProcStat history[PROC_STAT_HISTORY];
+static guint history_cores_alloc[PROC_STAT_HISTORY]; /* allocated cores */
+static guint history_head = 0;  /* index of the newest sample */
+static guint history_len = 0;
+static GSList *subscribers = NULL;
+static guint last_id = 0;
+
+/* Parse decimal number, skipping spaces before it. */
+static const char *parse_u64(const char *p, const char *end, guint64 *value)
+{
+    guint64 v = 0;
+
+    while (p < end && *p == ' ')
+        p++;
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (guint64)(*p++ - '0');
+    *value = v;
+    return p;
+}
+
+/* Parse values of "cpu" line, older kernels may have less than 8 values. */
+static gboolean parse_cpu_times(const char *p, const char *end, LXPanelCpuTimes *times)
+{
+    guint64 v[8] = { 0 };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(v); i++)
+    {
+        const char *next = parse_u64(p, end, &v[i]);
+        if (next == NULL)
+            break;
+        p = next;
+    }
+    if (i < 4)
+        return FALSE;
+    times->user = v[0];
+    times->nice = v[1];
+    times->system = v[2];
+    times->idle = v[3];
+    times->iowait = v[4];
+    times->irq = v[5];
+    times->softirq = v[6];
+    times->steal = v[7];
+    return TRUE;
+}
+
+/* Read all "cpu" lines of the file into stat_buf, returns length of data. */
+static gssize proc_stat_read(void)
+{
+    gssize len;
+    const char *p;
+
+    if (stat_buf == NULL)
+    {
+        stat_buf_size = PROC_STAT_READ_SIZE;
+        stat_buf = g_malloc(stat_buf_size);
+    }
+    for (;;)
+    {
+        len = pread(stat_fd, stat_buf, stat_buf_size, 0);
+        if (len <= 0 || (gsize)len < stat_buf_size)
+            return len;
+        /* buffer is full, check if there is any line after the "cpu" ones */
+        for (p = stat_buf; p; )
+        {
+            p = memchr(p, '\n', stat_buf + len - p);
+            if (p == NULL || ++p == stat_buf + len)
+                break;
+            if (strncmp(p, "cpu", MIN(3, stat_buf + len - p)) != 0)
+                return len;
+        }
+        stat_buf_size *= 2;
+        stat_buf = g_realloc(stat_buf, stat_buf_size);
+    }
+}
+
+/* Read the file and add new sample to history. */
+static gboolean proc_stat_sample(void)
+{
+    LXPanelProcStat *sample;
+    const char *p, *end, *eol;
+    guint next, n_cores = 0;
+    guint64 cpu;
+    gssize len;
+
+    if (stat_fd < 0)
+    {
+        stat_fd = open(PROC_STAT_PATH, O_RDONLY | O_CLOEXEC);
+        if (stat_fd < 0)
+            return FALSE;
+    }
+    len = proc_stat_read();
+    if (len <= 0)
+    {
+        close(stat_fd);
+        stat_fd = -1;
+        return FALSE;
+    }
+    if (len < 4 || memcmp(stat_buf, "cpu ", 4) != 0)
+        return FALSE;
+    next = (history_head + 1) % PROC_STAT_HISTORY;
+    sample = &history[next];
+    end = stat_buf + len;
+    eol = memchr(stat_buf, '\n', len);
+    if (eol == NULL)
+        eol = end;
+    if (!parse_cpu_times(stat_buf + 4, eol, &sample->cpu))
+        return FALSE;
+    if (sample->cores)
+        memset(sample->cores, 0, history_cores_alloc[next] * sizeof(LXPanelCpuTimes));
+    /* "cpuN" lines follow the summary, some N may be missing if the CPU
+       is offline so the number is taken from the line itself */
+    for (p = eol; p < end && end - p > 4 && memcmp(p, "\ncpu", 4) == 0; p = eol)
+    {
+        p += 4;
+        eol = memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        p = parse_u64(p, eol, &cpu);
+        if (p == NULL || cpu >= G_MAXUINT16)
+            break;
+        if (cpu >= history_cores_alloc[next])
+        {
+            guint n_alloc = MAX((guint)cpu + 1, history_cores_alloc[next] * 2);
+            sample->cores = g_renew(LXPanelCpuTimes, sample->cores, n_alloc);
+            memset(&sample->cores[history_cores_alloc[next]], 0,
+                   (n_alloc - history_cores_alloc[next]) * sizeof(LXPanelCpuTimes));
+            history_cores_alloc[next] = n_alloc;
+        }
+        if (!parse_cpu_times(p, eol, &sample->cores[cpu]))
+            break;
+        n_cores = MAX(n_cores, (guint)cpu + 1);
+    }
+    sample->n_cores = n_cores;
+    sample->time = g_get_monotonic_time();
+    history_head = next;
+    if (history_len < PROC_STAT_HISTORY)
+        history_len++;
+    return TRUE;
+}
+
+/* Free everything when the last subscriber is gone. */
+static void proc_stat_free(void)
+{
+    if (stat_fd >= 0)
+        close(stat_fd);
+    stat_fd = -1;
+    g_free(stat_buf);
+    stat_buf = NULL;
+    for (history_len = 0; history_len < PROC_STAT_HISTORY; history_len++)
+    {
+        g_free(history[history_len].cores);
+        history[history_len].cores = NULL;
+        history[history_len].n_cores = 0;
+        history_cores_alloc[history_len] = 0;
+    }
+    history_len = 0;
+}
+
+/* Timer of one subscriber. Timers of all subscribers are coalesced by
+   the panel so ones due at the same time share one sample, and they are
+   paused while widgets of subscribers are hidden. */
+static gboolean proc_stat_timer(gpointer data)
+{
+    ProcStatSubscriber *sub = data;
+
+    if (history_len == 0 ||
+        g_get_monotonic_time() - history[history_head].time >= PROC_STAT_REUSE_AGE)
+        proc_stat_sample();
+    /* sub may be freed by the callback */
+    if (sub->func && history_len > 0)
+        sub->func(&history[history_head], sub->user_data);
+    return TRUE;
+}
+
+guint lxpanel_proc_stat_subscribe(GtkWidget *widget, guint interval,
+                                  LXPanelProcStatFunc func, gpointer user_data)
+{
+    ProcStatSubscriber *sub = g_slice_new(ProcStatSubscriber);
+
+    sub->id = ++last_id;
+    sub->func = func;
+    sub->user_data = user_data;
+    sub->timer = lxpanel_timer_add(widget, interval, proc_stat_timer, sub);
+    subscribers = g_slist_prepend(subscribers, sub);
+    /* make the first sample available immediately */
+    if (history_len == 0)
+        proc_stat_sample();
+    return sub->id;
+}
+
+void lxpanel_proc_stat_unsubscribe(guint id)
+{
+    ProcStatSubscriber *sub;
+    GSList *l;
+
+    for (l = subscribers; l; l = l->next)
+    {
+        sub = l->data;
+        if (sub->id != id)
+            continue;
+        /* the panel timer is safe to remove from its own callback */
+        lxpanel_timer_remove(sub->timer);
+        subscribers = g_slist_delete_link(subscribers, l);
+        g_slice_free(ProcStatSubscriber, sub);
+        if (subscribers == NULL)
+            proc_stat_free();
+        return;
+    }
+}
+
+const LXPanelProcStat *lxpanel_proc_stat_get(guint age)
+{
+    if (age >= history_len)
+        return NULL;
+    return &history[(history_head + PROC_STAT_HISTORY - age) % PROC_STAT_HISTORY];
+}
+
+gfloat lxpanel_cpu_times_load(const LXPanelCpuTimes *cur,
+                              const LXPanelCpuTimes *prev, LXPanelCpuLoad *load)
+{
+    guint64 user, system, iowait, steal, total;
+
+    /* counters may go back if CPU was offlined so use 0 in such case */
+#define CPU_DELTA(f) (cur->f > prev->f ? cur->f - prev->f : 0)
+    user = CPU_DELTA(user) + CPU_DELTA(nice);
+    system = CPU_DELTA(system) + CPU_DELTA(irq) + CPU_DELTA(softirq);
+    iowait = CPU_DELTA(iowait);
+    steal = CPU_DELTA(steal);
+    total = user + system + iowait + steal + CPU_DELTA(idle);
+#undef CPU_DELTA
+    if (total == 0)
+    {
+        memset(load, 0, sizeof(LXPanelCpuLoad));
+        return 0.0;
+    }
+    load->user = (gfloat)user / total;
+    load->system = (gfloat)system / total;
+    load->iowait = (gfloat)iowait / total;
+    load->steal = (gfloat)steal / total;
+    return load->user + load->system + load->steal;
+}
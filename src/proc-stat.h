@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PROC_STAT_H__
+#define __PROC_STAT_H__ 1
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* CPU time counters from /proc/stat, in USER_HZ ticks */
+typedef struct
+{
+    guint64 user, nice, system, idle, iowait, irq, softirq, steal;
+} LXPanelCpuTimes;
+
+/* one sample of /proc/stat */
+typedef struct
+{
+    gint64 time;                /* g_get_monotonic_time() of the sample */
+    LXPanelCpuTimes cpu;        /* summary for all CPUs */
+    guint n_cores;              /* number of elements in cores */
+    LXPanelCpuTimes *cores;     /* per CPU counters indexed by CPU number,
+                                   offline CPUs have all counters zero */
+} LXPanelProcStat;
+
+/* fractions of time spent between two samples, in range 0.0...1.0 */
+typedef struct
+{
+    gfloat user;                /* user and nice */
+    gfloat system;              /* system, irq and softirq */
+    gfloat iowait;
+    gfloat steal;
+} LXPanelCpuLoad;
+
+typedef void (*LXPanelProcStatFunc)(const LXPanelProcStat *stat, gpointer user_data);
+
+/**
+ * lxpanel_proc_stat_subscribe
+ * @widget: (allow-none): widget which shows the samples
+ * @interval: requested sampling interval, in milliseconds
+ * @func: (allow-none): function to call with new samples
+ * @user_data: data to pass to @func
+ *
+ * Registers a consumer of /proc/stat samples. The file is sampled when
+ * any of consumers is due, consumers which are due at the same time share
+ * one sample. If @func is not %NULL then it is called with the newest
+ * sample each time @interval passes. Since other consumers may sample
+ * the file in between, a consumer which calculates load should keep
+ * counters of the sample it got last time and compare the new sample
+ * with them, instead of taking two recent samples from the history. If
+ * @widget is not %NULL then the consumer is paused while @widget is
+ * not visible, so the file is not read at all while the panel is
+ * hidden. See lxpanel_timer_add() for details.
+ *
+ * Returns: id to use with lxpanel_proc_stat_unsubscribe().
+ */
+extern guint lxpanel_proc_stat_subscribe(GtkWidget *widget, guint interval,
+                                         LXPanelProcStatFunc func, gpointer user_data);
+
+/**
+ * lxpanel_proc_stat_unsubscribe
+ * @id: value returned by lxpanel_proc_stat_subscribe()
+ *
+ * Removes the consumer. The file is closed when no consumers left.
+ */
+extern void lxpanel_proc_stat_unsubscribe(guint id);
+
+/**
+ * lxpanel_proc_stat_get
+ * @age: 0 for the newest sample, 1 for one before it, and so on
+ *
+ * Retrieves a sample from history of recent samples. Returned data are
+ * owned by the service and may be overwritten by the next sample.
+ * Samples are taken on demand of all consumers, so time between two of
+ * them is arbitrary, see lxpanel_proc_stat_subscribe().
+ *
+ * Returns: (transfer none): the sample or %NULL if it is not available.
+ */
+extern const LXPanelProcStat *lxpanel_proc_stat_get(guint age);
+
+/**
+ * lxpanel_cpu_times_load
+ * @cur: newer counters
+ * @prev: older counters
+ * @load: (out): location to save result
+ *
+ * Calculates how time was spent between two samples of the same CPU or
+ * of the summary. If counters didn't change (e.g. CPU is offline) then
+ * all fractions are set to zero.
+ *
+ * Returns: fraction of time the CPU was busy, i.e. excluding iowait.
+ */
+extern gfloat lxpanel_cpu_times_load(const LXPanelCpuTimes *cur,
+                                     const LXPanelCpuTimes *prev,
+                                     LXPanelCpuLoad *load);
+
+G_END_DECLS
+
+#endif
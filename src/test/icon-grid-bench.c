@@ -0,0 +1,124 @@
+// gcc -O2 -I.. -I../.. icon-grid-bench.c ../icon-grid.c -o icon-grid-bench `pkg-config --cflags --libs gtk+-2.0`
+// (src/panel.h is generated by configure, run it first)
+
+/*
+ * Stress benchmark for PanelIconGrid: adds and removes 1000 children one
+ * by one, running the layout after each change, then hit-tests the grid
+ * as drag-and-drop does.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gtk/gtk.h>
+
+#include "icon-grid.h"
+#include "panel.h"
+
+#define N_CHILDREN 1000
+#define N_HITS 100000
+#define PANEL_HEIGHT 100
+#define CHILD_SIZE 24
+
+/* icon-grid.c asks the toplevel for panel height, let the window be one */
+GType lxpanel_get_type(void)
+{
+    return GTK_TYPE_WINDOW;
+}
+
+gint panel_get_height(LXPanel *panel)
+{
+    return PANEL_HEIGHT;
+}
+
+/* run pending resizes, that is, the layout */
+static void relayout(void)
+{
+    while (gtk_events_pending())
+        gtk_main_iteration_do(FALSE);
+}
+
+static void report(const char *what, gint64 start, int n)
+{
+    gint64 us = g_get_monotonic_time() - start;
+
+    printf("%-28s %9.3f ms total %8.2f us each\n", what, us / 1000.0, (double)us / n);
+}
+
+int main(int argc, char *argv[])
+{
+    GtkWidget *window, *grid, *child, *children[N_CHILDREN];
+    GtkAllocation alloc;
+    PanelIconGridDropPosition pos;
+    gint64 start;
+    int i, found = 0;
+
+    gtk_init(&argc, &argv);
+    window = gtk_offscreen_window_new();
+    grid = panel_icon_grid_new(GTK_ORIENTATION_HORIZONTAL, CHILD_SIZE, CHILD_SIZE,
+                               2, 0, PANEL_HEIGHT);
+    gtk_container_add(GTK_CONTAINER(window), grid);
+    gtk_widget_show_all(window);
+    relayout();
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < N_CHILDREN; i++)
+    {
+        children[i] = gtk_event_box_new();
+        gtk_widget_set_size_request(children[i], CHILD_SIZE, CHILD_SIZE);
+        gtk_widget_show(children[i]);
+        gtk_container_add(GTK_CONTAINER(grid), children[i]);
+        relayout();
+    }
+    report("add + layout", start, N_CHILDREN);
+
+    /* as if tasks change visibility on desktop switch */
+    start = g_get_monotonic_time();
+    for (i = N_CHILDREN - 1; i >= 0; i -= 2)
+    {
+        gtk_widget_hide(children[i]);
+        relayout();
+        gtk_widget_show(children[i]);
+        relayout();
+    }
+    report("hide + show + layout", start, N_CHILDREN);
+
+    gtk_widget_get_allocation(grid, &alloc);
+    start = g_get_monotonic_time();
+    for (i = 0; i < N_HITS; i++)
+        if (panel_icon_grid_get_dest_at_pos(PANEL_ICON_GRID(grid),
+                                            rand() % MAX(alloc.width, 1),
+                                            rand() % MAX(alloc.height, 1),
+                                            &child, &pos) && child != NULL)
+            found++;
+    report("get_dest_at_pos", start, N_HITS);
+    if (found == 0)
+        printf("warning: no child was hit, grid is %dx%d\n", alloc.width, alloc.height);
+
+    /* remove from the middle, the worst case for reusing placement */
+    start = g_get_monotonic_time();
+    for (i = 0; i < N_CHILDREN; i++)
+    {
+        gtk_widget_destroy(children[(i * 7 + N_CHILDREN / 2) % N_CHILDREN]);
+        relayout();
+    }
+    report("remove + layout", start, N_CHILDREN);
+
+    gtk_widget_destroy(window);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// gcc -I.. -I../.. -DPROC_NET_DEV_PATH='"/tmp/proc-net-dev-check"' proc-net-dev-check.c ../proc-net-dev.c -o proc-net-dev-check `pkg-config --cflags --libs glib-2.0`
+
+/*
+ * Check for the shared /proc/net/dev reader: it reads a fixture written
+ * to PROC_NET_DEV_PATH instead of the real file.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "proc-net-dev.h"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failed++; } } while (0)
+
+#define HEADER \
+    "Inter-|   Receive                                                |  Transmit\n" \
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+
+static void write_fixture(const char *data)
+{
+    FILE *f = fopen(PROC_NET_DEV_PATH, "w");
+
+    fputs(data, f);
+    fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    const LXPanelNetDev * const *list;
+    const LXPanelNetDev *dev;
+    guint n;
+
+    write_fixture(HEADER
+                  "    lo:    1000      10    0    0    0     0          0         0     1000      10    0    0    0     0       0          0\n"
+                  "  eth0: 18446744073709551615 200 0 0 0 0 0 0 4000 300 0 0 0 0 0 0\n");
+    list = lxpanel_net_dev_list(0, &n);
+    CHECK(list != NULL && n == 2);
+    if (list == NULL || n != 2)
+        return 1;
+    CHECK(strcmp(list[0]->name, "lo") == 0 && list[0]->rx_bytes == 1000);
+    CHECK(strcmp(list[1]->name, "eth0") == 0 && list[1]->rx_bytes == G_MAXUINT64);
+    CHECK(list[1]->tx_bytes == 4000 && list[1]->tx_packets == 300);
+
+    /* a recent snapshot is reused, an expired one is not */
+    write_fixture(HEADER
+                  "  eth0:    5000     500    0    0    0     0          0         0     6000     600    0    0    0     0       0          0\n");
+    dev = lxpanel_net_dev_get("eth0", 60000);
+    CHECK(dev != NULL && dev->rx_packets == 200);
+    dev = lxpanel_net_dev_get("eth0", 0);
+    CHECK(dev != NULL && dev->rx_bytes == 5000);
+    CHECK(lxpanel_net_dev_get("lo", 0) == NULL);
+
+    /* columns are found by the header, not by position */
+    write_fixture("Inter-|   Receive       |  Transmit\n"
+                  " face |packets    bytes|packets    bytes\n"
+                  "  eth0: 11 22 33 44\n");
+    dev = lxpanel_net_dev_get("eth0", 0);
+    CHECK(dev != NULL && dev->rx_packets == 11 && dev->rx_bytes == 22);
+    CHECK(dev != NULL && dev->tx_packets == 33 && dev->tx_bytes == 44);
+
+    unlink(PROC_NET_DEV_PATH);
+
+    if (failed)
+        return 1;
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+// gcc -I.. -I../.. -DPROC_STAT_PATH='"/tmp/proc-stat-check"' proc-stat-check.c ../proc-stat.c -o proc-stat-check `pkg-config --cflags --libs gtk+-2.0 libfm`
+// (src/panel.h is generated by configure, run it first)
+
+/*
+ * Check for the shared /proc/stat sampler: it reads a fixture written to
+ * PROC_STAT_PATH instead of the real file.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "proc-stat.h"
+#include "plugin.h"
+
+/* the panel timer is replaced, the check fires it by hand */
+static GSourceFunc timer_func;
+static gpointer timer_data;
+
+guint lxpanel_timer_add(GtkWidget *widget, guint interval, GSourceFunc func,
+                        gpointer user_data)
+{
+    timer_func = func;
+    timer_data = user_data;
+    return 1;
+}
+
+void lxpanel_timer_remove(guint id)
+{
+}
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failed++; } } while (0)
+
+static void write_fixture(const char *data)
+{
+    FILE *f = fopen(PROC_STAT_PATH, "w");
+
+    fputs(data, f);
+    fclose(f);
+}
+
+/* fire the timer late enough for a new sample to be taken */
+static void next_sample(void)
+{
+    g_usleep(150000);
+    timer_func(timer_data);
+}
+
+int main(int argc, char *argv[])
+{
+    const LXPanelProcStat *s;
+    LXPanelCpuLoad load;
+    GString *big;
+    gfloat busy;
+    guint id, i;
+
+    /* cpu1 is offline */
+    write_fixture("cpu  100 10 50 800 20 5 5 10\n"
+                  "cpu0 60 5 30 400 10 3 2 5\n"
+                  "cpu2 40 5 20 400 10 2 3 5\n"
+                  "intr 12345 1 2 3\n");
+    id = lxpanel_proc_stat_subscribe(NULL, 1000, NULL, NULL);
+    s = lxpanel_proc_stat_get(0);
+    CHECK(s != NULL);
+    if (s == NULL)
+        return 1;
+    CHECK(s->cpu.user == 100 && s->cpu.idle == 800 && s->cpu.steal == 10);
+    CHECK(s->n_cores == 3);
+    CHECK(s->cores[0].user == 60 && s->cores[1].idle == 0);
+    CHECK(s->cores[2].system == 20);
+
+    /* old kernels have only four values */
+    write_fixture("cpu  200 10 100 1600\n"
+                  "cpu0 120 5 60 800\n");
+    next_sample();
+    s = lxpanel_proc_stat_get(0);
+    CHECK(s->cpu.user == 200 && s->cpu.iowait == 0 && s->n_cores == 1);
+    CHECK(lxpanel_proc_stat_get(1)->cpu.user == 100);
+    /* 100 user, 50 system and 800 idle of 950 ticks, iowait went back */
+    busy = lxpanel_cpu_times_load(&s->cpu, &lxpanel_proc_stat_get(1)->cpu, &load);
+    CHECK(busy > 150.0 / 950 - 0.001 && busy < 150.0 / 950 + 0.001);
+    CHECK(load.iowait == 0.0);
+
+    /* a malformed file is ignored */
+    write_fixture("intr 1 2 3\n");
+    next_sample();
+    CHECK(lxpanel_proc_stat_get(0)->cpu.user == 200);
+
+    /* more "cpu" lines than the initial buffer holds */
+    big = g_string_new("cpu  1 2 3 4 5 6 7 8\n");
+    for (i = 0; i < 1024; i++)
+        g_string_append_printf(big, "cpu%u %u 0 0 1000 0 0 0 0\n", i, i);
+    write_fixture(big->str);
+    g_string_free(big, TRUE);
+    next_sample();
+    s = lxpanel_proc_stat_get(0);
+    CHECK(s->n_cores == 1024 && s->cores[1023].user == 1023);
+
+    lxpanel_proc_stat_unsubscribe(id);
+    CHECK(lxpanel_proc_stat_get(0) == NULL);
+    unlink(PROC_STAT_PATH);
+
+    if (failed)
+        return 1;
+    printf("all checks passed\n");
+    return 0;
+}
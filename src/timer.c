@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2026 the LXPanel developers (see the AUTHORS file)
+ *
+ * This file is a part of LXPanel project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "private.h"
+
+/* deadlines of all timers are aligned to this grid, in milliseconds */
+#define TIMER_GRID 250
+
+/* timer may be fired earlier by this part of its interval if some other
+   timer fires anyway, but not earlier than by TIMER_MAX_SLACK */
+#define TIMER_SLACK_DIVISOR 8
+#define TIMER_MAX_SLACK 1000
+
+/* how often statistics are reported into debug log, in seconds */
+#define TIMER_REPORT_PERIOD 60
+
+typedef struct
+{
+    guint id;
+    guint interval;             /* in milliseconds */
+    gint64 deadline;            /* monotonic time of next call */
+    gint64 slack;               /* in microseconds */
+    GSourceFunc func;
+    gpointer user_data;
+    GtkWidget *widget;          /* timer is paused while it's not mapped */
+    gulong map_handler;         /* set while paused */
+    gint64 paused_since;
+    gboolean removed;           /* removed while dispatching */
+} LXPanelTimer;
+
+static GSList *timers = NULL;
+static guint last_id = 0;
+static guint source = 0;
+static gboolean dispatching = FALSE;
+
+/* statistics */
+static gint64 stats_start = 0;
+static gint64 last_report = 0;
+static guint64 n_wakeups = 0;   /* times the source was fired */
+static guint64 n_calls = 0;     /* times callbacks were called */
+static guint64 n_paused = 0;    /* calls skipped while widget was hidden */
+
+static inline gint64 timer_align(gint64 time)
+{
+    gint64 grid = TIMER_GRID * 1000;
+
+    return (time + grid - 1) / grid * grid;
+}
+
+static void timer_reschedule(void);
+
+static void timer_widget_gone(gpointer data, GObject *where_the_object_was)
+{
+    LXPanelTimer *timer = data;
+
+    /* signal handlers are gone with the widget */
+    timer->widget = NULL;
+    timer->map_handler = 0;
+    timer->paused_since = 0;
+    if (!dispatching)
+        timer_reschedule();
+}
+
+static void timer_widget_mapped(GtkWidget *widget, LXPanelTimer *timer)
+{
+    gint64 now = g_get_monotonic_time();
+
+    g_signal_handler_disconnect(widget, timer->map_handler);
+    timer->map_handler = 0;
+    n_paused += (now - timer->paused_since) / ((gint64)timer->interval * 1000);
+    timer->paused_since = 0;
+    /* widget was hidden so update it as soon as possible */
+    timer->deadline = timer_align(now);
+    if (!dispatching)
+        timer_reschedule();
+}
+
+static void timer_free(LXPanelTimer *timer)
+{
+    if (timer->widget)
+    {
+        if (timer->map_handler)
+            g_signal_handler_disconnect(timer->widget, timer->map_handler);
+        g_object_weak_unref(G_OBJECT(timer->widget), timer_widget_gone, timer);
+    }
+    g_slice_free(LXPanelTimer, timer);
+}
+
+static void timer_report(gint64 now)
+{
+    gdouble seconds = (now - stats_start) / 1000000.0;
+
+    last_report = now;
+    if (seconds <= 0)
+        return;
+    g_debug("timers: %.2f wakeups/s for %.2f calls/s, %.2f wakeups/s saved",
+            n_wakeups / seconds, n_calls / seconds,
+            (n_calls + n_paused - n_wakeups) / seconds);
+}
+
+static gboolean timer_dispatch(gpointer unused)
+{
+    LXPanelTimer *timer;
+    GSList *l, *next;
+    gint64 now;
+
+    if (g_source_is_destroyed(g_main_current_source()))
+        return FALSE;
+    now = g_get_monotonic_time();
+    n_wakeups++;
+    dispatching = TRUE;
+    /* timers added by callbacks are prepended so they are not visited */
+    for (l = timers; l; l = l->next)
+    {
+        timer = l->data;
+        if (timer->removed || timer->paused_since || timer->deadline - timer->slack > now)
+            continue;
+        if (timer->widget && !gtk_widget_get_mapped(timer->widget))
+        {
+            /* don't update hidden widget, wait until it is shown again */
+            timer->paused_since = now;
+            timer->map_handler = g_signal_connect(timer->widget, "map",
+                                                  G_CALLBACK(timer_widget_mapped),
+                                                  timer);
+            continue;
+        }
+        /* keep the grid, but don't try to catch up after a delay */
+        timer->deadline += (gint64)timer->interval * 1000;
+        if (timer->deadline <= now)
+            timer->deadline = timer_align(now + (gint64)timer->interval * 1000);
+        n_calls++;
+        if (!timer->func(timer->user_data))
+            timer->removed = TRUE;
+    }
+    dispatching = FALSE;
+    for (l = timers; l; l = next)
+    {
+        next = l->next;
+        timer = l->data;
+        if (timer->removed)
+        {
+            timers = g_slist_delete_link(timers, l);
+            timer_free(timer);
+        }
+    }
+    if (now - last_report >= (gint64)TIMER_REPORT_PERIOD * 1000000)
+        timer_report(now);
+    /* this source is finished, a new one is added if still needed */
+    source = 0;
+    timer_reschedule();
+    return FALSE;
+}
+
+/* Set the source to the earliest deadline of active timers. */
+static void timer_reschedule(void)
+{
+    LXPanelTimer *timer;
+    gint64 deadline = G_MAXINT64, now;
+    GSList *l;
+
+    for (l = timers; l; l = l->next)
+    {
+        timer = l->data;
+        if (!timer->removed && !timer->paused_since)
+            deadline = MIN(deadline, timer->deadline);
+    }
+    if (source)
+        g_source_remove(source);
+    source = 0;
+    if (deadline == G_MAXINT64)
+        return;
+    now = g_get_monotonic_time();
+    source = g_timeout_add(deadline > now ? (deadline - now + 999) / 1000 : 0,
+                           timer_dispatch, NULL);
+}
+
+guint lxpanel_timer_add(GtkWidget *widget, guint interval, GSourceFunc func,
+                        gpointer user_data)
+{
+    LXPanelTimer *timer;
+
+    g_return_val_if_fail(func != NULL, 0);
+    g_return_val_if_fail(widget == NULL || GTK_IS_WIDGET(widget), 0);
+
+    timer = g_slice_new0(LXPanelTimer);
+    timer->id = ++last_id;
+    timer->interval = MAX(interval, 1);
+    timer->slack = MIN(timer->interval / TIMER_SLACK_DIVISOR, TIMER_MAX_SLACK) * 1000;
+    timer->deadline = timer_align(g_get_monotonic_time() + (gint64)timer->interval * 1000);
+    timer->func = func;
+    timer->user_data = user_data;
+    timer->widget = widget;
+    if (widget)
+        g_object_weak_ref(G_OBJECT(widget), timer_widget_gone, timer);
+    if (stats_start == 0)
+        stats_start = last_report = g_get_monotonic_time();
+    timers = g_slist_prepend(timers, timer);
+    if (!dispatching)
+        timer_reschedule();
+    return timer->id;
+}
+
+void lxpanel_timer_remove(guint id)
+{
+    LXPanelTimer *timer;
+    GSList *l;
+
+    for (l = timers; l; l = l->next)
+    {
+        timer = l->data;
+        if (timer->id != id || timer->removed)
+            continue;
+        if (dispatching)
+            /* it will be freed after dispatch */
+            timer->removed = TRUE;
+        else
+        {
+            timers = g_slist_delete_link(timers, l);
+            timer_free(timer);
+            timer_reschedule();
+        }
+        return;
+    }
+}